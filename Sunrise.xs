@@ -0,0 +1,142 @@
+/*
+ *     XS backend of Astro::Sunrise
+ *     Copyright (C) 2023 Ron Hill and Jean Forget, all rights reserved
+ *
+ *     See the license in the embedded documentation of lib/Astro/Sunrise.pm
+ *
+ *     The C functions of util/sunriset.c are compiled in this file,
+ *     before the Perl headers, so that the macros of perl.h do not
+ *     reach them.  __sunriset_perl__ reproduces the arithmetic of the
+ *     pure Perl sunrise(), operation by operation, so that both
+ *     backends give the same results.
+ */
+
+#include "sunriset.c"
+
+#define PERL_NO_GET_CONTEXT
+#include "EXTERN.h"
+#include "perl.h"
+#include "XSUB.h"
+
+static const char *perl_polar[] = { "night", NULL, "day" };
+static const char *perl_warning[] = { "Sun never rises!!\n", NULL,
+                                      "Sun never sets!!\n" };
+
+/* A rise or set time as returned by sun_rise_set(): hours UT, or */
+/* 'day' or 'night'                                               */
+static SV *perl_time( pTHX_ double h, int rc )
+{
+      if ( rc != 0 )
+            return newSVpv( perl_polar[rc+1], 0 );
+      return newSVnv( h );
+}
+
+/* A rise or set time as returned by convert_1_hour() */
+static SV *perl_hour( pTHX_ double h, int rc, double tz, int isdst )
+{
+      double hour_local, hour, min;
+
+      if ( rc != 0 )
+            return newSVpv( perl_polar[rc+1], 0 );
+
+      hour_local = h + tz;
+      if ( isdst )
+            hour_local++;
+      if ( hour_local < 0 )
+            hour_local += 24;
+      else if ( hour_local > 24 )
+            hour_local -= 24;
+
+      hour = trunc( hour_local );
+      min  = floor( ( hour_local - hour ) * 60 + 0.5 );
+      if ( min >= 60 )
+      {
+            min -= 60;
+            hour++;
+            if ( hour >= 24 )
+                  hour -= 24;
+      }
+      return newSVpvf( "%02d:%02d", (int) hour, (int) min );
+}
+
+static void perl_warnings( pTHX_ AV *warnings, const struct perl_sunrise *res )
+{
+      int i;
+      for ( i = 0; i < res->nwarn; i++ )
+            av_push( warnings, newSVpv( perl_warning[res->warning[i]+1], 0 ) );
+}
+
+static int perl_int( pTHX_ AV *av, SSize_t i )
+{
+      SV **sv = av_fetch( av, i, 0 );
+      return sv ? (int) SvIV( *sv ) : 0;
+}
+
+MODULE = Astro::Sunrise    PACKAGE = Astro::Sunrise
+
+PROTOTYPES: DISABLE
+
+void
+_xs_sunrise( year, month, day, lon, lat, altit, upper_limb, precise, retval )
+      int    year
+      int    month
+      int    day
+      double lon
+      double lat
+      double altit
+      int    upper_limb
+      int    precise
+      int    retval
+   PREINIT:
+      struct perl_sunrise res;
+      int i;
+   PPCODE:
+      /* Rise, set (hours UT, or 'day' / 'night'), then the warnings */
+      __sunriset_perl__( year, month, day, lon, lat, altit, upper_limb,
+                         precise, retval, &res );
+      EXTEND( SP, 2 + res.nwarn );
+      PUSHs( sv_2mortal( perl_time( aTHX_ res.rise, res.rc_rise ) ) );
+      PUSHs( sv_2mortal( perl_time( aTHX_ res.set,  res.rc_set  ) ) );
+      for ( i = 0; i < res.nwarn; i++ )
+            PUSHs( sv_2mortal( newSVpv( perl_warning[res.warning[i]+1], 0 ) ) );
+
+void
+_xs_sunrise_dates( years, months, days, lon, lat, tz, isdst, altit, upper_limb, precise, retval )
+      AV *   years
+      AV *   months
+      AV *   days
+      double lon
+      double lat
+      double tz
+      int    isdst
+      double altit
+      int    upper_limb
+      int    precise
+      int    retval
+   PREINIT:
+      struct perl_sunrise res;
+      AV *times, *warnings, *pair;
+      SSize_t i, n;
+   PPCODE:
+      /* A reference to the list of [ rise, set ] pairs, then a */
+      /* reference to the list of the warnings                  */
+      n = av_len( years ) + 1;
+      times = newAV();
+      warnings = newAV();
+      av_extend( times, n );
+      for ( i = 0; i < n; i++ )
+      {
+            __sunriset_perl__( perl_int( aTHX_ years, i ),
+                               perl_int( aTHX_ months, i ),
+                               perl_int( aTHX_ days, i ),
+                               lon, lat, altit, upper_limb, precise,
+                               retval, &res );
+            perl_warnings( aTHX_ warnings, &res );
+            pair = newAV();
+            av_push( pair, perl_hour( aTHX_ res.rise, res.rc_rise, tz, isdst ) );
+            av_push( pair, perl_hour( aTHX_ res.set,  res.rc_set,  tz, isdst ) );
+            av_push( times, newRV_noinc( (SV *) pair ) );
+      }
+      EXTEND( SP, 2 );
+      PUSHs( sv_2mortal( newRV_noinc( (SV *) times ) ) );
+      PUSHs( sv_2mortal( newRV_noinc( (SV *) warnings ) ) );
@@ -0,0 +1,94 @@
+#!/usr/bin/perl -w
+# -*- perl -*-
+#
+#     Test script for Astro::Sunrise
+#     Copyright (C) 2023 Ron Hill and Jean Forget
+#
+#     This program is distributed under the same terms as Perl 5.16.3:
+#     GNU Public License version 1 or later and Perl Artistic License
+#
+#     You can find the text of the licenses in the F<LICENSE> file or at
+#     L<https://dev.perl.org/licenses/artistic.html>
+#     and L<https://www.gnu.org/licenses/gpl-1.0.html>.
+#
+#     Here is the summary of GPL:
+#
+#     This program is free software; you can redistribute it and/or modify
+#     it under the terms of the GNU General Public License as published by
+#     the Free Software Foundation; either version 1, or (at your option)
+#     any later version.
+#
+#     This program is distributed in the hope that it will be useful,
+#     but WITHOUT ANY WARRANTY; without even the implied warranty of
+#     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#     GNU General Public License for more details.
+#
+#     You should have received a copy of the GNU General Public License
+#     along with this program; if not, write to the Free Software Foundation,
+#     Inc., <https://www.fsf.org/>.
+#
+
+#
+# Checking that the XS backend gives the same results and the same warnings
+# as the pure Perl code, for random dates and locations, and that
+# sunrise_dates gives the same results as a loop on sunrise.
+#
+use strict;
+use warnings;
+use Test::More;
+use Astro::Sunrise qw(sunrise sunrise_dates);
+
+plan skip_all => 'The XS backend is not compiled'
+  unless $Astro::Sunrise::XS;
+plan tests => 5;
+
+# Runs sunrise with the selected backend, returns the results then the warnings
+sub run {
+  my ($xs, $sub, $arg) = @_;
+  my @warnings;
+  local $Astro::Sunrise::XS = $xs;
+  local $SIG{__WARN__} = sub { my ($w) = @_; $w =~ s/ at .* line \d+\.\n//; push @warnings, $w };
+  my @result = $sub->($arg);
+  return join('|', map { ref($_) ? "@$_" : $_ } @result), join('', @warnings);
+}
+
+srand(20231017);
+my %diff;
+for (1 .. 2000) {
+  my %arg = ( year       => 1801 + int(rand(299)),
+              month      => 1 + int(rand(12)),
+              day        => 1 + int(rand(28)),
+              lon        => rand(360) - 180,
+              lat        => rand(180) - 90,
+              tz         => int(rand(25)) - 12,
+              isdst      => int(rand(2)),
+              alt        => (-0.833, -6, -12, -15, -18, 0)[rand 6],
+              upper_limb => int(rand(2)),
+              precise    => int(rand(2)),
+              polar      => rand() < 0.5 ? 'warn' : 'retval',
+              );
+  my ($xs_result, $xs_warnings) = run(1, \&sunrise, \%arg);
+  my ($pp_result, $pp_warnings) = run(0, \&sunrise, \%arg);
+  $diff{ "$arg{polar} results" }++  if $xs_result   ne $pp_result;
+  $diff{ "$arg{polar} warnings" }++ if $xs_warnings ne $pp_warnings;
+}
+for my $polar (qw/warn retval/) {
+  is($diff{"$polar results"} || 0, 0, "sunrise, polar => '$polar': same results in XS and in pure Perl");
+}
+is($diff{"warn warnings"} || 0, 0, "sunrise, polar => 'warn': same warnings in XS and in pure Perl");
+
+# A year at Tromsø, with the polar night and the midnight sun
+my (@year, @month, @day);
+for my $month (1 .. 12) {
+  for my $day (1 .. 28) {
+    push @year, 2023; push @month, $month; push @day, $day;
+  }
+}
+for my $polar (qw/warn retval/) {
+  my %arg = ( year => \@year, month => \@month, day => \@day,
+              lon => 18.95, lat => 69.65, tz => 1, alt => -0.833,
+              precise => 1, polar => $polar );
+  my @xs = run(1, \&sunrise_dates, \%arg);
+  my @pp = run(0, \&sunrise_dates, \%arg);
+  is_deeply(\@xs, \@pp, "sunrise_dates, polar => '$polar': same results and warnings in XS and in pure Perl");
+}
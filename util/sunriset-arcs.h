@@ -0,0 +1,414 @@
+/*
+
+SUNRISET-ARCS.H - body of the vectorized diurnal arc kernel of SUNRISET.C
+
+This file is included by sunriset.c once per instruction set, with:
+
+   ARCS_NAME    name of the kernel function to define
+   ARCS_TARGET  GCC target attribute, e.g. "avx2,fma"
+   ARCS_WIDTH   number of doubles per vector: 2, 4 or 8
+   ARCS_SQRT    the matching square root intrinsic, e.g. _mm256_sqrt_pd
+   ARCS_SQRTF   the same for floats, e.g. _mm256_sqrt_ps
+
+The kernel computes the same thing as the second half of __sunriset__,
+for ARCS_WIDTH sites at a time.  It replaces sin, cos and acos with the
+polynomials below, and the tests on cost with masks.
+
+Error bounds of the polynomials, for the arguments used here:
+
+   sind, cosd    |x| <= 90 degrees   Taylor series up to x^17 and x^18,
+                                     error below 5e-14; cosd is never
+                                     below cosd(90) of the libm, 6.1e-17,
+                                     so that cost keeps the sign it has
+                                     in __sunriset__ at the poles
+   acosd         -1 <= x <= 1        Taylor series of asin up to y^37,
+                                     with y <= 0.5, error below 1e-12
+                                     degrees (about 2.4e-10 seconds of time)
+
+Near cost = +-1, the rounding of cost itself dominates: over 1801-2099,
+the rise and set times differ from __sunriset__ by at most 3e-6 seconds
+(see "sunriset-bench simd").
+
+A second kernel, ARCS_NAME_row, computes the diurnal arcs of one row of
+a raster (see sunriset_raster_tiles): the sines and cosines come from
+the libm, computed once per row and per column, so that only acosd is
+a polynomial.
+
+A third kernel, ARCS_NAME_float, is the first one in single precision,
+for sunriset_arcs_float: 2*ARCS_WIDTH floats per vector, and shorter
+polynomials, Taylor series up to x^13 and x^14 for sind and cosd and
+up to y^19 for asin, whose errors stay below the rounding of floats.
+
+*/
+
+#define ARCS_CAT2(a,b)   a ## b
+#define ARCS_CAT(a,b)    ARCS_CAT2(a,b)
+#define ARCS_VD          ARCS_CAT(arcs_vd, ARCS_WIDTH)
+#define ARCS_VI          ARCS_CAT(arcs_vi, ARCS_WIDTH)
+#define ARCS_VRC         ARCS_CAT(arcs_vrc, ARCS_WIDTH)
+#define ARCS_SIN         ARCS_CAT(ARCS_NAME, _sin)
+#define ARCS_COS         ARCS_CAT(ARCS_NAME, _cos)
+#define ARCS_ACOS        ARCS_CAT(ARCS_NAME, _acos)
+#define ARCS_ROW         ARCS_CAT(ARCS_NAME, _row)
+#define ARCS_VF          ARCS_CAT(arcs_vf, ARCS_WIDTH)
+#define ARCS_VFI         ARCS_CAT(arcs_vfi, ARCS_WIDTH)
+#define ARCS_SINF        ARCS_CAT(ARCS_NAME, _sinf)
+#define ARCS_COSF        ARCS_CAT(ARCS_NAME, _cosf)
+#define ARCS_ACOSF       ARCS_CAT(ARCS_NAME, _acosf)
+#define ARCS_FLOAT       ARCS_CAT(ARCS_NAME, _float)
+
+typedef double    ARCS_VD  __attribute__(( vector_size( 8*ARCS_WIDTH ) ));
+typedef long long ARCS_VI  __attribute__(( vector_size( 8*ARCS_WIDTH ) ));
+typedef int       ARCS_VRC __attribute__(( vector_size( 4*ARCS_WIDTH ) ));
+typedef float     ARCS_VF  __attribute__(( vector_size( 8*ARCS_WIDTH ) ));
+typedef int       ARCS_VFI __attribute__(( vector_size( 8*ARCS_WIDTH ) ));
+
+/* Bitwise select: m ? a : b, with m all ones or all zeros per lane */
+#define ARCS_SEL(m,a,b)  ( (ARCS_VD)( ( (ARCS_VI)(a) & (m) ) | \
+                                      ( (ARCS_VI)(b) & ~(m) ) ) )
+#define ARCS_SELF(m,a,b) ( (ARCS_VF)( ( (ARCS_VFI)(a) & (m) ) | \
+                                      ( (ARCS_VFI)(b) & ~(m) ) ) )
+
+/* Sine of an angle given in radians, |r| <= pi/2 */
+static inline __attribute__(( target(ARCS_TARGET), always_inline ))
+ARCS_VD ARCS_SIN( ARCS_VD r )
+{
+      ARCS_VD r2 = r * r;
+      return r * ( 1.0 + r2 * ( -1.66666666666666657e-01
+                 + r2 * ( 8.33333333333333322e-03
+                 + r2 * ( -1.98412698412698413e-04
+                 + r2 * ( 2.75573192239858925e-06
+                 + r2 * ( -2.50521083854417202e-08
+                 + r2 * ( 1.60590438368216133e-10
+                 + r2 * ( -7.64716373181981641e-13
+                 + r2 * 2.81145725434552060e-15 ) ) ) ) ) ) ) );
+}
+
+/* Cosine of an angle given in radians, |r| <= pi/2, at least ARCS_COS_MIN */
+#ifndef ARCS_COS_MIN
+ #define ARCS_COS_MIN    6.123233995736766e-17   /* cos(PI/2) of the libm */
+#endif
+
+static inline __attribute__(( target(ARCS_TARGET), always_inline ))
+ARCS_VD ARCS_COS( ARCS_VD r )
+{
+      ARCS_VD r2 = r * r, c;
+      c = 1.0 + r2 * ( -5.00000000000000000e-01
+                 + r2 * ( 4.16666666666666644e-02
+                 + r2 * ( -1.38888888888888894e-03
+                 + r2 * ( 2.48015873015873016e-05
+                 + r2 * ( -2.75573192239858883e-07
+                 + r2 * ( 2.08767569878681002e-09
+                 + r2 * ( -1.14707455977297245e-11
+                 + r2 * ( 4.77947733238738525e-14
+                 + r2 * -1.56192069685862253e-16 ) ) ) ) ) ) ) );
+      return ARCS_SEL( c < ARCS_COS_MIN, c - c + ARCS_COS_MIN, c );
+}
+
+/* Arc cosine in degrees, -1 <= x <= 1                                */
+/* acos(|x|) = pi/2 - asin(|x|)         when |x| <= 0.5               */
+/*           = 2 * asin(sqrt((1-|x|)/2)) otherwise                    */
+/* acos(-x)  = pi - acos(x)                                           */
+static inline __attribute__(( target(ARCS_TARGET), always_inline ))
+ARCS_VD ARCS_ACOS( ARCS_VD x )
+{
+      ARCS_VD zero = x - x;
+      ARCS_VI neg  = x < zero;
+      ARCS_VD a    = ARCS_SEL( neg, -x, x );
+      ARCS_VI big  = a > 0.5;
+      ARCS_VD y    = ARCS_SEL( big, (ARCS_VD)ARCS_SQRT( ( 1.0 - a ) * 0.5 ), a );
+      ARCS_VD z    = y * y;
+      ARCS_VD p, r;
+
+      p = y + y * z * ( 1.66666666666666657e-01
+               + z * ( 7.49999999999999972e-02
+               + z * ( 4.46428571428571438e-02
+               + z * ( 3.03819444444444441e-02
+               + z * ( 2.23721590909090919e-02
+               + z * ( 1.73527644230769239e-02
+               + z * ( 1.39648437500000007e-02
+               + z * ( 1.15518008961397051e-02
+               + z * ( 9.76160952919407840e-03
+               + z * ( 8.39033580961681506e-03
+               + z * ( 7.31252587359884545e-03
+               + z * ( 6.44721031188964875e-03
+               + z * ( 5.74003767084192359e-03
+               + z * ( 5.15330968231990458e-03
+               + z * ( 4.66014348691509619e-03
+               + z * ( 4.24090709367936324e-03
+               + z * ( 3.88096455883766905e-03
+               + z * 3.56920539382593474e-03 ) ) ) ) ) ) ) ) ) ) ) ) ) ) ) ) );
+
+      /* p = asin(y); r = acos(|x|) */
+      r = ARCS_SEL( big, 2.0 * p, PI/2 - p );
+      r = ARCS_SEL( neg, PI - r, r );
+      return RADEG * r;
+}
+
+static __attribute__(( target(ARCS_TARGET) ))
+void ARCS_NAME( long n, const double *lat, const double *sdec,
+                const double *altit, const double *tsouth,
+                double *trise, double *tset, int *rc )
+{
+      double  buf[7][ARCS_WIDTH];
+      long    i, w;
+
+      for ( i = 0; i < n; i += ARCS_WIDTH )
+      {
+            ARCS_VD vlat, vdec, valt, vsouth, cost, t, rlat, rdec;
+            ARCS_VI below, above;
+            ARCS_VRC vrc;
+
+            w = n - i < ARCS_WIDTH ? n - i : ARCS_WIDTH;
+            if ( w == ARCS_WIDTH )
+            {
+                  memcpy( &vlat,   lat    + i, sizeof vlat );
+                  memcpy( &vdec,   sdec   + i, sizeof vdec );
+                  memcpy( &valt,   altit  + i, sizeof valt );
+                  memcpy( &vsouth, tsouth + i, sizeof vsouth );
+            }
+            else
+            {
+                  /* Last partial vector: pad with harmless values */
+                  memset( buf, 0, sizeof buf );
+                  memcpy( buf[0], lat    + i, w * sizeof(double) );
+                  memcpy( buf[1], sdec   + i, w * sizeof(double) );
+                  memcpy( buf[2], altit  + i, w * sizeof(double) );
+                  memcpy( buf[3], tsouth + i, w * sizeof(double) );
+                  memcpy( &vlat,   buf[0], sizeof vlat );
+                  memcpy( &vdec,   buf[1], sizeof vdec );
+                  memcpy( &valt,   buf[2], sizeof valt );
+                  memcpy( &vsouth, buf[3], sizeof vsouth );
+            }
+
+            rlat = vlat * DEGRAD;
+            rdec = vdec * DEGRAD;
+            cost = ( ARCS_SIN( valt * DEGRAD ) - ARCS_SIN( rlat ) * ARCS_SIN( rdec ) ) /
+                   ( ARCS_COS( rlat ) * ARCS_COS( rdec ) );
+
+            /* rc = -1 where the Sun is always below altit, t =  0 */
+            /* rc = +1 where the Sun is always above altit, t = 12 */
+            below = cost >= 1.0;
+            above = cost <= -1.0;
+            cost  = ARCS_SEL( below | above, vsouth - vsouth, cost );
+            t     = ARCS_ACOS( cost ) / 15.0;
+            t     = ARCS_SEL( below, t - t, t );
+            t     = ARCS_SEL( above, t - t + 12.0, t );
+            vrc   = __builtin_convertvector( below - above, ARCS_VRC );
+
+            if ( w == ARCS_WIDTH )
+            {
+                  ARCS_VD r = vsouth - t, s = vsouth + t;
+                  memcpy( trise + i, &r,   sizeof r );
+                  memcpy( tset  + i, &s,   sizeof s );
+                  memcpy( rc    + i, &vrc, sizeof vrc );
+            }
+            else
+            {
+                  ARCS_VD r = vsouth - t, s = vsouth + t;
+                  memcpy( buf[4], &r,   sizeof r );
+                  memcpy( buf[5], &s,   sizeof s );
+                  memcpy( buf[6], &vrc, sizeof vrc );
+                  memcpy( trise + i, buf[4], w * sizeof(double) );
+                  memcpy( tset  + i, buf[5], w * sizeof(double) );
+                  memcpy( rc    + i, buf[6], w * sizeof(int) );
+            }
+      }
+}  /* ARCS_NAME */
+
+/* Diurnal arcs t[j], hours, of n cells of a row of latitude (sin_lat, */
+/* cos_lat): 0 where the Sun is always below the altitude, 12 where it */
+/* is always above                                                    */
+static __attribute__(( target(ARCS_TARGET) ))
+void ARCS_ROW( long n, double sin_lat, double cos_lat, const double *sin_alt,
+               const double *sin_dec, const double *cos_dec, double *t )
+{
+      double  buf[4][ARCS_WIDTH];
+      long    j, w, k;
+
+      for ( j = 0; j < n; j += ARCS_WIDTH )
+      {
+            ARCS_VD valt, vsd, vcd, cost, vt;
+            ARCS_VI below, above;
+
+            w = n - j < ARCS_WIDTH ? n - j : ARCS_WIDTH;
+            if ( w == ARCS_WIDTH )
+            {
+                  memcpy( &valt, sin_alt + j, sizeof valt );
+                  memcpy( &vsd,  sin_dec + j, sizeof vsd );
+                  memcpy( &vcd,  cos_dec + j, sizeof vcd );
+            }
+            else
+            {
+                  /* Last partial vector: pad with harmless values */
+                  memset( buf, 0, sizeof buf );
+                  for ( k = 0; k < ARCS_WIDTH; k++ )
+                        buf[2][k] = 1.0;
+                  memcpy( buf[0], sin_alt + j, w * sizeof(double) );
+                  memcpy( buf[1], sin_dec + j, w * sizeof(double) );
+                  memcpy( buf[2], cos_dec + j, w * sizeof(double) );
+                  memcpy( &valt, buf[0], sizeof valt );
+                  memcpy( &vsd,  buf[1], sizeof vsd );
+                  memcpy( &vcd,  buf[2], sizeof vcd );
+            }
+
+            cost  = ( valt - sin_lat * vsd ) / ( cos_lat * vcd );
+            below = cost >= 1.0;
+            above = cost <= -1.0;
+            cost  = ARCS_SEL( below | above, cost - cost, cost );
+            vt    = ARCS_ACOS( cost ) / 15.0;
+            vt    = ARCS_SEL( below, vt - vt, vt );
+            vt    = ARCS_SEL( above, vt - vt + 12.0, vt );
+
+            if ( w == ARCS_WIDTH )
+                  memcpy( t + j, &vt, sizeof vt );
+            else
+            {
+                  memcpy( buf[3], &vt, sizeof vt );
+                  memcpy( t + j, buf[3], w * sizeof(double) );
+            }
+      }
+}  /* ARCS_ROW */
+
+/* Single precision: same as ARCS_NAME, 2*ARCS_WIDTH sites at a time */
+
+static inline __attribute__(( target(ARCS_TARGET), always_inline ))
+ARCS_VF ARCS_SINF( ARCS_VF r )
+{
+      ARCS_VF r2 = r * r;
+      return r * ( 1.0f + r2 * ( -1.66666667e-01f
+                 + r2 * ( 8.33333333e-03f
+                 + r2 * ( -1.98412698e-04f
+                 + r2 * ( 2.75573192e-06f
+                 + r2 * ( -2.50521084e-08f
+                 + r2 * 1.60590438e-10f ) ) ) ) ) );
+}
+
+static inline __attribute__(( target(ARCS_TARGET), always_inline ))
+ARCS_VF ARCS_COSF( ARCS_VF r )
+{
+      ARCS_VF r2 = r * r, c;
+      c = 1.0f + r2 * ( -5.00000000e-01f
+                 + r2 * ( 4.16666667e-02f
+                 + r2 * ( -1.38888889e-03f
+                 + r2 * ( 2.48015873e-05f
+                 + r2 * ( -2.75573192e-07f
+                 + r2 * ( 2.08767570e-09f
+                 + r2 * -1.14707456e-11f ) ) ) ) ) );
+      return ARCS_SELF( c < (float) ARCS_COS_MIN, c - c + (float) ARCS_COS_MIN, c );
+}
+
+static inline __attribute__(( target(ARCS_TARGET), always_inline ))
+ARCS_VF ARCS_ACOSF( ARCS_VF x )
+{
+      ARCS_VF  zero = x - x;
+      ARCS_VFI neg  = x < zero;
+      ARCS_VF  a    = ARCS_SELF( neg, -x, x );
+      ARCS_VFI big  = a > 0.5f;
+      ARCS_VF  y    = ARCS_SELF( big, (ARCS_VF)ARCS_SQRTF( ( 1.0f - a ) * 0.5f ), a );
+      ARCS_VF  z    = y * y;
+      ARCS_VF  p, r;
+
+      p = y + y * z * ( 1.66666667e-01f
+               + z * ( 7.50000000e-02f
+               + z * ( 4.46428571e-02f
+               + z * ( 3.03819444e-02f
+               + z * ( 2.23721591e-02f
+               + z * ( 1.73527644e-02f
+               + z * ( 1.39648438e-02f
+               + z * ( 1.15518009e-02f
+               + z * 9.76160953e-03f ) ) ) ) ) ) ) );
+
+      r = ARCS_SELF( big, 2.0f * p, (float) ( PI/2 ) - p );
+      r = ARCS_SELF( neg, (float) PI - r, r );
+      return (float) RADEG * r;
+}
+
+static __attribute__(( target(ARCS_TARGET) ))
+void ARCS_FLOAT( long n, const float *lat, const float *sdec,
+                 const float *altit, const float *tsouth,
+                 float *trise, float *tset, int *rc )
+{
+      float   buf[7][2*ARCS_WIDTH];
+      long    i, w;
+
+      for ( i = 0; i < n; i += 2*ARCS_WIDTH )
+      {
+            ARCS_VF  vlat, vdec, valt, vsouth, cost, t, rlat, rdec, r, s;
+            ARCS_VFI below, above, vrc;
+
+            w = n - i < 2*ARCS_WIDTH ? n - i : 2*ARCS_WIDTH;
+            if ( w == 2*ARCS_WIDTH )
+            {
+                  memcpy( &vlat,   lat    + i, sizeof vlat );
+                  memcpy( &vdec,   sdec   + i, sizeof vdec );
+                  memcpy( &valt,   altit  + i, sizeof valt );
+                  memcpy( &vsouth, tsouth + i, sizeof vsouth );
+            }
+            else
+            {
+                  /* Last partial vector: pad with harmless values */
+                  memset( buf, 0, sizeof buf );
+                  memcpy( buf[0], lat    + i, w * sizeof(float) );
+                  memcpy( buf[1], sdec   + i, w * sizeof(float) );
+                  memcpy( buf[2], altit  + i, w * sizeof(float) );
+                  memcpy( buf[3], tsouth + i, w * sizeof(float) );
+                  memcpy( &vlat,   buf[0], sizeof vlat );
+                  memcpy( &vdec,   buf[1], sizeof vdec );
+                  memcpy( &valt,   buf[2], sizeof valt );
+                  memcpy( &vsouth, buf[3], sizeof vsouth );
+            }
+
+            rlat = vlat * (float) DEGRAD;
+            rdec = vdec * (float) DEGRAD;
+            cost = ( ARCS_SINF( valt * (float) DEGRAD ) - ARCS_SINF( rlat ) * ARCS_SINF( rdec ) ) /
+                   ( ARCS_COSF( rlat ) * ARCS_COSF( rdec ) );
+
+            below = cost >= 1.0f;
+            above = cost <= -1.0f;
+            cost  = ARCS_SELF( below | above, vsouth - vsouth, cost );
+            t     = ARCS_ACOSF( cost ) / 15.0f;
+            t     = ARCS_SELF( below, t - t, t );
+            t     = ARCS_SELF( above, t - t + 12.0f, t );
+            vrc   = below - above;
+            r     = vsouth - t;
+            s     = vsouth + t;
+
+            if ( w == 2*ARCS_WIDTH )
+            {
+                  memcpy( trise + i, &r,   sizeof r );
+                  memcpy( tset  + i, &s,   sizeof s );
+                  memcpy( rc    + i, &vrc, sizeof vrc );
+            }
+            else
+            {
+                  memcpy( buf[4], &r,   sizeof r );
+                  memcpy( buf[5], &s,   sizeof s );
+                  memcpy( buf[6], &vrc, sizeof vrc );
+                  memcpy( trise + i, buf[4], w * sizeof(float) );
+                  memcpy( tset  + i, buf[5], w * sizeof(float) );
+                  memcpy( rc    + i, buf[6], w * sizeof(int) );
+            }
+      }
+}  /* ARCS_FLOAT */
+
+#undef ARCS_VD
+#undef ARCS_VI
+#undef ARCS_VRC
+#undef ARCS_SEL
+#undef ARCS_SELF
+#undef ARCS_SIN
+#undef ARCS_COS
+#undef ARCS_ACOS
+#undef ARCS_ROW
+#undef ARCS_VF
+#undef ARCS_VFI
+#undef ARCS_SINF
+#undef ARCS_COSF
+#undef ARCS_ACOSF
+#undef ARCS_FLOAT
+#undef ARCS_NAME
+#undef ARCS_TARGET
+#undef ARCS_WIDTH
+#undef ARCS_SQRT
+#undef ARCS_SQRTF
@@ -0,0 +1,2392 @@
+/*
+
+SUNRISET-BENCH.C - throughput benchmarks for the functions of SUNRISET.C
+
+Usage:  sunriset-bench batch [nsites]
+        sunriset-bench simd  [nsites]
+        sunriset-bench precise [nsites]
+        sunriset-bench ephem [nsites]
+        sunriset-bench almanac [nsites]
+        sunriset-bench stream [nrecords]
+        sunriset-bench almfile [nlookups]
+        sunriset-bench fused [ndays]
+        sunriset-bench inverse [nqueries]
+        sunriset-bench sweep [nsites]
+        sunriset-bench stats [npairs]
+        sunriset-bench float [daystep]
+        sunriset-bench timeline [nsites]
+        sunriset-bench raster [step]
+        sunriset-bench backend [nsites]
+        sunriset-bench suite [-j out.json] [-b baseline.json] [filter]
+
+Each benchmark checks that the fast path gives the same results as the
+per-call macros of SUNRISET.C before printing its timings.
+
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Included rather than linked: the benchmarks also check the static */
+/* kernels of SUNRISET.C                                             */
+#include "sunriset.c"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* Wall-clock time in seconds, for the timings */
+
+static double now( void )
+{
+      struct timespec ts;
+      clock_gettime( CLOCK_MONOTONIC, &ts );
+      return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* A small deterministic generator, so runs can be compared */
+
+static unsigned long bench_seed = 12345;
+
+static double uniform( double lo, double hi )
+{
+      bench_seed = bench_seed * 6364136223846793005UL + 1442695040888963407UL;
+      return lo + ( hi - lo ) * ( ( bench_seed >> 11 ) * ( 1.0 / 9007199254740992.0 ) );
+}
+
+static void *xmalloc( size_t size )
+{
+      void *p = malloc( size );
+      if ( p == NULL )
+      {
+            fprintf( stderr, "sunriset-bench: out of memory\n" );
+            exit( 1 );
+      }
+      return p;
+}
+
+
+/* The (site, date) pairs of a benchmark, in structure-of-arrays form */
+
+struct pairs
+{
+      long   n;
+      int    *year, *month, *day;
+      double *lon, *lat;
+};
+
+static void pairs_alloc( struct pairs *p, long n )
+{
+      p->n     = n;
+      p->year  = xmalloc( n * sizeof *p->year );
+      p->month = xmalloc( n * sizeof *p->month );
+      p->day   = xmalloc( n * sizeof *p->day );
+      p->lon   = xmalloc( n * sizeof *p->lon );
+      p->lat   = xmalloc( n * sizeof *p->lat );
+}
+
+static void pairs_free( struct pairs *p )
+{
+      free( p->year );
+      free( p->month );
+      free( p->day );
+      free( p->lon );
+      free( p->lat );
+}
+
+
+/* Batch benchmark: sunriset_batch against the four per-call macros */
+
+static void bench_batch_1( const char *label, const struct pairs *p )
+{
+      long   n = p->n, i, k, nephem, mismatch = 0;
+      double *rise0 = xmalloc( SUNRISET_KINDS * n * sizeof(double) );
+      double *set0  = xmalloc( SUNRISET_KINDS * n * sizeof(double) );
+      int    *rc0   = xmalloc( SUNRISET_KINDS * n * sizeof(int) );
+      double *rise1 = xmalloc( SUNRISET_KINDS * n * sizeof(double) );
+      double *set1  = xmalloc( SUNRISET_KINDS * n * sizeof(double) );
+      int    *rc1   = xmalloc( SUNRISET_KINDS * n * sizeof(int) );
+      double t0, t1, t2, maxdiff = 0.0;
+
+      t0 = now();
+      for ( i = 0; i < n; i++ )
+      {
+            rc0[i] = sun_rise_set( p->year[i], p->month[i], p->day[i],
+                                   p->lon[i], p->lat[i],
+                                   &rise0[i], &set0[i] );
+            rc0[n+i] = civil_twilight( p->year[i], p->month[i], p->day[i],
+                                       p->lon[i], p->lat[i],
+                                       &rise0[n+i], &set0[n+i] );
+            rc0[2*n+i] = nautical_twilight( p->year[i], p->month[i],
+                                            p->day[i], p->lon[i], p->lat[i],
+                                            &rise0[2*n+i], &set0[2*n+i] );
+            rc0[3*n+i] = astronomical_twilight( p->year[i], p->month[i],
+                                                p->day[i], p->lon[i],
+                                                p->lat[i],
+                                                &rise0[3*n+i], &set0[3*n+i] );
+      }
+      t1 = now();
+      nephem = sunriset_batch( n, p->year, p->month, p->day, p->lon, p->lat,
+                               rise1, set1, rc1, ISA_SCALAR, NULL );
+      t2 = now();
+
+      for ( k = 0; k < SUNRISET_KINDS * n; k++ )
+      {
+            if ( rc0[k] != rc1[k] )
+                  mismatch++;
+            if ( fabs( rise0[k] - rise1[k] ) > maxdiff )
+                  maxdiff = fabs( rise0[k] - rise1[k] );
+            if ( fabs( set0[k] - set1[k] ) > maxdiff )
+                  maxdiff = fabs( set0[k] - set1[k] );
+      }
+
+      printf( "batch: %ld pairs, %s\n", n, label );
+      printf( "  per-call macros  %8.3f s %10.0f pairs/s\n",
+              t1 - t0, n / ( t1 - t0 ) );
+      printf( "  sunriset_batch   %8.3f s %10.0f pairs/s  x%.2f,"
+              " %ld positions\n",
+              t2 - t1, n / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ), nephem );
+      printf( "  max difference %g h, %ld return code mismatches\n",
+              maxdiff, mismatch );
+
+      free( rise0 ); free( set0 ); free( rc0 );
+      free( rise1 ); free( set1 ); free( rc1 );
+}
+
+static void bench_batch( long nsites )
+{
+      struct pairs p;
+      long   i, j, nlon, nlat;
+
+      /* Scattered sites, one date: one position per site */
+      pairs_alloc( &p, nsites );
+      for ( i = 0; i < nsites; i++ )
+      {
+            p.year[i]  = 2024;
+            p.month[i] = 6;
+            p.day[i]   = 21;
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.lat[i]   = uniform( -89.0, 89.0 );
+      }
+      bench_batch_1( "scattered sites, 2024-06-21", &p );
+      pairs_free( &p );
+
+      /* Grid sites sorted by longitude: one position per column */
+      nlat = 500;
+      nlon = ( nsites + nlat - 1 ) / nlat;
+      pairs_alloc( &p, nlon * nlat );
+      for ( i = 0; i < nlon; i++ )
+            for ( j = 0; j < nlat; j++ )
+            {
+                  p.year[i*nlat+j]  = 2024;
+                  p.month[i*nlat+j] = 12;
+                  p.day[i*nlat+j]   = 21;
+                  p.lon[i*nlat+j]   = -180.0 + ( 360.0 * i ) / nlon;
+                  p.lat[i*nlat+j]   = -89.0 + ( 178.0 * j ) / ( nlat - 1 );
+            }
+      bench_batch_1( "grid sites by longitude, 2024-12-21", &p );
+      pairs_free( &p );
+}
+
+
+/* SIMD benchmark: the vectorized diurnal arc against the scalar one */
+
+static const char *isa_name[] = { "scalar", "sse2", "avx2", "avx512" };
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+
+/* Measured errors of the polynomials of sunriset-arcs.h, in degrees */
+static void simd_poly_errors( void )
+{
+      double x, errsin = 0.0, errcos = 0.0, erracos = 0.0;
+      arcs_vd2 v, s, c;
+
+      for ( x = -90.0; x <= 90.0; x += 0.0001 )
+      {
+            v = ( arcs_vd2 ) { x * DEGRAD, x * DEGRAD };
+            s = arcs_sse2_sin( v );
+            c = arcs_sse2_cos( v );
+            if ( fabs( s[0] - sind(x) ) > errsin )
+                  errsin = fabs( s[0] - sind(x) );
+            if ( fabs( c[0] - cosd(x) ) > errcos )
+                  errcos = fabs( c[0] - cosd(x) );
+      }
+      for ( x = -1.0; x <= 1.0; x += 1e-6 )
+      {
+            v = ( arcs_vd2 ) { x, x };
+            s = arcs_sse2_acos( v );
+            if ( fabs( s[0] - acosd(x) ) > erracos )
+                  erracos = fabs( s[0] - acosd(x) );
+      }
+      printf( "simd: polynomial errors: sind %.1e, cosd %.1e, acosd %.1e deg\n",
+              errsin, errcos, erracos );
+}
+
+#else
+
+static void simd_poly_errors( void )
+{
+}
+
+#endif
+
+/* Compares every usable ISA with the scalar path, for all the days  */
+/* from 1801 to 2099 and latitudes -89..+89 degrees, plus the poles. */
+static void simd_accuracy( int best )
+{
+      struct pairs p;
+      long   nlat = 92, ndays, n, i, j, k, mismatch[4] = { 0, 0, 0, 0 };
+      int    year, month, day, isa;
+      double *rise0, *set0, *rise1, *set1, maxdiff[4] = { 0, 0, 0, 0 };
+      int    *rc0, *rc1;
+      static const int mdays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+      pairs_alloc( &p, 366 * nlat );
+      rise0 = xmalloc( SUNRISET_KINDS * p.n * sizeof(double) );
+      set0  = xmalloc( SUNRISET_KINDS * p.n * sizeof(double) );
+      rc0   = xmalloc( SUNRISET_KINDS * p.n * sizeof(int) );
+      rise1 = xmalloc( SUNRISET_KINDS * p.n * sizeof(double) );
+      set1  = xmalloc( SUNRISET_KINDS * p.n * sizeof(double) );
+      rc1   = xmalloc( SUNRISET_KINDS * p.n * sizeof(int) );
+
+      for ( year = 1801; year <= 2099; year++ )
+      {
+            /* One year at a time, every day, all latitudes */
+            ndays = 0;
+            for ( month = 1; month <= 12; month++ )
+            {
+                  int last = mdays[month-1] + ( month == 2 && year % 4 == 0
+                                && ( year % 100 != 0 || year % 400 == 0 ) );
+                  for ( day = 1; day <= last; day++, ndays++ )
+                        for ( j = 0; j < nlat; j++ )
+                        {
+                              i = ndays * nlat + j;
+                              p.year[i]  = year;
+                              p.month[i] = month;
+                              p.day[i]   = day;
+                              p.lon[i]   = uniform( -180.0, 180.0 );
+                              p.lat[i]   = j < 90 ? -89.0 + 2.0 * j
+                                                     : j == 90 ? -90.0 : 90.0;
+                        }
+            }
+            n = ndays * nlat;
+            sunriset_batch( n, p.year, p.month, p.day, p.lon, p.lat,
+                            rise0, set0, rc0, ISA_SCALAR, NULL );
+            for ( isa = ISA_SSE2; isa <= best; isa++ )
+            {
+                  sunriset_batch( n, p.year, p.month, p.day, p.lon, p.lat,
+                                  rise1, set1, rc1, isa, NULL );
+                  for ( k = 0; k < SUNRISET_KINDS; k++ )
+                        for ( i = k * n; i < ( k + 1 ) * n; i++ )
+                        {
+                              if ( rc0[i] != rc1[i] )
+                              {
+                                    mismatch[isa]++;
+                                    continue;
+                              }
+                              if ( fabs( rise0[i] - rise1[i] ) > maxdiff[isa] )
+                                    maxdiff[isa] = fabs( rise0[i] - rise1[i] );
+                              if ( fabs( set0[i] - set1[i] ) > maxdiff[isa] )
+                                    maxdiff[isa] = fabs( set0[i] - set1[i] );
+                        }
+            }
+      }
+      for ( isa = ISA_SSE2; isa <= best; isa++ )
+            printf( "simd: %-6s 1801-2099, lat -90..+90: max difference"
+                    " %.2e s, %ld return code mismatches\n",
+                    isa_name[isa], 3600.0 * maxdiff[isa], mismatch[isa] );
+
+      pairs_free( &p );
+      free( rise0 ); free( set0 ); free( rc0 );
+      free( rise1 ); free( set1 ); free( rc1 );
+}
+
+static void bench_simd( long nsites )
+{
+      struct pairs p;
+      long   i, rep, nrep = 20;
+      int    isa, best = sunriset_isa();
+      double *sdec   = xmalloc( nsites * sizeof(double) );
+      double *altit  = xmalloc( nsites * sizeof(double) );
+      double *tsouth = xmalloc( nsites * sizeof(double) );
+      double *rise   = xmalloc( SUNRISET_KINDS * nsites * sizeof(double) );
+      double *set    = xmalloc( SUNRISET_KINDS * nsites * sizeof(double) );
+      int    *rc     = xmalloc( SUNRISET_KINDS * nsites * sizeof(int) );
+      double t0, t1, base = 0.0;
+
+      printf( "simd: widest instruction set %s\n", isa_name[best] );
+      simd_poly_errors();
+      simd_accuracy( best );
+
+      pairs_alloc( &p, nsites );
+      for ( i = 0; i < nsites; i++ )
+      {
+            p.year[i]  = 2024;
+            p.month[i] = 3;
+            p.day[i]   = 20;
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.lat[i]   = uniform( -89.0, 89.0 );
+            sdec[i]    = uniform( -23.44, 23.44 );
+            altit[i]   = -0.833;
+            tsouth[i]  = 12.0;
+      }
+
+      /* The diurnal arc kernel alone */
+      for ( isa = ISA_SCALAR; isa <= best; isa++ )
+      {
+            t0 = now();
+            for ( rep = 0; rep < nrep; rep++ )
+                  sunriset_arcs( isa, nsites, p.lat, sdec, altit, tsouth,
+                                 rise, set, rc );
+            t1 = now();
+            if ( isa == ISA_SCALAR )
+                  base = t1 - t0;
+            printf( "  sunriset_arcs  %-6s %8.3f s %10.0f sites/s  x%.2f\n",
+                    isa_name[isa], t1 - t0, nrep * nsites / ( t1 - t0 ),
+                    base / ( t1 - t0 ) );
+      }
+
+      /* The whole batch, scattered sites */
+      for ( isa = ISA_SCALAR; isa <= best; isa++ )
+      {
+            t0 = now();
+            sunriset_batch( nsites, p.year, p.month, p.day, p.lon, p.lat,
+                            rise, set, rc, isa, NULL );
+            t1 = now();
+            if ( isa == ISA_SCALAR )
+                  base = t1 - t0;
+            printf( "  sunriset_batch %-6s %8.3f s %10.0f pairs/s  x%.2f\n",
+                    isa_name[isa], t1 - t0, nsites / ( t1 - t0 ),
+                    base / ( t1 - t0 ) );
+      }
+
+      pairs_free( &p );
+      free( sdec ); free( altit ); free( tsouth );
+      free( rise ); free( set ); free( rc );
+}
+
+
+/* Precise benchmark: iterations paid per site, for several tolerances */
+
+static void bench_precise( long nsites )
+{
+      struct pairs p;
+      struct precise_stats st;
+      static const double tols[] = { PRECISE_TOL_PERL, 1e-3, PRECISE_TOL, 1e-7 };
+      long   i;
+      int    j, k;
+      double t0, t1, rise, set, base;
+
+      pairs_alloc( &p, nsites );
+      for ( i = 0; i < nsites; i++ )
+      {
+            p.year[i]  = 1801 + (int) uniform( 0.0, 299.0 );
+            p.month[i] = 1 + (int) uniform( 0.0, 12.0 );
+            p.day[i]   = 1 + (int) uniform( 0.0, 28.0 );
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.lat[i]   = uniform( -89.0, 89.0 );
+      }
+
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+            sun_rise_set( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i],
+                          &rise, &set );
+      t1 = now();
+      base = t1 - t0;
+      printf( "precise: %ld sites, 1801-2099, lat -89..+89\n", nsites );
+      printf( "  __sunriset__           %8.3f s %10.0f sites/s\n",
+              base, nsites / base );
+
+      for ( j = 0; j < (int) ( sizeof tols / sizeof tols[0] ); j++ )
+      {
+            memset( &st, 0, sizeof st );
+            t0 = now();
+            for ( i = 0; i < nsites; i++ )
+                  __sunriset_precise__( p.year[i], p.month[i], p.day[i],
+                                        p.lon[i], p.lat[i], -35.0/60.0, 1,
+                                        tols[j], NULL, &st, &rise, &set );
+            t1 = now();
+            if ( tols[j] == PRECISE_TOL_PERL )
+                  printf( "  precise, tol Perl      " );
+            else
+                  printf( "  precise, tol %-8g  ", tols[j] );
+            printf( "%8.3f s %10.0f sites/s  x%.2f slower,"
+                    " %.2f positions/site\n",
+                    t1 - t0, nsites / ( t1 - t0 ), ( t1 - t0 ) / base,
+                    (double) st.evals / st.calls );
+            printf( "    iterations:" );
+            for ( k = 1; k <= PRECISE_MAXITER; k++ )
+                  printf( " %d:%ld", k, st.iter[k] );
+            printf( ", unconverged: %ld\n", st.unconverged );
+      }
+      pairs_free( &p );
+}
+
+
+/* Ephemeris benchmark: interpolation errors, speed and counters */
+
+static void bench_ephem( long nsites )
+{
+      static const double steps[] = { 1.0, 0.5, 0.25 };
+      struct sun_ephem eph;
+      struct ephem_reader er;
+      struct pairs p;
+      double dmin = days_since_2000_Jan_0(1801,1,1),
+             dmax = days_since_2000_Jan_0(2099,12,31) + 1.0;
+      double d, RA0, dec0, r0, RA1, dec1, r1, rise0, set0, rise1, set1;
+      double eRA, edec, er_, etime, t0, t1, t2, base;
+      long   i, j;
+
+      pairs_alloc( &p, nsites );
+      for ( i = 0; i < nsites; i++ )
+      {
+            p.year[i]  = 1801 + (int) uniform( 0.0, 299.0 );
+            p.month[i] = 1 + (int) uniform( 0.0, 12.0 );
+            p.day[i]   = 1 + (int) uniform( 0.0, 28.0 );
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.lat[i]   = uniform( -65.0, 65.0 );
+      }
+
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+            sun_RA_dec( dmin + ( dmax - dmin ) * i / nsites, &RA0, &dec0, &r0 );
+      t1 = now();
+      for ( i = 0; i < nsites; i++ )
+            __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i],
+                          -35.0/60.0, 1, &rise0, &set0 );
+      t2 = now();
+      base = t2 - t1;
+      printf( "ephem: %ld instants and sites, 1801-2099\n", nsites );
+      printf( "  sun_RA_dec                %8.3f s %10.0f calls/s\n",
+              t1 - t0, nsites / ( t1 - t0 ) );
+      printf( "  __sunriset__              %8.3f s %10.0f calls/s\n",
+              base, nsites / base );
+
+      for ( j = 0; j < (int) ( sizeof steps / sizeof steps[0] ); j++ )
+      {
+            t0 = now();
+            if ( sun_ephem_init( &eph, 1801, 2099, steps[j] ) != 0 )
+            {
+                  fprintf( stderr, "sunriset-bench: out of memory\n" );
+                  exit( 1 );
+            }
+            t1 = now();
+            printf( "  step %.2f day: %ld entries, %.1f MB, built in %.3f s\n",
+                    steps[j], eph.n, 3.0 * eph.n * sizeof(float) / 1e6,
+                    t1 - t0 );
+
+            /* Errors of the interpolation, over the whole table */
+            memset( &er, 0, sizeof er );
+            er.eph = &eph;
+            eRA = edec = er_ = 0.0;
+            for ( i = 0; i < nsites; i++ )
+            {
+                  d = uniform( dmin - 0.5, dmax + 0.5 );
+                  sun_RA_dec( d, &RA0, &dec0, &r0 );
+                  sun_RA_dec_ephem( &er, d, &RA1, &dec1, &r1 );
+                  if ( fabs( rev180( RA1 - RA0 ) ) > eRA )
+                        eRA = fabs( rev180( RA1 - RA0 ) );
+                  if ( fabs( dec1 - dec0 ) > edec )
+                        edec = fabs( dec1 - dec0 );
+                  if ( fabs( r1 - r0 ) > er_ )
+                        er_ = fabs( r1 - r0 );
+            }
+            printf( "    max error: RA %.1e, dec %.1e degrees, r %.1e AU\n",
+                    eRA, edec, er_ );
+
+            t0 = now();
+            for ( i = 0; i < nsites; i++ )
+                  sun_RA_dec_ephem( &er, dmin + ( dmax - dmin ) * i / nsites,
+                                    &RA1, &dec1, &r1 );
+            t1 = now();
+            printf( "    sun_RA_dec_ephem        %8.3f s %10.0f calls/s\n",
+                    t1 - t0, nsites / ( t1 - t0 ) );
+
+            /* Rise and set times */
+            etime = 0.0;
+            for ( i = 0; i < nsites; i++ )
+            {
+                  __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i],
+                                p.lat[i], -35.0/60.0, 1, &rise0, &set0 );
+                  __sunriset_ephem__( &er, p.year[i], p.month[i], p.day[i],
+                                      p.lon[i], p.lat[i], -35.0/60.0, 1,
+                                      &rise1, &set1 );
+                  if ( fabs( rise1 - rise0 ) > etime )
+                        etime = fabs( rise1 - rise0 );
+                  if ( fabs( set1 - set0 ) > etime )
+                        etime = fabs( set1 - set0 );
+            }
+            t0 = now();
+            for ( i = 0; i < nsites; i++ )
+                  __sunriset_ephem__( &er, p.year[i], p.month[i], p.day[i],
+                                      p.lon[i], p.lat[i], -35.0/60.0, 1,
+                                      &rise1, &set1 );
+            t1 = now();
+            printf( "    __sunriset_ephem__      %8.3f s %10.0f calls/s  x%.2f,"
+                    " max difference %.1e s\n",
+                    t1 - t0, nsites / ( t1 - t0 ), base / ( t1 - t0 ),
+                    3600.0 * etime );
+            printf( "    counters: %ld hits, %ld misses\n", er.hits, er.misses );
+            sun_ephem_free( &eph );
+      }
+      pairs_free( &p );
+}
+
+
+/* Almanac benchmark: whole-year tables, scaling with the threads */
+
+static void bench_almanac( long nsites )
+{
+      struct pairs p;
+      struct sun_ephem eph;
+      long   i, nout = SUNRISET_KINDS * almanac_days( 2024 ) * nsites;
+      int    nthreads, ncpu = (int) sysconf( _SC_NPROCESSORS_ONLN ), same;
+      double *rise0 = xmalloc( nout * sizeof(double) );
+      double *set0  = xmalloc( nout * sizeof(double) );
+      int    *rc0   = xmalloc( nout * sizeof(int) );
+      double *rise  = xmalloc( nout * sizeof(double) );
+      double *set   = xmalloc( nout * sizeof(double) );
+      int    *rc    = xmalloc( nout * sizeof(int) );
+      double t0, t1, base = 0.0;
+
+      pairs_alloc( &p, nsites );
+      for ( i = 0; i < nsites; i++ )
+      {
+            p.lon[i] = uniform( -180.0, 180.0 );
+            p.lat[i] = uniform( -89.0, 89.0 );
+      }
+      if ( sun_ephem_init( &eph, 2024, 2024, 1.0 ) != 0 )
+      {
+            fprintf( stderr, "sunriset-bench: out of memory\n" );
+            exit( 1 );
+      }
+
+      printf( "almanac: 2024, %ld sites, %d CPUs\n", nsites, ncpu );
+      for ( nthreads = 1; nthreads <= 2 * ncpu || nthreads <= 4; nthreads *= 2 )
+      {
+            t0 = now();
+            sunriset_almanac( 2024, nsites, p.lon, p.lat, nthreads, ISA_SCALAR,
+                              &eph, nthreads == 1 ? rise0 : rise,
+                              nthreads == 1 ? set0 : set,
+                              nthreads == 1 ? rc0 : rc );
+            t1 = now();
+            if ( nthreads == 1 )
+            {
+                  base = t1 - t0;
+                  same = 1;
+            }
+            else
+                  same = memcmp( rise0, rise, nout * sizeof(double) ) == 0
+                      && memcmp( set0, set, nout * sizeof(double) ) == 0
+                      && memcmp( rc0, rc, nout * sizeof(int) ) == 0;
+            printf( "  %2d threads %8.3f s %10.0f pairs/s  x%.2f  %s\n",
+                    nthreads, t1 - t0,
+                    almanac_days( 2024 ) * nsites / ( t1 - t0 ),
+                    base / ( t1 - t0 ), same ? "identical" : "DIFFERENT" );
+      }
+
+      sun_ephem_free( &eph );
+      pairs_free( &p );
+      free( rise0 ); free( set0 ); free( rc0 );
+      free( rise ); free( set ); free( rc );
+}
+
+
+/* Stream benchmark: records per second through sunriset_stream */
+
+static void bench_stream( long nrec )
+{
+      FILE   *in = tmpfile(), *null = fopen( "/dev/null", "wb" );
+      long   i, n;
+      int    year, month, day, k, rc[SUNRISET_KINDS];
+      double lon, lat, t0, t1, base, rise[SUNRISET_KINDS], set[SUNRISET_KINDS];
+      char   buf[128];
+
+      if ( in == NULL || null == NULL )
+      {
+            perror( "sunriset-bench" );
+            exit( 1 );
+      }
+      for ( i = 0; i < nrec; i++ )
+            fprintf( in, "%.5f %.5f %d %d %d\n", uniform( -89.0, 89.0 ),
+                     uniform( -180.0, 180.0 ), 1801 + (int) uniform( 0, 299 ),
+                     1 + (int) uniform( 0, 12 ), 1 + (int) uniform( 0, 28 ) );
+      printf( "stream: %ld records, %.1f MB of input\n", nrec, ftell( in ) / 1e6 );
+
+      /* The line-at-a-time way, as the interactive program does */
+      rewind( in );
+      t0 = now();
+      while ( fgets( buf, sizeof buf, in ) != NULL )
+      {
+            sscanf( buf, "%lf %lf %d %d %d", &lat, &lon, &year, &month, &day );
+            rc[0] = sun_rise_set( year, month, day, lon, lat, &rise[0], &set[0] );
+            rc[1] = civil_twilight( year, month, day, lon, lat, &rise[1], &set[1] );
+            rc[2] = nautical_twilight( year, month, day, lon, lat, &rise[2], &set[2] );
+            rc[3] = astronomical_twilight( year, month, day, lon, lat, &rise[3], &set[3] );
+            fprintf( null, "%.6f,%.6f,%d,%d,%d", lat, lon, year, month, day );
+            for ( k = 0; k < SUNRISET_KINDS; k++ )
+                  fprintf( null, ",%d,%.4f,%.4f", rc[k], rise[k], set[k] );
+            fputc( '\n', null );
+      }
+      t1 = now();
+      base = t1 - t0;
+      printf( "  fgets/sscanf/printf  %8.3f s %10.0f records/s\n",
+              base, nrec / base );
+
+      for ( k = STREAM_CSV; k <= STREAM_BINARY; k++ )
+      {
+            rewind( in );
+            t0 = now();
+            n = sunriset_stream( in, null, k );
+            t1 = now();
+            printf( "  sunriset_stream %-6s %8.3f s %10.0f records/s  x%.2f%s\n",
+                    k == STREAM_CSV ? "csv" : "binary", t1 - t0,
+                    n / ( t1 - t0 ), base / ( t1 - t0 ),
+                    n == nrec ? "" : "  RECORDS LOST" );
+      }
+      fclose( in );
+      fclose( null );
+}
+
+
+/* Almanac file benchmark: lookups per second, and the interpolation */
+/* errors against __sunriset__, by band of latitude                  */
+
+static int cmp_double( const void *a, const void *b )
+{
+      double x = *(const double *) a, y = *(const double *) b;
+      return x < y ? -1 : x > y;
+}
+
+static void bench_almfile( long nlook )
+{
+      static const double band_lat[] = { 0.0, 45.0, 60.0, 80.0 };
+      char   path[] = "/tmp/sunriset-bench-XXXXXX";
+      struct almanac_file af;
+      struct pairs p;
+      double *err[3], t0, t1, rise, set, r0, s0, e, sink = 0.0;
+      long   nerr[3] = { 0, 0, 0 }, i;
+      int    fd, b, k, rc, rc0, nsame = 0, nrc = 0;
+
+      if ( ( fd = mkstemp( path ) ) < 0 )
+      {
+            perror( "sunriset-bench" );
+            exit( 1 );
+      }
+      close( fd );
+      t0 = now();
+      if ( almanac_write( path, 2024, 2024, -80.0, 1.0, 161,
+                          -180.0, 1.0, 360, 1 ) != 0
+           || almanac_open( &af, path ) != 0 )
+      {
+            perror( path );
+            unlink( path );
+            exit( 1 );
+      }
+      t1 = now();
+      printf( "almfile: 2024, 1 degree grid, -80..80, %.1f MB, built in %.2f s\n",
+              af.size / 1e6, t1 - t0 );
+
+      pairs_alloc( &p, nlook );
+      for ( i = 0; i < nlook; i++ )
+      {
+            p.lat[i]   = uniform( -80.0, 80.0 );
+            p.lon[i]   = uniform( -179.0, 179.0 );
+            p.year[i]  = 2024;
+            p.month[i] = 1 + (int) uniform( 0, 12 );
+            p.day[i]   = 1 + (int) uniform( 0, 28 );
+      }
+
+      /* Pass 0 maps the pages of the file.  Random dates read all */
+      /* over the file; one date reads one slice of it              */
+      for ( b = 0; b < 3; b++ )
+      {
+            t0 = now();
+            for ( i = 0; i < nlook; i++ )
+            {
+                  almanac_lookup( &af, p.year[i], b < 2 ? p.month[i] : 6,
+                                  b < 2 ? p.day[i] : 21, p.lon[i], p.lat[i],
+                                  i % SUNRISET_KINDS, &rise, &set );
+                  sink += rise;
+            }
+            t1 = now();
+            if ( b > 0 )
+                  printf( "  almanac_lookup %8.3f s %12.0f lookups/s  (%s)\n",
+                          t1 - t0, nlook / ( t1 - t0 ),
+                          b == 1 ? "random dates" : "one date" );
+      }
+      t0 = now();
+      for ( i = 0; i < nlook; i++ )
+      {
+            k = i % SUNRISET_KINDS;
+            __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i],
+                          batch_altit[k], batch_upper_limb[k], &rise, &set );
+            sink += rise;
+      }
+      t1 = now();
+      printf( "  __sunriset__   %8.3f s %12.0f calls/s\n",
+              t1 - t0, nlook / ( t1 - t0 ) );
+
+      for ( b = 0; b < 3; b++ )
+            err[b] = xmalloc( nlook * sizeof(double) );
+      for ( i = 0; i < nlook; i++ )
+      {
+            k   = i % SUNRISET_KINDS;
+            rc  = almanac_lookup( &af, p.year[i], p.month[i], p.day[i],
+                                  p.lon[i], p.lat[i], k, &rise, &set );
+            rc0 = __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i],
+                                p.lat[i], batch_altit[k], batch_upper_limb[k],
+                                &r0, &s0 );
+            nsame += rc == rc0;
+            if ( rc != 0 || rc0 != 0 )
+                  continue;
+            nrc++;
+            /* Near the date line, the same instants 24 hours apart */
+            e = fmax( fabs( remainder( rise - r0, 24.0 ) ),
+                      fabs( remainder( set - s0, 24.0 ) ) ) * 3600.0;
+            for ( b = 0; fabs( p.lat[i] ) >= band_lat[b+1] && b < 2; b++ )
+                  ;
+            err[b][nerr[b]++] = e;
+      }
+      printf( "  same rc as __sunriset__: %.4f%%, errors in seconds (rc 0):\n",
+              100.0 * nsame / nlook );
+      for ( b = 0; b < 3; b++ )
+      {
+            if ( nerr[b] == 0 )
+                  continue;
+            qsort( err[b], nerr[b], sizeof(double), cmp_double );
+            printf( "    |lat| %2.0f..%2.0f  median %6.2f  99%% %7.2f  max %8.2f\n",
+                    band_lat[b], band_lat[b+1], err[b][nerr[b]/2],
+                    err[b][(long) ( nerr[b] * 0.99 )], err[b][nerr[b]-1] );
+            free( err[b] );
+      }
+      if ( sink == 0.0 )
+            printf( "\n" );
+
+      pairs_free( &p );
+      almanac_close( &af );
+      unlink( path );
+}
+
+/* Fused benchmark: sunriset_altitudes against one __sunriset__ and */
+/* one __daylen__ call per altitude                                 */
+
+static void bench_fused_1( const char *label, const struct pairs *p, int n,
+                           const double *altit, const int *upper_limb )
+{
+      double rise[8], set[8], len[8], r0, s0, l0, t0, t1, t2, sink = 0.0;
+      long   i, diff = 0;
+      int    k, rc[8];
+
+      for ( i = 0; i < p->n; i++ )
+      {
+            sunriset_altitudes( p->year[i], p->month[i], p->day[i], p->lon[i],
+                                p->lat[i], n, altit, upper_limb,
+                                rise, set, rc, len );
+            for ( k = 0; k < n; k++ )
+            {
+                  diff += __sunriset__( p->year[i], p->month[i], p->day[i],
+                                        p->lon[i], p->lat[i], altit[k],
+                                        upper_limb[k], &r0, &s0 ) != rc[k]
+                          || r0 != rise[k] || s0 != set[k];
+                  l0 = __daylen__( p->year[i], p->month[i], p->day[i],
+                                   p->lon[i], p->lat[i], altit[k], upper_limb[k] );
+                  diff += l0 != len[k];
+            }
+      }
+
+      t0 = now();
+      for ( i = 0; i < p->n; i++ )
+            for ( k = 0; k < n; k++ )
+            {
+                  __sunriset__( p->year[i], p->month[i], p->day[i], p->lon[i],
+                                p->lat[i], altit[k], upper_limb[k], &r0, &s0 );
+                  sink += r0 + __daylen__( p->year[i], p->month[i], p->day[i],
+                                           p->lon[i], p->lat[i], altit[k],
+                                           upper_limb[k] );
+            }
+      t1 = now();
+      for ( i = 0; i < p->n; i++ )
+      {
+            sunriset_altitudes( p->year[i], p->month[i], p->day[i], p->lon[i],
+                                p->lat[i], n, altit, upper_limb,
+                                rise, set, rc, len );
+            sink += rise[0] + len[0];
+      }
+      t2 = now();
+
+      printf( "  %s, %d altitudes: %ld differences\n", label, n, diff );
+      printf( "    %2d calls          %8.3f s %10.0f days/s\n",
+              2 * n, t1 - t0, p->n / ( t1 - t0 ) );
+      printf( "    sunriset_altitudes %8.3f s %10.0f days/s  x%.2f\n",
+              t2 - t1, p->n / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ) );
+      if ( sink == 0.0 )
+            printf( "\n" );
+}
+
+static void bench_fused( long npairs )
+{
+      /* The 8 calls of the sunriset program */
+      static const double c_altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const int    c_upper[4] = { 1, 0, 0, 0 };
+      /* The constants of Astro::Sunrise, and a custom altitude */
+      static const double perl_altit[6] = { ALTIT_DEFAULT, ALTIT_CIVIL,
+                                            ALTIT_NAUTICAL, ALTIT_AMATEUR,
+                                            ALTIT_ASTRONOMICAL, -3.0 };
+      static const int    perl_upper[6] = { 0, 0, 0, 0, 0, 1 };
+      struct pairs p;
+      long   i;
+
+      pairs_alloc( &p, npairs );
+      for ( i = 0; i < npairs; i++ )
+      {
+            p.lat[i]   = uniform( -89.0, 89.0 );
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.year[i]  = 1801 + (int) uniform( 0, 299 );
+            p.month[i] = 1 + (int) uniform( 0, 12 );
+            p.day[i]   = 1 + (int) uniform( 0, 28 );
+      }
+      printf( "fused: %ld days, rise/set and day length per altitude\n", npairs );
+      bench_fused_1( "sunriset program", &p, 4, c_altit, c_upper );
+      bench_fused_1( "Astro::Sunrise constants + 1", &p, 6, perl_altit, perl_upper );
+      pairs_free( &p );
+}
+
+
+/* Sweep benchmark: a year per site with sunriset_year, against      */
+/* __sunriset__ for every day, and the drift between resyncs         */
+
+static void bench_sweep( long nsites )
+{
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const int    resyncs[4] = { 1, 8, SWEEP_RESYNC, 366 };
+      struct sunriset_sweep sw;
+      double *lon, *lat, rise[366], set[366], r0, s0, err, t0, t1, t2,
+             sink = 0.0;
+      int    *year, *kind, rc[366], rc0, n, k, j;
+      long   i, rcdiff;
+      double maxerr;
+
+      lon  = xmalloc( nsites * sizeof *lon );
+      lat  = xmalloc( nsites * sizeof *lat );
+      year = xmalloc( nsites * sizeof *year );
+      kind = xmalloc( nsites * sizeof *kind );
+      for ( i = 0; i < nsites; i++ )
+      {
+            lat[i]  = uniform( -89.0, 89.0 );
+            lon[i]  = uniform( -180.0, 180.0 );
+            year[i] = 1801 + (int) uniform( 0, 299 );
+            kind[i] = (int) uniform( 0, 4 );
+      }
+      printf( "sweep: %ld (site, year) pairs, every day of the year\n", nsites );
+
+      /* Drift against __sunriset__, by resynchronization interval */
+      for ( j = 0; j < 4; j++ )
+      {
+            maxerr = 0.0;
+            rcdiff = 0;
+            for ( i = 0; i < nsites; i++ )
+            {
+                  sunriset_sweep_init( &sw, year[i], 1, 1, lon[i], lat[i],
+                                       altit[kind[i]], kind[i] == 0 );
+                  sw.resync = resyncs[j];
+                  n = almanac_days( year[i] );
+                  for ( k = 0; k < n; k++ )
+                  {
+                        rc[0] = sunriset_sweep_next( &sw, &rise[0], &set[0] );
+                        rc0 = __sunriset__( year[i], 1, 1 + k, lon[i], lat[i],
+                                            altit[kind[i]], kind[i] == 0,
+                                            &r0, &s0 );
+                        rcdiff += rc[0] != rc0;
+                        err = fmax( fabs( rise[0] - r0 ), fabs( set[0] - s0 ) );
+                        if ( rc[0] == rc0 && err > maxerr )
+                              maxerr = err;
+                  }
+            }
+            printf( "  resync every %3d days: max error %.2e hours (%.3f us),"
+                    " %ld return codes differ\n", resyncs[j], maxerr,
+                    maxerr * 3.6e9, rcdiff );
+      }
+
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+      {
+            n = almanac_days( year[i] );
+            for ( k = 0; k < n; k++ )
+            {
+                  __sunriset__( year[i], 1, 1 + k, lon[i], lat[i],
+                                altit[kind[i]], kind[i] == 0, &r0, &s0 );
+                  sink += r0;
+            }
+      }
+      t1 = now();
+      for ( i = 0; i < nsites; i++ )
+      {
+            sunriset_year( year[i], lon[i], lat[i], altit[kind[i]],
+                           kind[i] == 0, rise, set, rc );
+            sink += rise[0];
+      }
+      t2 = now();
+      printf( "    __sunriset__  %8.3f s %10.0f years/s\n",
+              t1 - t0, nsites / ( t1 - t0 ) );
+      printf( "    sunriset_year %8.3f s %10.0f years/s  x%.2f\n",
+              t2 - t1, nsites / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ) );
+      if ( sink == 0.0 )
+            printf( "\n" );
+
+      free( lon ); free( lat ); free( year ); free( kind );
+}
+
+
+/* Single precision benchmark: __sunriset_float__ against __sunriset__, */
+/* for every latitude from -89 to 89 degrees, every daystep days of      */
+/* 1801-2099 (every day by default) and the 4 kinds, by latitude band    */
+/* and by the margin of cost (double) to +-1; then at given distances    */
+/* from the polar edge, the latitude where __sunriset__ starts returning */
+/* +-1, found by bisection for random dates; then timed on random pairs; */
+/* then sunriset_arcs_float against sunriset_arcs, whose vectors hold    */
+/* twice as many floats as doubles, for each instruction set             */
+
+#define FLOAT_BANDS    7
+#define FLOAT_MARGINS  6
+#define FLOAT_EDGES    6
+
+struct float_tally
+{
+      long   n, within, minutes, rcdiff;
+      double maxerr;
+};
+
+static void float_tally_add( struct float_tally *ft, int rcdiff, double err,
+                             double r0, double s0, double r1, double s1 )
+{
+      ft->n++;
+      if ( rcdiff )
+      {
+            ft->rcdiff++;
+            return;
+      }
+      ft->within += err <= 30.0;
+      ft->minutes += floor( r0 * 60 + 0.5 ) != floor( r1 * 60 + 0.5 )
+                  || floor( s0 * 60 + 0.5 ) != floor( s1 * 60 + 0.5 );
+      if ( err > ft->maxerr )
+            ft->maxerr = err;
+}
+
+static void float_tally_print( const char *label, const struct float_tally *ft )
+{
+      if ( ft->n == 0 )
+            return;
+      printf( "  %-16s %9ld  %9.3f s  %8.4f %%  %8.4f %%  %6ld\n", label, ft->n,
+              ft->maxerr, 100.0 * ft->within / ft->n,
+              100.0 * ft->minutes / ft->n, ft->rcdiff );
+}
+
+/* Latitude, between 0 and 89.9, where the return code of __sunriset__ */
+/* changes, -1 if none                                                   */
+static double float_edge( int year, int month, int day, double lon,
+                          double altit, int upper_limb )
+{
+      double lo = 0.0, hi = 89.9, mid, r, s;
+      int    rc_lo, j;
+
+      rc_lo = __sunriset__( year, month, day, lon, lo, altit, upper_limb, &r, &s );
+      if ( __sunriset__( year, month, day, lon, hi, altit, upper_limb, &r, &s )
+           == rc_lo )
+            return -1.0;
+      for ( j = 0; j < 60; j++ )
+      {
+            mid = 0.5 * ( lo + hi );
+            if ( __sunriset__( year, month, day, lon, mid, altit, upper_limb,
+                               &r, &s ) == rc_lo )
+                  lo = mid;
+            else
+                  hi = mid;
+      }
+      return lo;
+}
+
+static void float_edges( long nedges )
+{
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const double delta[FLOAT_EDGES] = { 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, 1e-2 };
+      struct float_tally edge[FLOAT_EDGES];
+      double lat, r0, s0, r1, s1;
+      int    year, month, day, k, j, side, rc0, rc1;
+      long   i;
+      char   label[32];
+
+      memset( edge, 0, sizeof edge );
+      for ( i = 0; i < nedges; i++ )
+      {
+            year  = 1801 + (int) uniform( 0, 299 );
+            month = 1 + (int) uniform( 0, 12 );
+            day   = 1 + (int) uniform( 0, 28 );
+            k     = (int) uniform( 0, 4 );
+            if ( ( lat = float_edge( year, month, day, 0.0, altit[k], k == 0 ) ) < 0.0 )
+                  continue;
+            for ( j = 0; j < FLOAT_EDGES; j++ )
+                  for ( side = -1; side <= 1; side += 2 )
+                  {
+                        rc0 = __sunriset__( year, month, day, 0.0,
+                                            lat + side * delta[j], altit[k],
+                                            k == 0, &r0, &s0 );
+                        rc1 = __sunriset_float__( year, month, day, 0.0,
+                                                  lat + side * delta[j], altit[k],
+                                                  k == 0, &r1, &s1 );
+                        float_tally_add( &edge[j], rc0 != rc1, 3600.0 *
+                                         fmax( fabs( r1 - r0 ), fabs( s1 - s0 ) ),
+                                         r0, s0, r1, s1 );
+                  }
+      }
+      for ( j = 0; j < FLOAT_EDGES; j++ )
+      {
+            snprintf( label, sizeof label, "edge +-%g deg", delta[j] );
+            float_tally_print( label, &edge[j] );
+      }
+}
+
+/* sunriset_arcs_float against sunriset_arcs: speed for each ISA, and */
+/* errors against the scalar double results                           */
+static void float_arcs( long n )
+{
+      static const double altit[4] = { -35.0/60.0 - 0.2666, -6.0, -12.0, -18.0 };
+      double *lat = xmalloc( n * sizeof(double) ), *sdec = xmalloc( n * sizeof(double) ),
+             *alt = xmalloc( n * sizeof(double) ), *south = xmalloc( n * sizeof(double) ),
+             *r0 = xmalloc( n * sizeof(double) ), *s0 = xmalloc( n * sizeof(double) ),
+             *r1 = xmalloc( n * sizeof(double) ), *s1 = xmalloc( n * sizeof(double) );
+      float  *latf = xmalloc( n * sizeof(float) ), *sdecf = xmalloc( n * sizeof(float) ),
+             *altf = xmalloc( n * sizeof(float) ), *southf = xmalloc( n * sizeof(float) ),
+             *rf = xmalloc( n * sizeof(float) ), *sf = xmalloc( n * sizeof(float) );
+      int    *rc0 = xmalloc( n * sizeof(int) ), *rc1 = xmalloc( n * sizeof(int) );
+      int    isa, best = sunriset_isa(), rep, nrep = 10;
+      struct float_tally ft;
+      double t0, t1, t2;
+      long   i;
+
+      for ( i = 0; i < n; i++ )
+      {
+            lat[i]   = uniform( -90.0, 90.0 );
+            sdec[i]  = uniform( -23.44, 23.44 );
+            alt[i]   = altit[(int) uniform( 0.0, 4.0 )];
+            south[i] = uniform( 0.0, 24.0 );
+            latf[i]  = (float) lat[i];
+            sdecf[i] = (float) sdec[i];
+            altf[i]  = (float) alt[i];
+            southf[i] = (float) south[i];
+      }
+      sunriset_arcs( ISA_SCALAR, n, lat, sdec, alt, south, r0, s0, rc0 );
+      printf( "float: sunriset_arcs_float against sunriset_arcs, %ld sites\n", n );
+      printf( "  %-8s %12s %12s %7s %11s %9s %6s\n", "", "double/s",
+              "float/s", "", "max error", "<= 30 s", "rc" );
+      for ( isa = ISA_SCALAR; isa <= best; isa++ )
+      {
+            t0 = now();
+            for ( rep = 0; rep < nrep; rep++ )
+                  sunriset_arcs( isa, n, lat, sdec, alt, south, r1, s1, rc1 );
+            t1 = now();
+            for ( rep = 0; rep < nrep; rep++ )
+                  sunriset_arcs_float( isa, n, latf, sdecf, altf, southf,
+                                       rf, sf, rc1 );
+            t2 = now();
+
+            /* The float inputs are rounded: the errors include that */
+            memset( &ft, 0, sizeof ft );
+            for ( i = 0; i < n; i++ )
+                  float_tally_add( &ft, rc0[i] != rc1[i], 3600.0 *
+                                   fmax( fabs( rf[i] - r0[i] ), fabs( sf[i] - s0[i] ) ),
+                                   r0[i], s0[i], rf[i], sf[i] );
+            printf( "  %-8s %12.0f %12.0f  x%.2f %9.3f s  %7.4f %%  %6ld\n",
+                    isa_name[isa], nrep * n / ( t1 - t0 ), nrep * n / ( t2 - t1 ),
+                    ( t1 - t0 ) / ( t2 - t1 ), ft.maxerr,
+                    ft.n > ft.rcdiff ? 100.0 * ft.within / ( ft.n - ft.rcdiff ) : 0.0,
+                    ft.rcdiff );
+      }
+      free( lat ); free( sdec ); free( alt ); free( south );
+      free( r0 ); free( s0 ); free( r1 ); free( s1 );
+      free( latf ); free( sdecf ); free( altf ); free( southf );
+      free( rf ); free( sf ); free( rc0 ); free( rc1 );
+}
+
+static void bench_float( int daystep )
+{
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const double band_hi[FLOAT_BANDS] = { 30, 50, 60, 66, 70, 80, 90 };
+      static const double margin_hi[FLOAT_MARGINS] = { 1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 3 };
+      static const char *band_name[FLOAT_BANDS] = { "|lat| < 30", "30 - 50", "50 - 60",
+            "60 - 66", "66 - 70", "70 - 80", "80 - 89" };
+      static const char *margin_name[FLOAT_MARGINS] = { "margin < 1e-6",
+            "1e-6 - 1e-5", "1e-5 - 1e-4", "1e-4 - 1e-3", "1e-3 - 1e-2", ">= 1e-2" };
+      struct float_tally band[FLOAT_BANDS], margin[FLOAT_MARGINS], all, polar;
+      struct pairs p;
+      long   d0 = days_since_2000_Jan_0( 1801, 1, 1 ),
+             d1 = days_since_2000_Jan_0( 2099, 12, 31 ), dd, i, n = 200000;
+      int    lat, k, b, m, rc0, rc1;
+      double r0, s0, r1, s1, err, sRA, sdec, sr, a, cost, t0, t1, t2,
+             sink = 0.0;
+
+      memset( band, 0, sizeof band );
+      memset( margin, 0, sizeof margin );
+      memset( &all, 0, sizeof all );
+      memset( &polar, 0, sizeof polar );
+      if ( daystep < 1 )
+            daystep = 1;
+      printf( "float: __sunriset_float__ against __sunriset__, latitudes -89..89,"
+              " 1801-2099 every %d days, 4 kinds\n", daystep );
+
+      for ( lat = -89; lat <= 89; lat++ )
+      {
+            for ( b = 0; abs( lat ) >= band_hi[b]; b++ )
+                  ;
+            for ( dd = d0; dd <= d1; dd += daystep )
+                  for ( k = 0; k < 4; k++ )
+                  {
+                        /* Day 1 + dd - d0 of January 1801: mktime-free */
+                        rc0 = __sunriset__( 1801, 1, 1 + dd - d0, 0.0, lat,
+                                            altit[k], k == 0, &r0, &s0 );
+                        rc1 = __sunriset_float__( 1801, 1, 1 + dd - d0, 0.0, lat,
+                                                  altit[k], k == 0, &r1, &s1 );
+                        err = 3600.0 * fmax( fabs( r1 - r0 ), fabs( s1 - s0 ) );
+
+                        /* The margin of cost, as __sunriset__ computes it */
+                        if ( k == 0 )
+                              sun_RA_dec( dd + 0.5, &sRA, &sdec, &sr );
+                        a = k == 0 ? altit[k] - 0.2666 / sr : altit[k];
+                        cost = ( sind(a) - sind(lat) * sind(sdec) ) /
+                               ( cosd(lat) * cosd(sdec) );
+                        for ( m = 0; fmin( fabs( 1.0 - cost ), fabs( 1.0 + cost ) )
+                                     >= margin_hi[m]; m++ )
+                              ;
+
+                        float_tally_add( &all, rc0 != rc1, err, r0, s0, r1, s1 );
+                        float_tally_add( &band[b], rc0 != rc1, err, r0, s0, r1, s1 );
+                        if ( rc0 == 0 || rc1 == 0 )
+                              float_tally_add( &margin[m], rc0 != rc1, err,
+                                               r0, s0, r1, s1 );
+                        else
+                              float_tally_add( &polar, rc0 != rc1, err,
+                                               r0, s0, r1, s1 );
+                  }
+      }
+      printf( "  %-16s %9s  %11s  %10s  %10s  %6s\n", "", "pairs", "max error",
+              "<= 30 s", "minute", "rc" );
+      float_tally_print( "all", &all );
+      for ( b = 0; b < FLOAT_BANDS; b++ )
+            float_tally_print( band_name[b], &band[b] );
+      for ( m = 0; m < FLOAT_MARGINS; m++ )
+            float_tally_print( margin_name[m], &margin[m] );
+      float_tally_print( "polar day/night", &polar );
+      float_edges( 20000 );
+
+      pairs_alloc( &p, n );
+      for ( i = 0; i < n; i++ )
+      {
+            p.lat[i]   = uniform( -89.0, 89.0 );
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.year[i]  = 1801 + (int) uniform( 0, 299 );
+            p.month[i] = 1 + (int) uniform( 0, 12 );
+            p.day[i]   = 1 + (int) uniform( 0, 28 );
+      }
+      t0 = now();
+      for ( i = 0; i < n; i++ )
+      {
+            __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i],
+                          -35.0/60.0, 1, &r0, &s0 );
+            sink += r0;
+      }
+      t1 = now();
+      for ( i = 0; i < n; i++ )
+      {
+            __sunriset_float__( p.year[i], p.month[i], p.day[i], p.lon[i],
+                                p.lat[i], -35.0/60.0, 1, &r1, &s1 );
+            sink += r1;
+      }
+      t2 = now();
+      printf( "    __sunriset__        %8.3f s %10.0f calls/s\n",
+              t1 - t0, n / ( t1 - t0 ) );
+      printf( "    __sunriset_float__  %8.3f s %10.0f calls/s  x%.2f\n",
+              t2 - t1, n / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ) );
+      if ( sink == 0.0 )
+            printf( "\n" );
+      pairs_free( &p );
+      float_arcs( 1L << 20 );
+}
+
+
+/* Timeline benchmark: polar_timeline against the return codes of */
+/* __sunriset__ for every day, for high latitude sites             */
+
+/* The intervals of one site, from __sunriset__ for every day */
+static void timeline_brute( struct timeline_arena *a, int year, double lon,
+                            double lat, int nkinds, const double *altit,
+                            const int *upper_limb )
+{
+      struct timeline_interval iv;
+      double rise, set;
+      int    n = almanac_days( year ), k, day, rc, prev;
+
+      for ( k = 0; k < nkinds; k++ )
+            for ( day = 0, prev = 0; day <= n; day++ )
+            {
+                  rc = day < n ? __sunriset__( year, 1, 1 + day, lon, lat,
+                                               altit[k], upper_limb[k],
+                                               &rise, &set )
+                               : 0;
+                  if ( rc == prev )
+                        continue;
+                  if ( prev != 0 )
+                  {
+                        a->iv[a->n-1].last = (short) ( day - 1 );
+                  }
+                  if ( rc != 0 )
+                  {
+                        iv.first = iv.last = (short) day;
+                        iv.kind = (signed char) k;
+                        iv.rc = (signed char) rc;
+                        if ( a->n == a->cap )
+                        {
+                              a->cap *= 2;
+                              a->iv = realloc( a->iv, a->cap * sizeof *a->iv );
+                              if ( a->iv == NULL )
+                              {
+                                    fprintf( stderr, "sunriset-bench: out of memory\n" );
+                                    exit( 1 );
+                              }
+                        }
+                        a->iv[a->n++] = iv;
+                  }
+                  prev = rc;
+            }
+}
+
+static void bench_timeline( long nsites )
+{
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const int    upper_limb[4] = { 1, 0, 0, 0 };
+      struct timeline_arena a0, a1;
+      double *lon = xmalloc( nsites * sizeof *lon ),
+             *lat = xmalloc( nsites * sizeof *lat ), t0, t1, t2;
+      long   *first = xmalloc( ( nsites + 1 ) * sizeof *first ),
+             *first0 = xmalloc( ( nsites + 1 ) * sizeof *first0 ), i, diff = 0;
+      int    year = 1801 + (int) uniform( 0, 299 );
+
+      for ( i = 0; i < nsites; i++ )
+      {
+            lat[i] = uniform( 50.0, 89.9 ) * ( uniform( 0, 1 ) < 0.5 ? -1 : 1 );
+            lon[i] = uniform( -180.0, 180.0 );
+      }
+      if ( timeline_arena_init( &a0, 1024 ) != 0
+           || timeline_arena_init( &a1, 1024 ) != 0 )
+      {
+            fprintf( stderr, "sunriset-bench: out of memory\n" );
+            exit( 1 );
+      }
+      printf( "timeline: %d, %ld sites with 50 <= |lat| <= 89.9, 4 kinds\n",
+              year, nsites );
+
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+      {
+            first0[i] = a0.n;
+            timeline_brute( &a0, year, lon[i], lat[i], 4, altit, upper_limb );
+      }
+      first0[nsites] = a0.n;
+      t1 = now();
+      if ( polar_timeline( &a1, year, nsites, lon, lat, 4, altit, upper_limb,
+                           first ) < 0 )
+      {
+            fprintf( stderr, "sunriset-bench: out of memory\n" );
+            exit( 1 );
+      }
+      t2 = now();
+
+      for ( i = 0; i < nsites; i++ )
+            if ( first[i+1] - first[i] != first0[i+1] - first0[i]
+                 || memcmp( a1.iv + first[i], a0.iv + first0[i],
+                            ( first[i+1] - first[i] ) * sizeof *a1.iv ) != 0 )
+                  diff++;
+      printf( "  %ld intervals, %ld sites differ from __sunriset__,"
+              " %.1f positions per site and kind, arena of %ld bytes\n",
+              a1.n, diff, (double) a1.evals / ( 4 * nsites ),
+              a1.cap * (long) sizeof *a1.iv );
+      printf( "    every day       %8.3f s %10.0f sites/s\n",
+              t1 - t0, nsites / ( t1 - t0 ) );
+      printf( "    polar_timeline  %8.3f s %10.0f sites/s  x%.2f\n",
+              t2 - t1, nsites / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ) );
+
+      timeline_arena_free( &a0 );
+      timeline_arena_free( &a1 );
+      free( lon ); free( lat ); free( first ); free( first0 );
+}
+
+
+/* Raster benchmark: a global grid of step x step degree cells, by */
+/* __daylen__ and __sunriset__ per cell, then by sunriset_raster_   */
+/* tiles with each instruction set, then through a raster file      */
+
+static void bench_raster( double step )
+{
+      struct sunriset_raster r;
+      struct raster_file rf;
+      const int year = 2024, month = 6, day = 21;
+      const double altit = -35.0/60.0, lat0 = -90.0 + step / 2,
+                   lon0 = -180.0 + step / 2;
+      int    nlat = (int) floor( 180.0 / step + 0.5 ),
+             nlon = (int) floor( 360.0 / step + 0.5 ), isa, top = sunriset_isa();
+      long   ncells = (long) nlat * nlon, i, j, k, idx, per_layer, diff;
+      float  *ref_rise = xmalloc( ncells * sizeof(float) ),
+             *ref_set  = xmalloc( ncells * sizeof(float) ),
+             *ref_len  = xmalloc( ncells * sizeof(float) ),
+             *ref_int  = xmalloc( ncells * sizeof(float) ), *out;
+      double rise, set, len, t0, t1, t_daylen, t_sunriset, err, maxerr,
+             maxlen, v;
+      int    rc, polar;
+      char   path[] = "/tmp/sunriset-bench-XXXXXX";
+      static const char *isa_name[] = { "scalar", "sse2", "avx2", "avx512" };
+
+      printf( "raster: %04d-%02d-%02d, %d x %d cells of %g degree,"
+              " %.2f megapixels\n", year, month, day, nlat, nlon, step,
+              ncells / 1e6 );
+
+      /* One call per cell, the way maps are drawn today */
+      t0 = now();
+      for ( i = 0; i < nlat; i++ )
+            for ( j = 0; j < nlon; j++ )
+                  ref_len[i * nlon + j] = (float) day_length( year, month, day,
+                                                              lon0 + j * step,
+                                                              lat0 + i * step );
+      t1 = now();
+      t_daylen = t1 - t0;
+      maxlen = 0.0;
+      t0 = now();
+      for ( i = 0; i < nlat; i++ )
+            for ( j = 0; j < nlon; j++ )
+            {
+                  idx = i * nlon + j;
+                  sun_rise_set( year, month, day, lon0 + j * step,
+                                lat0 + i * step, &rise, &set );
+                  ref_rise[idx] = (float) rise;
+                  ref_set[idx]  = (float) set;
+                  ref_int[idx]  = (float) ( set - rise );
+                  /* __daylen__ against the interval of __sunriset__ */
+                  err = fabs( ( set - rise ) - ref_len[idx] );
+                  if ( err > maxlen )
+                        maxlen = err;
+            }
+      t1 = now();
+      t_sunriset = t1 - t0;
+      printf( "    __daylen__ per cell    %8.3f s %8.2f Mpix/s\n",
+              t_daylen, ncells / t_daylen / 1e6 );
+      printf( "    __sunriset__ per cell  %8.3f s %8.2f Mpix/s\n",
+              t_sunriset, ncells / t_sunriset / 1e6 );
+      printf( "    (__daylen__ and set - rise of __sunriset__ differ by at"
+              " most %.2g s, float rounding)\n", 3600 * maxlen );
+
+      for ( isa = ISA_SCALAR; isa <= top; isa++ )
+      {
+            int layers[2] = { RASTER_DAYLEN,
+                              RASTER_RISE | RASTER_SET | RASTER_DAYLEN };
+            for ( k = 0; k < 2; k++ )
+            {
+                  if ( sunriset_raster_init( &r, year, month, day, altit, 1,
+                                             lat0, step, nlat, lon0, step,
+                                             nlon, layers[k], isa ) != 0 )
+                        break;
+                  per_layer = (long) r.ntlat * r.ntlon * RASTER_TILE * RASTER_TILE;
+                  out = xmalloc( ( k ? 3 : 1 ) * per_layer * sizeof(float) );
+                  t0 = now();
+                  sunriset_raster_tiles( &r, 0, r.ntlat, out );
+                  t1 = now();
+
+                  /* Against __sunriset__ rounded to float: rise, set, */
+                  /* and the day length from the same computation      */
+                  diff = polar = 0;
+                  maxerr = 0.0;
+                  for ( i = 0; i < nlat; i++ )
+                        for ( j = 0; j < nlon; j++ )
+                        {
+                              float *lay = out;
+                              idx = sunriset_raster_index( &r, i, j );
+                              if ( k )
+                              {
+                                    err = fabs( out[idx] - ref_rise[i * nlon + j] );
+                                    err = fmax( err, fabs( out[per_layer + idx]
+                                                           - ref_set[i * nlon + j] ) );
+                                    lay = out + 2 * per_layer;
+                              }
+                              else
+                                    err = 0.0;
+                              len = ref_int[i * nlon + j];
+                              err = fmax( err, fabs( lay[idx] - len ) );
+                              diff += err > 0.0;
+                              polar += ( lay[idx] <= 0.0f || lay[idx] >= 24.0f )
+                                       != ( len <= 0.0 || len >= 24.0 );
+                              if ( err > maxerr )
+                                    maxerr = err;
+                        }
+                  printf( "    raster %-6s %-11s %8.3f s %8.2f Mpix/s  x%5.1f"
+                          "  %ld cells differ, max %.2g s, %d polar\n",
+                          isa_name[isa], k ? "3 layers" : "day length",
+                          t1 - t0, ncells / ( t1 - t0 ) / 1e6,
+                          ( k ? t_sunriset : t_daylen ) / ( t1 - t0 ),
+                          diff, 3600 * maxerr, polar );
+
+                  /* Through a file, with the widest instruction set */
+                  if ( k && isa == top )
+                  {
+                        int fd = mkstemp( path );
+                        if ( fd < 0 )
+                        {
+                              perror( path );
+                              exit( 1 );
+                        }
+                        close( fd );
+                        t0 = now();
+                        if ( raster_write( path, year, month, day, altit, 1,
+                                           lat0, step, nlat, lon0, step, nlon,
+                                           layers[k] ) != 0
+                             || raster_open( &rf, path ) != 0 )
+                        {
+                              perror( path );
+                              unlink( path );
+                              exit( 1 );
+                        }
+                        t1 = now();
+                        diff = 0;
+                        for ( i = 0; i < 100000; i++ )
+                        {
+                              long ci = (long) uniform( 0, nlat ),
+                                   cj = (long) uniform( 0, nlon );
+                              idx = sunriset_raster_index( &r, ci, cj );
+                              for ( rc = 0; rc < RASTER_NLAYERS; rc++ )
+                                    if ( raster_cell( &rf, 1 << rc, ci, cj, &v ) != 0
+                                         || v != out[rc * per_layer + idx] )
+                                          diff++;
+                        }
+                        printf( "    raster_write %s     %8.3f s %8.1f MB/s,"
+                                " %ld of 300000 cells read back differ\n",
+                                isa_name[isa], t1 - t0,
+                                rf.size / ( t1 - t0 ) / 1e6, diff );
+                        raster_close( &rf );
+                        unlink( path );
+                  }
+                  free( out );
+                  sunriset_raster_free( &r );
+            }
+      }
+      free( ref_rise ); free( ref_set ); free( ref_len ); free( ref_int );
+}
+
+
+/* Ephemeris backends: accuracy against references, agreement with   */
+/* each other over 1900-2100 and divergence outside, cost             */
+
+/* Equation of time of a backend, degrees: what the callers of        */
+/* sun_RA_dec_ephem compute from GMST0 for the hour angle at noon     */
+static double backend_eot( int backend, double d, double *dec, double *r )
+{
+      struct ephem_reader er;
+      double RA;
+
+      memset( &er, 0, sizeof er );
+      er.backend = backend;
+      sun_RA_dec_ephem( &er, d, &RA, dec, r );
+      return rev180( GMST0(d) - 180.0 - RA );
+}
+
+static void bench_backend( long nsites )
+{
+      /* Boston, first day of each month of 2020, and the times of   */
+      /* rise and set of Stellarium, local time (see check-Boston-2020) */
+      static const char *stel_rise[12] = {
+            "07:13:59", "06:58:50", "06:19:23", "06:26:29", "05:39:27",
+            "05:10:29", "05:12:12", "05:38:00", "06:10:36", "06:42:29",
+            "06:18:47", "06:54:51" };
+      static const char *stel_set[12] = {
+            "16:22:42", "16:58:23", "17:35:24", "19:11:19", "19:45:02",
+            "20:15:31", "20:25:20", "20:03:39", "19:17:54", "18:25:24",
+            "16:37:30", "16:13:08" };
+      static const int backends[2] = { EPHEM_SCHLYTER, EPHEM_MEEUS };
+      static const char *name[2] = { "schlyter", "meeus" };
+      const double lon = -71.2044, lat = 42.3358;
+      struct ephem_reader er[2];
+      struct pairs p;
+      double RA, dec, r, lmean, d, y, u, eot[2], dec2[2], r2[2], t0, t1;
+      double rise[2], set[2], stel, err, maxerr[2], *dev, ns[5], sink = 0.0;
+      int    rc[2], hh, mm, ss, tz, b, m, yr;
+      long   i, ndev;
+
+      memset( er, 0, sizeof er );
+      er[0].backend = EPHEM_SCHLYTER;
+      er[1].backend = EPHEM_MEEUS;
+      printf( "backend: compiled-in default %s\n",
+              SUNRISET_EPHEM == EPHEM_MEEUS ? "meeus" : "schlyter" );
+
+      /* Meeus, examples 25.b and 28.b: 1992 October 13.0 TD, from the */
+      /* complete VSOP87 theory.  The instant is converted to UT with  */
+      /* the Delta T of sun_RA_dec_meeus.                              */
+      y = 1992.78;
+      u = ( y - 1820.0 ) / 100.0;
+      d = -2635.0 - ( -20.0 + 32.0 * u * u ) / 86400.0;
+      printf( "  1992-10-13.0 TD     RA \"     dec \"    r 1e-8 AU  EoT s\n" );
+      for ( b = 0; b < 2; b++ )
+      {
+            if ( backends[b] == EPHEM_MEEUS )
+            {
+                  sun_RA_dec_meeus( d, &RA, &dec, &r, &lmean );
+                  eot[b] = rev180( lmean - RA );
+            }
+            else
+            {
+                  sun_RA_dec( d, &RA, &dec, &r );
+                  eot[b] = rev180( GMST0(d) - 180.0 - RA );
+            }
+            printf( "    %-14s %+9.2f %+9.2f %+10.0f %+8.1f\n", name[b],
+                    3600.0 * rev180( RA - 198.378178 ),
+                    3600.0 * ( dec + 7.783871 ), 1e8 * ( r - 0.99760775 ),
+                    240.0 * eot[b] - ( 13 * 60 + 42.6 ) );
+      }
+
+      /* Stellarium, with the precise iteration of the module */
+      printf( "  Boston 2020, precise, errors against Stellarium, s\n" );
+      maxerr[0] = maxerr[1] = 0.0;
+      for ( m = 1; m <= 12; m++ )
+      {
+            tz = m >= 4 && m <= 10 ? -4 : -5;
+            printf( "    2020-%02d-01", m );
+            for ( b = 0; b < 2; b++ )
+            {
+                  rc[b] = __sunriset_precise__( 2020, m, 1, lon, lat, -0.833,
+                                                0, PRECISE_TOL, &er[b], NULL,
+                                                &rise[b], &set[b] );
+                  sscanf( stel_rise[m-1], "%d:%d:%d", &hh, &mm, &ss );
+                  stel = 3600.0 * hh + 60.0 * mm + ss;
+                  err  = 3600.0 * ( rise[b] + tz ) - stel;
+                  printf( "  %s rise %+5.1f", name[b], err );
+                  if ( fabs( err ) > maxerr[b] )
+                        maxerr[b] = fabs( err );
+                  sscanf( stel_set[m-1], "%d:%d:%d", &hh, &mm, &ss );
+                  stel = 3600.0 * hh + 60.0 * mm + ss;
+                  err  = 3600.0 * ( set[b] + tz ) - stel;
+                  printf( " set %+5.1f", err );
+                  if ( fabs( err ) > maxerr[b] )
+                        maxerr[b] = fabs( err );
+            }
+            printf( "\n" );
+      }
+      printf( "    max: schlyter %.1f s, meeus %.1f s\n", maxerr[0], maxerr[1] );
+
+      /* Agreement of the backends over 1900-2100, where the calendars */
+      /* are the same                                                  */
+      pairs_alloc( &p, nsites );
+      for ( i = 0; i < nsites; i++ )
+      {
+            p.year[i]  = 1901 + (int) uniform( 0.0, 199.0 );
+            p.month[i] = 1 + (int) uniform( 0.0, 12.0 );
+            p.day[i]   = 1 + (int) uniform( 0.0, 28.0 );
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.lat[i]   = uniform( -65.0, 65.0 );
+      }
+      dev  = xmalloc( 2 * nsites * sizeof *dev );
+      ndev = 0;
+      for ( i = 0; i < nsites; i++ )
+      {
+            for ( b = 0; b < 2; b++ )
+                  rc[b] = __sunriset_ephem__( &er[b], p.year[i], p.month[i],
+                                              p.day[i], p.lon[i], p.lat[i],
+                                              -35.0/60.0, 1, &rise[b], &set[b] );
+            if ( rc[0] == 0 && rc[1] == 0 )
+            {
+                  dev[ndev++] = 3600.0 * fabs( rise[1] - rise[0] );
+                  dev[ndev++] = 3600.0 * fabs( set[1] - set[0] );
+            }
+      }
+      qsort( dev, ndev, sizeof *dev, cmp_double );
+      printf( "  1901-2099, %ld times, meeus - schlyter: p50 %.1f s,"
+              " p99 %.1f s, max %.1f s\n", ndev, dev[ndev / 2],
+              dev[ndev * 99 / 100], dev[ndev - 1] );
+      free( dev );
+
+      /* Divergence outside: the largest differences of the equation of */
+      /* time and of the declination, over the days of each century     */
+      printf( "  year    max |dEoT| s  max |ddec| '\n" );
+      for ( yr = -2000; yr <= 4000; yr += 500 )
+      {
+            double e_eot = 0.0, e_dec = 0.0;
+            for ( i = 0; i < 36525; i += 7 )
+            {
+                  d = sunriset_days( yr, 1, 1 ) + i + 0.5;
+                  for ( b = 0; b < 2; b++ )
+                        eot[b] = backend_eot( backends[b], d, &dec2[b], &r2[b] );
+                  if ( fabs( rev180( eot[1] - eot[0] ) ) > e_eot )
+                        e_eot = fabs( rev180( eot[1] - eot[0] ) );
+                  if ( fabs( dec2[1] - dec2[0] ) > e_dec )
+                        e_dec = fabs( dec2[1] - dec2[0] );
+            }
+            printf( "  %5d   %10.1f  %12.2f\n", yr, 240.0 * e_eot, 60.0 * e_dec );
+      }
+
+      /* Cost per call */
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+      {
+            sun_RA_dec( -36500.0 + 73000.0 * i / nsites, &RA, &dec, &r );
+            sink += RA;
+      }
+      t1 = now();
+      ns[0] = 1e9 * ( t1 - t0 ) / nsites;
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+      {
+            sun_RA_dec_meeus( -36500.0 + 73000.0 * i / nsites, &RA, &dec, &r,
+                              &lmean );
+            sink += RA;
+      }
+      t1 = now();
+      ns[1] = 1e9 * ( t1 - t0 ) / nsites;
+      t0 = now();
+      for ( i = 0; i < nsites; i++ )
+      {
+            __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i],
+                          -35.0/60.0, 1, &rise[0], &set[0] );
+            sink += rise[0];
+      }
+      t1 = now();
+      ns[2] = 1e9 * ( t1 - t0 ) / nsites;
+      for ( b = 0; b < 2; b++ )
+      {
+            t0 = now();
+            for ( i = 0; i < nsites; i++ )
+            {
+                  __sunriset_ephem__( &er[b], p.year[i], p.month[i], p.day[i],
+                                      p.lon[i], p.lat[i], -35.0/60.0, 1,
+                                      &rise[0], &set[0] );
+                  sink += rise[0];
+            }
+            t1 = now();
+            ns[3+b] = 1e9 * ( t1 - t0 ) / nsites;
+      }
+      printf( "  ns/call: sun_RA_dec %.1f, sun_RA_dec_meeus %.1f (x%.2f)\n",
+              ns[0], ns[1], ns[1] / ns[0] );
+      printf( "           __sunriset__ %.1f, __sunriset_ephem__ schlyter %.1f,"
+              " meeus %.1f (x%.2f)\n", ns[2], ns[3], ns[4], ns[4] / ns[3] );
+      if ( sink == 42.0 )
+            printf( "\n" );
+      pairs_free( &p );
+}
+
+
+/* Instrumentation benchmark: a mixed workload, timed; built with  */
+/* -DSUNRISET_STATS (sunriset-bench-stats), the counters are checked */
+/* against the workload and dumped as JSON.  Compare the timings of  */
+/* both programs for the cost of the instrumentation.                */
+
+#define STATS_THREADS  4
+
+struct stats_work
+{
+      const struct pairs *p;
+      long   i0, i1;
+      long   rc[3];
+      double sink;
+};
+
+static void *stats_worker( void *arg )
+{
+      struct stats_work *w = arg;
+      const struct pairs *p = w->p;
+      double rise, set;
+      long   i;
+
+      for ( i = w->i0; i < w->i1; i++ )
+      {
+            w->rc[ 1 + sun_rise_set( p->year[i], p->month[i], p->day[i],
+                                     p->lon[i], p->lat[i], &rise, &set ) ]++;
+            w->sink += rise;
+      }
+      return NULL;
+}
+
+static void bench_stats( long npairs )
+{
+      struct pairs p;
+      struct stats_work w[STATS_THREADS];
+      struct sunriset_stats st;
+      pthread_t tid[STATS_THREADS];
+      double t0, t1, rise[366], set[366], r, s, sink = 0.0;
+      long   i, rc[3] = { 0, 0, 0 }, nprecise = npairs / 8, nyear = npairs / 366;
+      int    yrc[366], started[STATS_THREADS], k, ok = 1;
+
+      pairs_alloc( &p, npairs );
+      for ( i = 0; i < npairs; i++ )
+      {
+            p.lat[i]   = uniform( -89.0, 89.0 );
+            p.lon[i]   = uniform( -180.0, 180.0 );
+            p.year[i]  = 1801 + (int) uniform( 0, 299 );
+            p.month[i] = 1 + (int) uniform( 0, 12 );
+            p.day[i]   = 1 + (int) uniform( 0, 28 );
+      }
+      printf( "stats: level %d, %ld pairs, %d threads\n",
+              sunriset_stats_enabled(), npairs, STATS_THREADS );
+
+      sunriset_stats_reset();
+      t0 = now();
+      for ( k = 0; k < STATS_THREADS; k++ )
+      {
+            memset( &w[k], 0, sizeof w[k] );
+            w[k].p  = &p;
+            w[k].i0 = npairs * k / STATS_THREADS;
+            w[k].i1 = npairs * ( k + 1 ) / STATS_THREADS;
+            started[k] = pthread_create( &tid[k], NULL, stats_worker, &w[k] ) == 0;
+            if ( !started[k] )
+                  stats_worker( &w[k] );
+      }
+      for ( k = 0; k < STATS_THREADS; k++ )
+      {
+            if ( started[k] )
+                  pthread_join( tid[k], NULL );
+            rc[0] += w[k].rc[0], rc[1] += w[k].rc[1], rc[2] += w[k].rc[2];
+            sink += w[k].sink;
+      }
+      for ( i = 0; i < nprecise; i++ )
+      {
+            __sunriset_precise__( p.year[i], p.month[i], p.day[i], p.lon[i],
+                                  p.lat[i], -35.0/60.0, 1, PRECISE_TOL,
+                                  NULL, NULL, &r, &s );
+            sink += r;
+      }
+      for ( i = 0; i < nyear; i++ )
+      {
+            sunriset_year( p.year[i], p.lon[i], p.lat[i], -6.0, 0, rise, set, yrc );
+            sink += rise[0];
+      }
+      t1 = now();
+      printf( "  workload %8.3f s\n", t1 - t0 );
+
+      if ( sunriset_stats_enabled() )
+      {
+            /* __sunriset_precise__ and sunriset_year do not go through */
+            /* __sunriset__: the threads are its only callers           */
+            sunriset_stats_get( &st );
+            ok = st.calls[STATS_SUNRISET] == npairs
+              && st.rc[STATS_SUNRISET][0] == rc[0]
+              && st.rc[STATS_SUNRISET][1] == rc[1]
+              && st.rc[STATS_SUNRISET][2] == rc[2]
+              && st.calls[STATS_PRECISE] == nprecise
+              && st.calls[STATS_YEAR] == nyear
+              && st.threads >= STATS_THREADS;
+            printf( "  counters %s\n", ok ? "match the workload" : "DIFFER" );
+            sunriset_stats_json( stdout );
+      }
+      if ( sink == 0.0 )
+            printf( "\n" );
+      pairs_free( &p );
+      if ( !ok )
+            exit( 1 );
+}
+
+
+/* Inverse benchmark: sunriset_crossings against __sunriset__ called */
+/* for every day, and checks of polar_latitudes and clock_latitudes  */
+
+/* State changes of the year, from __sunriset__ for every day */
+static int crossings_brute( int year, double lon, double lat, double altit,
+                            int upper_limb, int event, double clock,
+                            double tz, int *state0,
+                            struct sunriset_crossing *cross, int maxcross )
+{
+      double rise, set, h;
+      int    n = almanac_days( year ), k, rc, state, prev = 0, ncross = 0;
+
+      for ( k = 0; k < n; k++ )
+      {
+            rc = __sunriset__( year, 1, 1 + k, lon, lat, altit, upper_limb,
+                               &rise, &set );
+            if ( rc != 0 )
+                  state = rc < 0 ? CROSS_NIGHT : CROSS_DAY;
+            else
+            {
+                  h = ( event == CROSS_RISE ? rise : set ) + tz;
+                  h -= 24.0 * floor( h / 24.0 );
+                  state = h < clock ? CROSS_BEFORE : CROSS_AFTER;
+            }
+            if ( k == 0 )
+                  *state0 = state;
+            else if ( state != prev )
+            {
+                  if ( ncross < maxcross )
+                  {
+                        cross[ncross].day  = k;
+                        cross[ncross].from = prev;
+                        cross[ncross].to   = state;
+                  }
+                  ncross++;
+            }
+            prev = state;
+      }
+      return ncross;
+}
+
+static void bench_inverse( long nquery )
+{
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      struct sunriset_crossing c0[64], c1[64];
+      double *lon, *lat, *clock, rise, set, night[2], day[2], lats[2], h;
+      int    *year, *event, *kind, s0, s1, n0, n1, k, j, rc, bad;
+      long   i, diff = 0, evals = 0, nchanges = 0, polar_bad = 0,
+             clock_bad = 0, clock_found = 0, clock_missed = 0;
+      double t0, t1, t2, sink = 0.0;
+
+      lon   = xmalloc( nquery * sizeof *lon );
+      lat   = xmalloc( nquery * sizeof *lat );
+      clock = xmalloc( nquery * sizeof *clock );
+      year  = xmalloc( nquery * sizeof *year );
+      event = xmalloc( nquery * sizeof *event );
+      kind  = xmalloc( nquery * sizeof *kind );
+      for ( i = 0; i < nquery; i++ )
+      {
+            lat[i]   = uniform( -89.0, 89.0 );
+            lon[i]   = uniform( -180.0, 180.0 );
+            clock[i] = uniform( 0.0, 24.0 );
+            year[i]  = 1801 + (int) uniform( 0, 299 );
+            event[i] = uniform( 0, 1 ) < 0.5 ? CROSS_RISE : CROSS_SET;
+            kind[i]  = (int) uniform( 0, 4 );
+      }
+
+      /* Same state changes as __sunriset__ every day */
+      for ( i = 0; i < nquery; i++ )
+      {
+            n0 = crossings_brute( year[i], lon[i], lat[i], altit[kind[i]],
+                                  kind[i] == 0, event[i], clock[i],
+                                  floor( lon[i] / 15.0 + 0.5 ), &s0, c0, 64 );
+            n1 = sunriset_crossings( year[i], lon[i], lat[i], altit[kind[i]],
+                                     kind[i] == 0, event[i], clock[i],
+                                     floor( lon[i] / 15.0 + 0.5 ), &s1, c1,
+                                     64, &evals );
+            bad = n0 != n1 || s0 != s1;
+            for ( k = 0; !bad && k < n0 && k < 64; k++ )
+                  bad = c0[k].day != c1[k].day || c0[k].from != c1[k].from
+                        || c0[k].to != c1[k].to;
+            diff += bad;
+            nchanges += n0;
+      }
+      printf( "inverse: %ld (site, year, clock time) queries, %ld state changes\n",
+              nquery, nchanges );
+      printf( "  sunriset_crossings: %ld queries differ from __sunriset__ every day\n",
+              diff );
+      printf( "  positions of the Sun per query: %.1f instead of 365.2\n",
+              (double) evals / nquery );
+
+      t0 = now();
+      for ( i = 0; i < nquery; i++ )
+            sink += crossings_brute( year[i], lon[i], lat[i], altit[kind[i]],
+                                     kind[i] == 0, event[i], clock[i],
+                                     floor( lon[i] / 15.0 + 0.5 ), &s0, c0, 64 );
+      t1 = now();
+      for ( i = 0; i < nquery; i++ )
+            sink += sunriset_crossings( year[i], lon[i], lat[i], altit[kind[i]],
+                                        kind[i] == 0, event[i], clock[i],
+                                        floor( lon[i] / 15.0 + 0.5 ), &s1, c1,
+                                        64, NULL );
+      t2 = now();
+      printf( "    every day          %8.3f s %10.0f queries/s\n",
+              t1 - t0, nquery / ( t1 - t0 ) );
+      printf( "    sunriset_crossings %8.3f s %10.0f queries/s  x%.2f\n",
+              t2 - t1, nquery / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ) );
+
+      /* Polar limits: the return code of __sunriset__ changes there */
+      for ( i = 0; i < nquery; i++ )
+      {
+            double a = altit[kind[i]];
+            int    m = 1 + (int) uniform( 0, 12 ), d = 1 + (int) uniform( 0, 28 );
+
+            polar_latitudes( year[i], m, d, lon[i], a, kind[i] == 0, night, day );
+            for ( k = 0; k < 2; k++ )
+            {
+                  double dir = k == 0 ? -1.0 : 1.0;
+                  if ( fabs( night[k] ) < 90.0 - 1e-6 )
+                  {
+                        polar_bad += __sunriset__( year[i], m, d, lon[i],
+                                                   night[k] + 1e-6 * dir, a,
+                                                   kind[i] == 0, &rise, &set ) != -1;
+                        polar_bad += __sunriset__( year[i], m, d, lon[i],
+                                                   night[k] - 1e-6 * dir, a,
+                                                   kind[i] == 0, &rise, &set ) == -1;
+                  }
+                  if ( fabs( day[k] ) < 90.0 - 1e-6 )
+                  {
+                        polar_bad += __sunriset__( year[i], m, d, lon[i],
+                                                   day[k] + 1e-6 * dir, a,
+                                                   kind[i] == 0, &rise, &set ) != 1;
+                        polar_bad += __sunriset__( year[i], m, d, lon[i],
+                                                   day[k] - 1e-6 * dir, a,
+                                                   kind[i] == 0, &rise, &set ) == 1;
+                  }
+            }
+      }
+      printf( "  polar_latitudes: %ld return codes of __sunriset__ differ"
+              " 1e-6 degrees from the limits\n", polar_bad );
+
+      /* Clock latitudes: the event happens at the clock time there, and */
+      /* a scan of the latitudes every 0.05 degrees finds no other one   */
+      for ( i = 0; i < nquery / 10; i++ )
+      {
+            double a = altit[kind[i]], tz = floor( lon[i] / 15.0 + 0.5 ), g, g0 = 0.0;
+            int    m = 1 + (int) uniform( 0, 12 ), d = 1 + (int) uniform( 0, 28 ),
+                   ok0 = 0, nscan = 0;
+
+            n1 = clock_latitudes( year[i], m, d, lon[i], a, kind[i] == 0,
+                                  event[i], clock[i], tz, lats );
+            for ( k = 0; k < n1; k++ )
+            {
+                  rc = __sunriset__( year[i], m, d, lon[i], lats[k], a,
+                                     kind[i] == 0, &rise, &set );
+                  h = ( event[i] == CROSS_RISE ? rise : set ) + tz;
+                  clock_bad += rc != 0 || fabs( remainder( h - clock[i], 24.0 ) ) > 1e-6;
+            }
+            for ( j = -1798; j <= 1798; j++ )
+            {
+                  rc = __sunriset__( year[i], m, d, lon[i], j * 0.05, a,
+                                     kind[i] == 0, &rise, &set );
+                  h = ( event[i] == CROSS_RISE ? rise : set ) + tz;
+                  g = remainder( h - clock[i], 24.0 );
+                  if ( rc == 0 && ok0 && ( g < 0.0 ) != ( g0 < 0.0 )
+                       && fabs( g - g0 ) < 12.0 )
+                        nscan++;
+                  ok0 = rc == 0;
+                  g0 = g;
+            }
+            clock_found += n1;
+            clock_missed += nscan > n1;
+      }
+      printf( "  clock_latitudes: %ld latitudes, %ld not at the clock time,"
+              " %ld queries with more in a scan\n",
+              clock_found, clock_bad, clock_missed );
+      if ( sink == 0.0 )
+            printf( "\n" );
+
+      free( lon ); free( lat ); free( clock );
+      free( year ); free( event ); free( kind );
+}
+
+
+/* Benchmark suite: micro benchmarks of the functions of SUNRISET.C   */
+/* and macro benchmarks of grids of sites.  Each benchmark runs its   */
+/* function for more and more iterations until SUITE_MIN_TIME, three  */
+/* times, and reports the median.  Results can be written as JSON and */
+/* compared with a baseline written by an earlier run.                */
+
+#define SUITE_N           4096          /* Inputs cycled through, power of 2 */
+#define SUITE_MIN_TIME    0.2           /* Seconds per repetition */
+#define SUITE_REPS        3
+#define SUITE_REGRESSION  0.15          /* Slower than the baseline by more */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define suite_ticks()     ( (double) __rdtsc() )
+#else
+#define suite_ticks()     0.0
+#endif
+
+static double suite_d[SUITE_N], suite_deg[SUITE_N], suite_cos[SUITE_N];
+static double suite_lon[SUITE_N], suite_lat[SUITE_N];
+static int    suite_year[SUITE_N], suite_month[SUITE_N], suite_day[SUITE_N];
+
+static void suite_inputs( void )
+{
+      int i;
+      for ( i = 0; i < SUITE_N; i++ )
+      {
+            suite_year[i]  = 1801 + (int) uniform( 0, 299 );
+            suite_month[i] = 1 + (int) uniform( 0, 12 );
+            suite_day[i]   = 1 + (int) uniform( 0, 28 );
+            suite_d[i]     = days_since_2000_Jan_0( suite_year[i], suite_month[i],
+                                                    suite_day[i] ) + 0.5;
+            suite_deg[i]   = uniform( -90.0, 90.0 );
+            suite_cos[i]   = uniform( -1.0, 1.0 );
+            suite_lon[i]   = uniform( -180.0, 180.0 );
+            suite_lat[i]   = uniform( -65.0, 65.0 );
+      }
+}
+
+/* Micro benchmarks: iters calls, the result is summed so that */
+/* the calls cannot be optimized away                          */
+
+static double micro_sunpos( long iters )
+{
+      double s = 0.0, lon, r;
+      long   i;
+      for ( i = 0; i < iters; i++ )
+      {
+            sunpos( suite_d[i & (SUITE_N-1)], &lon, &r );
+            s += lon + r;
+      }
+      return s;
+}
+
+static double micro_sun_RA_dec( long iters )
+{
+      double s = 0.0, RA, dec, r;
+      long   i;
+      for ( i = 0; i < iters; i++ )
+      {
+            sun_RA_dec( suite_d[i & (SUITE_N-1)], &RA, &dec, &r );
+            s += RA + dec + r;
+      }
+      return s;
+}
+
+static double micro_GMST0( long iters )
+{
+      double s = 0.0;
+      long   i;
+      for ( i = 0; i < iters; i++ )
+            s += GMST0( suite_d[i & (SUITE_N-1)] );
+      return s;
+}
+
+static double micro_sunriset( long iters )
+{
+      double s = 0.0, rise, set;
+      long   i, j;
+      for ( i = 0; i < iters; i++ )
+      {
+            j = i & (SUITE_N-1);
+            s += __sunriset__( suite_year[j], suite_month[j], suite_day[j],
+                               suite_lon[j], suite_lat[j], -35.0/60.0, 1,
+                               &rise, &set ) + rise;
+      }
+      return s;
+}
+
+static double micro_daylen( long iters )
+{
+      double s = 0.0;
+      long   i, j;
+      for ( i = 0; i < iters; i++ )
+      {
+            j = i & (SUITE_N-1);
+            s += __daylen__( suite_year[j], suite_month[j], suite_day[j],
+                             suite_lon[j], suite_lat[j], -35.0/60.0, 1 );
+      }
+      return s;
+}
+
+static double micro_sind( long iters )
+{
+      double s = 0.0;
+      long   i;
+      for ( i = 0; i < iters; i++ )
+            s += sind( suite_deg[i & (SUITE_N-1)] );
+      return s;
+}
+
+static double micro_acosd( long iters )
+{
+      double s = 0.0;
+      long   i;
+      for ( i = 0; i < iters; i++ )
+            s += acosd( suite_cos[i & (SUITE_N-1)] );
+      return s;
+}
+
+/* Macro benchmarks: one iteration computes the 4 kinds for a grid.  */
+/* Day grids: one date, every degree of longitude and latitude of    */
+/* the band.  Year grids: every day of 2024, every 10 degrees of     */
+/* longitude, every 2 degrees of latitude of the band.               */
+
+static double macro_grid( int ndays, double lat0, double lat1, double dlat,
+                          double dlon )
+{
+      double s = 0.0, rise, set, lat, lon;
+      int    j, k;
+
+      for ( j = 0; j < ndays; j++ )
+            for ( lat = lat0; lat <= lat1; lat += dlat )
+                  for ( lon = -180.0; lon < 180.0; lon += dlon )
+                        for ( k = 0; k < SUNRISET_KINDS; k++ )
+                        {
+                              s += __sunriset__( 2024, 1, 1 + j, lon, lat,
+                                                 batch_altit[k],
+                                                 batch_upper_limb[k],
+                                                 &rise, &set ) + rise;
+                        }
+      return s;
+}
+
+static long macro_calls( int ndays, double lat0, double lat1, double dlat,
+                         double dlon )
+{
+      return (long) ndays * ( (long) floor( ( lat1 - lat0 ) / dlat ) + 1 )
+             * (long) ( 360.0 / dlon ) * SUNRISET_KINDS;
+}
+
+static const struct suite_bench
+{
+      const char *name;
+      double (*fn)( long iters );       /* Micro benchmarks */
+      int    ndays;                     /* Macro benchmarks: the grid */
+      double lat0, lat1, dlat, dlon;
+} suite[] =
+{
+      { "micro/sunpos",          micro_sunpos,      0,   0.0,  0.0, 0.0,  0.0 },
+      { "micro/sun_RA_dec",      micro_sun_RA_dec,  0,   0.0,  0.0, 0.0,  0.0 },
+      { "micro/GMST0",           micro_GMST0,       0,   0.0,  0.0, 0.0,  0.0 },
+      { "micro/__sunriset__",    micro_sunriset,    0,   0.0,  0.0, 0.0,  0.0 },
+      { "micro/__daylen__",      micro_daylen,      0,   0.0,  0.0, 0.0,  0.0 },
+      { "micro/sind",            micro_sind,        0,   0.0,  0.0, 0.0,  0.0 },
+      { "micro/acosd",           micro_acosd,       0,   0.0,  0.0, 0.0,  0.0 },
+      { "macro/day/polar",       NULL,   1,  66.0, 90.0, 1.0,  1.0 },
+      { "macro/day/mid",         NULL,   1,  30.0, 60.0, 1.0,  1.0 },
+      { "macro/day/equatorial",  NULL,   1, -10.0, 10.0, 1.0,  1.0 },
+      { "macro/year/polar",      NULL, 366,  66.0, 90.0, 2.0, 10.0 },
+      { "macro/year/mid",        NULL, 366,  30.0, 60.0, 2.0, 10.0 },
+      { "macro/year/equatorial", NULL, 366, -10.0, 10.0, 2.0, 10.0 },
+};
+#define SUITE_SIZE  ( (int) ( sizeof suite / sizeof suite[0] ) )
+
+static double suite_run( const struct suite_bench *sb, long iters )
+{
+      double s = 0.0;
+      long   i;
+
+      if ( sb->fn != NULL )
+            return sb->fn( iters );
+      for ( i = 0; i < iters; i++ )
+            s += macro_grid( sb->ndays, sb->lat0, sb->lat1, sb->dlat, sb->dlon );
+      return s;
+}
+
+/* Calls of the function per iteration */
+static long suite_calls( const struct suite_bench *sb )
+{
+      if ( sb->fn != NULL )
+            return 1;
+      return macro_calls( sb->ndays, sb->lat0, sb->lat1, sb->dlat, sb->dlon );
+}
+
+static int cmp_double_suite( const void *a, const void *b )
+{
+      double x = *(const double *) a, y = *(const double *) b;
+      return x < y ? -1 : x > y;
+}
+
+/* ns per call of the benchmark name in the JSON file text, or -1 */
+static double suite_baseline( const char *text, const char *name )
+{
+      char key[128];
+      const char *p;
+
+      snprintf( key, sizeof key, "\"name\": \"%s\"", name );
+      if ( text == NULL || ( p = strstr( text, key ) ) == NULL
+           || ( p = strstr( p, "\"ns_per_call\":" ) ) == NULL )
+            return -1.0;
+      return atof( p + strlen( "\"ns_per_call\":" ) );
+}
+
+static char *slurp( const char *path )
+{
+      FILE  *fp = fopen( path, "rb" );
+      char  *text;
+      long   n;
+
+      if ( fp == NULL )
+      {
+            perror( path );
+            exit( 1 );
+      }
+      fseek( fp, 0, SEEK_END );
+      n = ftell( fp );
+      rewind( fp );
+      text = xmalloc( n + 1 );
+      text[fread( text, 1, n, fp )] = '\0';
+      fclose( fp );
+      return text;
+}
+
+static void bench_suite( int argc, char **argv )
+{
+      const char *json = NULL, *filter = NULL;
+      char   *base = NULL;
+      FILE   *out = NULL;
+      double ns[SUITE_REPS], cyc[SUITE_REPS], t0, t1, c0, c1, sink = 0.0;
+      double tick_ghz, ref;
+      long   iters, calls;
+      int    b, r, nout = 0, nslow = 0;
+
+      for ( ; argc > 0; argc--, argv++ )
+      {
+            if ( strcmp( argv[0], "-j" ) == 0 && argc > 1 )
+                  json = *++argv, argc--;
+            else if ( strcmp( argv[0], "-b" ) == 0 && argc > 1 )
+                  base = slurp( *++argv ), argc--;
+            else
+                  filter = argv[0];
+      }
+
+      /* Frequency of the time stamp counter, for the cycles */
+      t0 = now(); c0 = suite_ticks();
+      while ( now() - t0 < 0.05 )
+            ;
+      t1 = now(); c1 = suite_ticks();
+      tick_ghz = ( c1 - c0 ) / ( t1 - t0 ) / 1e9;
+
+      suite_inputs();
+      if ( json != NULL && ( out = fopen( json, "w" ) ) == NULL )
+      {
+            perror( json );
+            exit( 1 );
+      }
+      if ( out != NULL )
+            fprintf( out, "{\n  \"context\": {\n"
+                          "    \"compiler\": \"%s\",\n"
+                          "    \"num_cpus\": %ld,\n"
+                          "    \"tsc_ghz\": %.3f,\n"
+                          "    \"min_time\": %.2f,\n"
+                          "    \"repetitions\": %d\n  },\n"
+                          "  \"benchmarks\": [\n",
+                     __VERSION__, sysconf( _SC_NPROCESSORS_ONLN ), tick_ghz,
+                     SUITE_MIN_TIME, SUITE_REPS );
+
+      printf( "%-24s %12s %10s %14s %12s%s\n", "benchmark", "calls",
+              "ns/call", "calls/s", "cycles/call", base ? "  baseline" : "" );
+      for ( b = 0; b < SUITE_SIZE; b++ )
+      {
+            if ( filter != NULL && strstr( suite[b].name, filter ) == NULL )
+                  continue;
+            calls = suite_calls( &suite[b] );
+
+            /* Calibration, as Google Benchmark: grow iters until */
+            /* one run takes SUITE_MIN_TIME                       */
+            for ( iters = 1; ; iters *= 10 )
+            {
+                  t0 = now();
+                  sink += suite_run( &suite[b], iters );
+                  t1 = now();
+                  if ( t1 - t0 >= SUITE_MIN_TIME / 10 )
+                        break;
+            }
+            iters = (long) ceil( iters * SUITE_MIN_TIME / ( t1 - t0 ) );
+            for ( r = 0; r < SUITE_REPS; r++ )
+            {
+                  t0 = now(); c0 = suite_ticks();
+                  sink += suite_run( &suite[b], iters );
+                  t1 = now(); c1 = suite_ticks();
+                  ns[r]  = ( t1 - t0 ) * 1e9 / ( (double) iters * calls );
+                  cyc[r] = ( c1 - c0 ) / ( (double) iters * calls );
+            }
+            qsort( ns, SUITE_REPS, sizeof(double), cmp_double_suite );
+            qsort( cyc, SUITE_REPS, sizeof(double), cmp_double_suite );
+
+            printf( "%-24s %12ld %10.2f %14.0f %12.1f", suite[b].name,
+                    iters * calls, ns[SUITE_REPS/2], 1e9 / ns[SUITE_REPS/2],
+                    cyc[SUITE_REPS/2] );
+            if ( base != NULL )
+            {
+                  ref = suite_baseline( base, suite[b].name );
+                  if ( ref > 0.0 )
+                  {
+                        printf( "  %+6.1f%%", 100.0 * ( ns[SUITE_REPS/2] / ref - 1.0 ) );
+                        if ( ns[SUITE_REPS/2] > ref * ( 1.0 + SUITE_REGRESSION ) )
+                        {
+                              printf( " SLOWER" );
+                              nslow++;
+                        }
+                  }
+                  else
+                        printf( "  new" );
+            }
+            printf( "\n" );
+            if ( out != NULL )
+                  fprintf( out, "%s    {\n"
+                                "      \"name\": \"%s\",\n"
+                                "      \"iterations\": %ld,\n"
+                                "      \"calls\": %ld,\n"
+                                "      \"ns_per_call\": %.3f,\n"
+                                "      \"calls_per_second\": %.0f,\n"
+                                "      \"cycles_per_call\": %.2f\n"
+                                "    }",
+                           nout++ ? ",\n" : "", suite[b].name, iters, iters * calls,
+                           ns[SUITE_REPS/2], 1e9 / ns[SUITE_REPS/2],
+                           cyc[SUITE_REPS/2] );
+      }
+      if ( out != NULL )
+      {
+            fprintf( out, "\n  ]\n}\n" );
+            fclose( out );
+      }
+      if ( base != NULL )
+            printf( "%d benchmark(s) more than %.0f%% slower than the baseline\n",
+                    nslow, 100.0 * SUITE_REGRESSION );
+      printf( "cycles: time stamp counter at %.3f GHz%s\n", tick_ghz,
+              tick_ghz == 0.0 ? " (not available)" : "" );
+      if ( sink == 0.0 )
+            printf( "\n" );
+      free( base );
+}
+
+
+static void usage( void )
+{
+      fprintf( stderr, "Usage: sunriset-bench batch [nsites]\n"
+                       "       sunriset-bench simd  [nsites]\n"
+                       "       sunriset-bench precise [nsites]\n"
+                       "       sunriset-bench ephem [nsites]\n"
+                       "       sunriset-bench almanac [nsites]\n"
+                       "       sunriset-bench stream [nrecords]\n"
+                       "       sunriset-bench almfile [nlookups]\n"
+                       "       sunriset-bench fused [ndays]\n"
+                       "       sunriset-bench inverse [nqueries]\n"
+                       "       sunriset-bench sweep [nsites]\n"
+                       "       sunriset-bench stats [npairs]\n"
+                       "       sunriset-bench float [daystep]\n"
+                       "       sunriset-bench timeline [nsites]\n"
+                       "       sunriset-bench raster [step]\n"
+                       "       sunriset-bench backend [nsites]\n"
+                       "       sunriset-bench suite [-j out.json]"
+                       " [-b baseline.json] [filter]\n" );
+      exit( 1 );
+}
+
+int main( int argc, char **argv )
+{
+      if ( argc < 2 )
+            usage();
+
+      if ( strcmp( argv[1], "batch" ) == 0 )
+            bench_batch( argc > 2 ? atol( argv[2] ) : 200000L );
+      else if ( strcmp( argv[1], "simd" ) == 0 )
+            bench_simd( argc > 2 ? atol( argv[2] ) : 200000L );
+      else if ( strcmp( argv[1], "precise" ) == 0 )
+            bench_precise( argc > 2 ? atol( argv[2] ) : 200000L );
+      else if ( strcmp( argv[1], "ephem" ) == 0 )
+            bench_ephem( argc > 2 ? atol( argv[2] ) : 1000000L );
+      else if ( strcmp( argv[1], "almanac" ) == 0 )
+            bench_almanac( argc > 2 ? atol( argv[2] ) : 4096L );
+      else if ( strcmp( argv[1], "stream" ) == 0 )
+            bench_stream( argc > 2 ? atol( argv[2] ) : 1000000L );
+      else if ( strcmp( argv[1], "almfile" ) == 0 )
+            bench_almfile( argc > 2 ? atol( argv[2] ) : 1000000L );
+      else if ( strcmp( argv[1], "fused" ) == 0 )
+            bench_fused( argc > 2 ? atol( argv[2] ) : 200000L );
+      else if ( strcmp( argv[1], "inverse" ) == 0 )
+            bench_inverse( argc > 2 ? atol( argv[2] ) : 20000L );
+      else if ( strcmp( argv[1], "sweep" ) == 0 )
+            bench_sweep( argc > 2 ? atol( argv[2] ) : 5000L );
+      else if ( strcmp( argv[1], "stats" ) == 0 )
+            bench_stats( argc > 2 ? atol( argv[2] ) : 1000000L );
+      else if ( strcmp( argv[1], "float" ) == 0 )
+            bench_float( argc > 2 ? atoi( argv[2] ) : 1 );
+      else if ( strcmp( argv[1], "timeline" ) == 0 )
+            bench_timeline( argc > 2 ? atol( argv[2] ) : 5000L );
+      else if ( strcmp( argv[1], "raster" ) == 0 )
+            bench_raster( argc > 2 ? atof( argv[2] ) : 0.1 );
+      else if ( strcmp( argv[1], "backend" ) == 0 )
+            bench_backend( argc > 2 ? atol( argv[2] ) : 200000L );
+      else if ( strcmp( argv[1], "suite" ) == 0 )
+            bench_suite( argc - 2, argv + 2 );
+      else
+            usage();
+      return 0;
+}
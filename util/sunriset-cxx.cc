@@ -0,0 +1,147 @@
+/*
+
+SUNRISET-CXX.CC - checks the C++ part of SUNRISET.H
+
+Usage:  sunriset-cxx [npairs]
+
+The static_asserts below are evaluated by the compiler.  At run time,
+rise_set<Kind> and daylen<Kind> are compared with the C functions, for
+random (site, date) pairs, then timed against them.
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "sunriset.h"
+
+using namespace sunriset;
+
+/* A fixed date, at compile time */
+static_assert( days_since_2000_Jan_0( 2000, 1, 1 ) == 1, "2000 Jan 1" );
+static_assert( days_since_2000_Jan_0( 1999, 12, 31 ) == 0, "2000 Jan 0" );
+static_assert( days_since_2000_Jan_0( 2024, 3, 1 )
+               - days_since_2000_Jan_0( 2024, 2, 28 ) == 2, "2024 Feb 29" );
+static_assert( sunriset::revolution( -90.0 ) == 270.0, "revolution" );
+static_assert( sunriset::rev180( 270.0 ) == -90.0, "rev180" );
+static_assert( sunriset::GMST0( 0.0 ) > 98.98 && sunriset::GMST0( 0.0 ) < 98.99,
+               "GMST0" );
+
+/* The sidereal time at 0h UT for every day of 2024, computed by the compiler */
+struct gmst_table
+{
+      double deg[366];
+      constexpr gmst_table() : deg()
+      {
+            for ( int i = 0; i < 366; i++ )
+                  deg[i] = sunriset::GMST0( days_since_2000_Jan_0( 2024, 1, 1 ) + i );
+      }
+};
+static constexpr gmst_table gmst2024;
+
+struct pairs
+{
+      std::vector<int>    year, month, day;
+      std::vector<double> lon, lat;
+};
+
+static unsigned long seed = 12345;
+
+static double uniform( double lo, double hi )
+{
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      return lo + ( hi - lo ) * ( ( seed >> 11 ) * ( 1.0 / 9007199254740992.0 ) );
+}
+
+static double now()
+{
+      return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/* Number of differences between rise_set<Kind> and __sunriset__, */
+/* and between daylen<Kind> and __daylen__                        */
+template <int Kind>
+static long compare( const pairs &p )
+{
+      long   diff = 0;
+      double r0, s0, r1, s1;
+
+      for ( size_t i = 0; i < p.lat.size(); i++ )
+      {
+            int rc0 = __sunriset__( p.year[i], p.month[i], p.day[i], p.lon[i],
+                                    p.lat[i], kind<Kind>::altit,
+                                    kind<Kind>::upper_limb, &r0, &s0 );
+            int rc1 = rise_set<Kind>( p.year[i], p.month[i], p.day[i],
+                                      p.lon[i], p.lat[i], &r1, &s1 );
+            diff += rc0 != rc1 || r0 != r1 || s0 != s1;
+            diff += __daylen__( p.year[i], p.month[i], p.day[i], p.lon[i],
+                                p.lat[i], kind<Kind>::altit,
+                                kind<Kind>::upper_limb )
+                    != daylen<Kind>( p.year[i], p.month[i], p.day[i],
+                                     p.lon[i], p.lat[i] );
+      }
+      return diff;
+}
+
+int main( int argc, char **argv )
+{
+      long   n = argc > 1 ? atol( argv[1] ) : 1000000L, diff = 0, i;
+      double t0, t1, t2, sink = 0.0, rise, set;
+      pairs  p;
+
+      for ( i = 0; i < 366; i++ )
+            if ( gmst2024.deg[i] != ::GMST0( days_since_2000_Jan_0( 2024, 1, 1 ) + i ) )
+                  diff++;
+      printf( "constexpr GMST0 table of 2024: %s\n",
+              diff == 0 ? "same as GMST0" : "DIFFERENT" );
+
+      for ( i = 0; i < n; i++ )
+      {
+            p.lat.push_back( uniform( -89.0, 89.0 ) );
+            p.lon.push_back( uniform( -180.0, 180.0 ) );
+            p.year.push_back( 1801 + (int) uniform( 0, 299 ) );
+            p.month.push_back( 1 + (int) uniform( 0, 12 ) );
+            p.day.push_back( 1 + (int) uniform( 0, 28 ) );
+      }
+      diff = compare<KIND_RISE_SET>( p ) + compare<KIND_CIVIL>( p )
+           + compare<KIND_NAUTICAL>( p ) + compare<KIND_ASTRONOMICAL>( p );
+      printf( "rise_set<Kind>, daylen<Kind>: %ld differences in %ld pairs\n",
+              diff, n );
+
+      /* The 4 kinds per pair, the C way and the template way */
+      t0 = now();
+      for ( i = 0; i < n; i++ )
+      {
+            sun_rise_set( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+            civil_twilight( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+            nautical_twilight( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+            astronomical_twilight( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+      }
+      t1 = now();
+      for ( i = 0; i < n; i++ )
+      {
+            rise_set<KIND_RISE_SET>( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+            rise_set<KIND_CIVIL>( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+            rise_set<KIND_NAUTICAL>( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+            rise_set<KIND_ASTRONOMICAL>( p.year[i], p.month[i], p.day[i], p.lon[i], p.lat[i], &rise, &set );
+            sink += rise;
+      }
+      t2 = now();
+      printf( "  macros         %8.3f s %10.0f calls/s\n",
+              t1 - t0, 4 * n / ( t1 - t0 ) );
+      printf( "  rise_set<Kind> %8.3f s %10.0f calls/s  x%.2f\n",
+              t2 - t1, 4 * n / ( t2 - t1 ), ( t1 - t0 ) / ( t2 - t1 ) );
+      if ( sink == 0.0 )
+            printf( "\n" );
+      return diff != 0;
+}
@@ -0,0 +1,656 @@
+/*
+
+SUNRISET-DAEMON.C - answers __sunriset__ questions on a Unix domain
+                    socket, see sunriset-daemon.h for the protocol
+
+Usage: sunriset-daemon [-s path] [-t nthreads] [-c entries] [-S nshards]
+
+   -s path      the socket, default SUNRISETD_PATH
+   -t nthreads  worker threads, default the number of CPUs
+   -c entries   size of the cache, default 1048576 answers
+   -S nshards   independently locked parts of the cache, default 64
+
+The main thread accepts the connections and hands them over to the
+workers, in turn.  Each worker waits on its own connections with
+epoll; all the requests read in one wakeup form one batch: the answers
+found in the cache are taken from it, the others are sorted by date and
+longitude and computed by one call to sunriset_batch_altit, which
+computes the Sun's position once per instant, then stored in the
+cache.  The cache is a hash table with a least recently used list per
+shard.  SIGINT or SIGTERM stops the daemon, which then prints its
+counters on stderr.
+
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sunriset.h"
+#include "sunriset-daemon.h"
+
+
+#define BATCH_MAX   4096        /* Requests computed together, at most */
+#define IN_BUF      ( 64 * (int) sizeof(struct sunriset_request) )
+#define NIL         ( -1 )
+
+static volatile sig_atomic_t stopping = 0;
+
+static void on_signal( int sig )
+{
+      (void) sig;
+      stopping = 1;
+}
+
+static void *xcalloc( size_t n, size_t size )
+{
+      void *p = calloc( n, size );
+      if ( p == NULL )
+      {
+            fprintf( stderr, "sunriset-daemon: out of memory\n" );
+            exit( 1 );
+      }
+      return p;
+}
+
+
+/* The cache */
+
+/* A question, snapped to the grid: date is days_since_2000_Jan_0 */
+/* times 2, plus upper_limb                                        */
+struct cache_key
+{
+      int32_t lat, lon, altit, date;
+};
+
+struct cache_entry
+{
+      struct cache_key key;
+      double  rise, set;
+      int32_t rc;
+      int32_t chain;                    /* Next entry of the bucket */
+      int32_t newer, older;             /* LRU list */
+};
+
+struct cache_shard
+{
+      pthread_mutex_t lock;
+      struct cache_entry *e;
+      int32_t *bucket;
+      int32_t cap, used, mask;
+      int32_t newest, oldest;
+      long    hits, misses, evictions;
+} __attribute__(( aligned( 64 ) ));
+
+struct cache
+{
+      struct cache_shard *shard;
+      int nshards;
+};
+
+static uint64_t cache_hash( const struct cache_key *k )
+{
+      uint64_t h = (uint64_t) (uint32_t) k->lat * 0x9E3779B97F4A7C15ULL;
+      h ^= (uint64_t) (uint32_t) k->lon + 0x632BE59BD9B4E019ULL + ( h << 6 ) + ( h >> 2 );
+      h ^= (uint64_t) (uint32_t) k->altit + 0x85EBCA77C2B2AE63ULL + ( h << 6 ) + ( h >> 2 );
+      h ^= (uint64_t) (uint32_t) k->date + 0x27D4EB2F165667C5ULL + ( h << 6 ) + ( h >> 2 );
+      h ^= h >> 33;
+      h *= 0xFF51AFD7ED558CCDULL;
+      h ^= h >> 33;
+      return h;
+}
+
+static void cache_init( struct cache *c, long entries, int nshards )
+{
+      int s, nb;
+
+      c->nshards = nshards;
+      c->shard = xcalloc( nshards, sizeof *c->shard );
+      for ( s = 0; s < nshards; s++ )
+      {
+            struct cache_shard *sh = &c->shard[s];
+            pthread_mutex_init( &sh->lock, NULL );
+            sh->cap = (int32_t) ( ( entries + nshards - 1 ) / nshards );
+            if ( sh->cap < 1 )
+                  sh->cap = 1;
+            for ( nb = 1; nb < sh->cap; nb *= 2 )
+                  ;
+            sh->mask   = nb - 1;
+            sh->e      = xcalloc( sh->cap, sizeof *sh->e );
+            sh->bucket = xcalloc( nb, sizeof *sh->bucket );
+            memset( sh->bucket, 0xFF, nb * sizeof *sh->bucket );
+            sh->newest = sh->oldest = NIL;
+      }
+}
+
+static void lru_unlink( struct cache_shard *sh, int32_t i )
+{
+      struct cache_entry *e = &sh->e[i];
+      if ( e->newer != NIL )
+            sh->e[e->newer].older = e->older;
+      else
+            sh->newest = e->older;
+      if ( e->older != NIL )
+            sh->e[e->older].newer = e->newer;
+      else
+            sh->oldest = e->newer;
+}
+
+static void lru_push( struct cache_shard *sh, int32_t i )
+{
+      sh->e[i].newer = NIL;
+      sh->e[i].older = sh->newest;
+      if ( sh->newest != NIL )
+            sh->e[sh->newest].newer = i;
+      else
+            sh->oldest = i;
+      sh->newest = i;
+}
+
+/* Looks key up; on a hit, stores the answer and returns 1 */
+static int cache_get( struct cache *c, const struct cache_key *key,
+                      struct sunriset_response *res )
+{
+      uint64_t h = cache_hash( key );
+      struct cache_shard *sh = &c->shard[h % c->nshards];
+      int32_t i;
+
+      pthread_mutex_lock( &sh->lock );
+      for ( i = sh->bucket[( h >> 32 ) & sh->mask]; i != NIL; i = sh->e[i].chain )
+            if ( memcmp( &sh->e[i].key, key, sizeof *key ) == 0 )
+                  break;
+      if ( i != NIL )
+      {
+            res->rise = sh->e[i].rise;
+            res->set  = sh->e[i].set;
+            res->rc   = sh->e[i].rc;
+            lru_unlink( sh, i );
+            lru_push( sh, i );
+            sh->hits++;
+      }
+      else
+            sh->misses++;
+      pthread_mutex_unlock( &sh->lock );
+      return i != NIL;
+}
+
+/* Stores an answer, evicting the least recently used one if full */
+static void cache_put( struct cache *c, const struct cache_key *key,
+                       const struct sunriset_response *res )
+{
+      uint64_t h = cache_hash( key );
+      struct cache_shard *sh = &c->shard[h % c->nshards];
+      int32_t i, *p;
+
+      pthread_mutex_lock( &sh->lock );
+      for ( i = sh->bucket[( h >> 32 ) & sh->mask]; i != NIL; i = sh->e[i].chain )
+            if ( memcmp( &sh->e[i].key, key, sizeof *key ) == 0 )
+                  break;
+      if ( i == NIL )
+      {
+            if ( sh->used < sh->cap )
+                  i = sh->used++;
+            else
+            {
+                  /* Evict the oldest, unchaining it from its bucket */
+                  i = sh->oldest;
+                  lru_unlink( sh, i );
+                  for ( p = &sh->bucket[( cache_hash( &sh->e[i].key ) >> 32 ) & sh->mask];
+                        *p != i; p = &sh->e[*p].chain )
+                        ;
+                  *p = sh->e[i].chain;
+                  sh->evictions++;
+            }
+            sh->e[i].key   = *key;
+            sh->e[i].chain = sh->bucket[( h >> 32 ) & sh->mask];
+            sh->bucket[( h >> 32 ) & sh->mask] = i;
+      }
+      else
+            lru_unlink( sh, i );
+      sh->e[i].rise = res->rise;
+      sh->e[i].set  = res->set;
+      sh->e[i].rc   = res->rc;
+      lru_push( sh, i );
+      pthread_mutex_unlock( &sh->lock );
+}
+
+
+/* The workers */
+
+struct conn
+{
+      int    fd;
+      int    eof;                       /* The client closed its side */
+      uint32_t events;                  /* Waited for: EPOLLIN or EPOLLOUT */
+      unsigned char in[IN_BUF];
+      int    in_len;
+      unsigned char *out;
+      size_t out_len, out_cap, out_sent;
+};
+
+/* A request of the current batch */
+struct pending
+{
+      struct conn *c;
+      struct cache_key key;
+      struct sunriset_response res;
+      int    year, month, day, upper_limb;
+      int    hit;
+      int    invalid;                   /* Out of range: not computed */
+};
+
+struct worker
+{
+      pthread_t tid;
+      int    epfd;
+      struct cache *cache;
+      struct pending *pend;
+      long   *order;
+      int    *year, *month, *day, *upper_limb, *rc;
+      double *lon, *lat, *altit, *rise, *set;
+      long   requests, batches, computed, positions, invalid;
+};
+
+static struct worker *workers;
+static int nworkers;
+
+static void conn_close( struct worker *w, struct conn *c )
+{
+      epoll_ctl( w->epfd, EPOLL_CTL_DEL, c->fd, NULL );
+      close( c->fd );
+      free( c->out );
+      free( c );
+}
+
+/* Writes what it can of the output of c; returns 0 when all is written */
+static int conn_flush( struct conn *c )
+{
+      ssize_t k;
+
+      while ( c->out_sent < c->out_len )
+      {
+            k = write( c->fd, c->out + c->out_sent, c->out_len - c->out_sent );
+            if ( k < 0 && errno == EINTR )
+                  continue;
+            if ( k < 0 && errno == EAGAIN )
+                  return 1;
+            if ( k <= 0 )
+                  return -1;
+            c->out_sent += k;
+      }
+      c->out_len = c->out_sent = 0;
+      return 0;
+}
+
+static void conn_append( struct conn *c, const struct sunriset_response *res )
+{
+      if ( c->out_len + sizeof *res > c->out_cap )
+      {
+            c->out_cap = c->out_cap ? 2 * c->out_cap : 64 * sizeof *res;
+            c->out = realloc( c->out, c->out_cap );
+            if ( c->out == NULL )
+            {
+                  fprintf( stderr, "sunriset-daemon: out of memory\n" );
+                  exit( 1 );
+            }
+      }
+      memcpy( c->out + c->out_len, res, sizeof *res );
+      c->out_len += sizeof *res;
+}
+
+/* Whether the request is within the ranges of sunriset-daemon.h; the */
+/* negated tests also reject NaN                                       */
+static int request_valid( const struct sunriset_request *rq )
+{
+      int k;
+
+      for ( k = 0; k < (int) sizeof rq->pad; k++ )
+            if ( rq->pad[k] != 0 )
+                  return 0;
+      return rq->year >= 1801 && rq->year <= 2099
+             && rq->month >= 1 && rq->month <= 12
+             && rq->day >= 1 && rq->day <= 31
+             && fabs( rq->lat ) <= 90.0 && fabs( rq->lon ) <= 180.0
+             && fabs( rq->altit ) <= 90.0;
+}
+
+/* Reads the requests of c, at most room of them, into w->pend + n */
+static int conn_read( struct worker *w, struct conn *c, int n, int room )
+{
+      struct sunriset_request rq;
+      struct pending *p;
+      ssize_t k;
+      int    want, off;
+
+      want = room * (int) sizeof rq - c->in_len;
+      if ( want > IN_BUF - c->in_len )
+            want = IN_BUF - c->in_len;
+      k = read( c->fd, c->in + c->in_len, want );
+      if ( k < 0 && ( errno == EINTR || errno == EAGAIN ) )
+            return n;
+      if ( k <= 0 )
+      {
+            c->eof = 1;
+            return n;
+      }
+      c->in_len += k;
+
+      for ( off = 0; off + (int) sizeof rq <= c->in_len; off += sizeof rq )
+      {
+            memcpy( &rq, c->in + off, sizeof rq );
+            p = &w->pend[n++];
+            p->c = c;
+            p->res.id = rq.id;
+            p->invalid = !request_valid( &rq );
+            if ( p->invalid )
+            {
+                  p->res.rc   = SUNRISETD_EINVAL;
+                  p->res.rise = p->res.set = 0.0;
+                  continue;
+            }
+            p->year = rq.year, p->month = rq.month, p->day = rq.day;
+            p->upper_limb = rq.upper_limb != 0;
+            p->key.lat   = sunrisetd_snap( rq.lat );
+            p->key.lon   = sunrisetd_snap( rq.lon );
+            p->key.altit = sunrisetd_snap( rq.altit );
+            p->key.date  = (int32_t) ( 2 * days_since_2000_Jan_0( rq.year, rq.month, rq.day )
+                                       + p->upper_limb );
+      }
+      memmove( c->in, c->in + off, c->in_len - off );
+      c->in_len -= off;
+      return n;
+}
+
+static _Thread_local struct pending *sort_pend;
+
+/* Order of the computation: date, then longitude, so that the Sun's */
+/* position is shared; then the rest of the key, so that duplicates  */
+/* are neighbours                                                     */
+static int cmp_pending( const void *a, const void *b )
+{
+      const struct cache_key *x = &sort_pend[*(const long *) a].key;
+      const struct cache_key *y = &sort_pend[*(const long *) b].key;
+      if ( x->date >> 1 != y->date >> 1 )
+            return x->date >> 1 < y->date >> 1 ? -1 : 1;
+      if ( x->lon != y->lon )
+            return x->lon < y->lon ? -1 : 1;
+      if ( x->lat != y->lat )
+            return x->lat < y->lat ? -1 : 1;
+      if ( x->altit != y->altit )
+            return x->altit < y->altit ? -1 : 1;
+      return ( x->date & 1 ) - ( y->date & 1 );
+}
+
+/* Answers the n requests of w->pend: cache, then one batch */
+static void batch_run( struct worker *w, int n )
+{
+      struct pending *p;
+      long   i, j, m = 0, u = 0;
+
+      for ( i = 0; i < n; i++ )
+      {
+            p = &w->pend[i];
+            if ( p->invalid )
+            {
+                  w->invalid++;
+                  continue;
+            }
+            p->hit = cache_get( w->cache, &p->key, &p->res );
+            if ( !p->hit )
+                  w->order[m++] = i;
+      }
+
+      if ( m > 0 )
+      {
+            /* qsort has no context argument: the array to sort by is */
+            /* per thread                                             */
+            sort_pend = w->pend;
+            qsort( w->order, m, sizeof *w->order, cmp_pending );
+
+            /* The distinct questions, in order */
+            for ( i = 0; i < m; i++ )
+            {
+                  p = &w->pend[w->order[i]];
+                  if ( u > 0 && memcmp( &p->key, &w->pend[w->order[i-1]].key,
+                                        sizeof p->key ) == 0 )
+                        continue;
+                  w->year[u]  = p->year;
+                  w->month[u] = p->month;
+                  w->day[u]   = p->day;
+                  w->lon[u]   = p->key.lon * SUNRISETD_QUANTUM;
+                  w->lat[u]   = p->key.lat * SUNRISETD_QUANTUM;
+                  w->altit[u] = p->key.altit * SUNRISETD_QUANTUM;
+                  w->upper_limb[u] = p->upper_limb;
+                  u++;
+            }
+            w->positions += sunriset_batch_altit( u, w->year, w->month, w->day,
+                                                  w->lon, w->lat, w->altit,
+                                                  w->upper_limb, w->rise,
+                                                  w->set, w->rc );
+            w->computed += u;
+
+            /* Back to the requests, and into the cache */
+            for ( i = 0, j = -1; i < m; i++ )
+            {
+                  p = &w->pend[w->order[i]];
+                  if ( j < 0 || memcmp( &p->key, &w->pend[w->order[i-1]].key,
+                                        sizeof p->key ) != 0 )
+                  {
+                        j++;
+                        p->res.rise = w->rise[j];
+                        p->res.set  = w->set[j];
+                        p->res.rc   = w->rc[j];
+                        cache_put( w->cache, &p->key, &p->res );
+                  }
+                  else
+                        p->res = ( struct sunriset_response ) {
+                              p->res.id, w->rc[j], w->rise[j], w->set[j] };
+            }
+      }
+
+      for ( i = 0; i < n; i++ )
+            conn_append( w->pend[i].c, &w->pend[i].res );
+      w->requests += n;
+      w->batches++;
+}
+
+/* After a batch: sends the answers, and waits for the next requests, */
+/* or for room to send the rest                                        */
+static void conn_events( struct worker *w, struct conn *c )
+{
+      struct epoll_event ev;
+      int rc;
+
+      rc = conn_flush( c );
+      if ( rc < 0 || ( c->eof && rc == 0 ) )
+      {
+            conn_close( w, c );
+            return;
+      }
+      ev.data.ptr = c;
+      ev.events = rc > 0 ? EPOLLOUT : EPOLLIN;
+      if ( ev.events != c->events )
+            epoll_ctl( w->epfd, EPOLL_CTL_MOD, c->fd, &ev );
+      c->events = ev.events;
+}
+
+static void *worker_main( void *arg )
+{
+      struct worker *w = arg;
+      struct epoll_event ev[64];
+      struct conn *touched[64];
+      int    nev, i, n, nt;
+
+      while ( !stopping )
+      {
+            nev = epoll_wait( w->epfd, ev, 64, 200 );
+            if ( nev <= 0 )
+                  continue;
+
+            /* One batch with the requests of all the ready connections */
+            n = nt = 0;
+            for ( i = 0; i < nev; i++ )
+            {
+                  struct conn *c = ev[i].data.ptr;
+                  /* A full batch leaves the requests in the socket for */
+                  /* the next wakeup; eof only when read() returns 0     */
+                  if ( ev[i].events & EPOLLIN )
+                  {
+                        if ( n < BATCH_MAX )
+                              n = conn_read( w, c, n, BATCH_MAX - n );
+                  }
+                  else if ( ev[i].events & ( EPOLLHUP | EPOLLERR ) )
+                        c->eof = 1;
+                  touched[nt++] = c;
+            }
+            if ( n > 0 )
+                  batch_run( w, n );
+            for ( i = 0; i < nt; i++ )
+                  conn_events( w, touched[i] );
+      }
+      return NULL;
+}
+
+
+int main( int argc, char **argv )
+{
+      const char *path = SUNRISETD_PATH;
+      long   entries = 1L << 20;
+      int    nshards = 64, opt, lfd, fd, next = 0, i;
+      struct sockaddr_un addr;
+      struct sigaction sa;
+      struct pollfd pfd;
+      struct cache cache;
+      long   hits = 0, misses = 0, evictions = 0, requests = 0, batches = 0,
+             computed = 0, positions = 0, invalid = 0;
+
+      nworkers = (int) sysconf( _SC_NPROCESSORS_ONLN );
+      while ( ( opt = getopt( argc, argv, "s:t:c:S:" ) ) != -1 )
+            switch ( opt )
+            {
+            case 's': path = optarg; break;
+            case 't': nworkers = atoi( optarg ); break;
+            case 'c': entries = atol( optarg ); break;
+            case 'S': nshards = atoi( optarg ); break;
+            default:
+                  fprintf( stderr, "Usage: sunriset-daemon [-s path] [-t nthreads]"
+                                   " [-c entries] [-S nshards]\n" );
+                  return 1;
+            }
+      if ( nworkers < 1 )
+            nworkers = 1;
+      if ( nshards < 1 )
+            nshards = 1;
+
+      memset( &sa, 0, sizeof sa );
+      sa.sa_handler = on_signal;
+      sigaction( SIGINT, &sa, NULL );
+      sigaction( SIGTERM, &sa, NULL );
+      signal( SIGPIPE, SIG_IGN );
+
+      memset( &addr, 0, sizeof addr );
+      addr.sun_family = AF_UNIX;
+      if ( strlen( path ) >= sizeof addr.sun_path )
+      {
+            fprintf( stderr, "sunriset-daemon: %s: path too long\n", path );
+            return 1;
+      }
+      strcpy( addr.sun_path, path );
+      unlink( path );
+      if ( ( lfd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) < 0
+           || bind( lfd, (struct sockaddr *) &addr, sizeof addr ) < 0
+           || listen( lfd, 128 ) < 0 )
+      {
+            perror( path );
+            return 1;
+      }
+
+      cache_init( &cache, entries, nshards );
+      workers = xcalloc( nworkers, sizeof *workers );
+      for ( i = 0; i < nworkers; i++ )
+      {
+            struct worker *w = &workers[i];
+            w->cache = &cache;
+            w->pend  = xcalloc( BATCH_MAX, sizeof *w->pend );
+            w->order = xcalloc( BATCH_MAX, sizeof *w->order );
+            w->year  = xcalloc( BATCH_MAX, sizeof(int) );
+            w->month = xcalloc( BATCH_MAX, sizeof(int) );
+            w->day   = xcalloc( BATCH_MAX, sizeof(int) );
+            w->upper_limb = xcalloc( BATCH_MAX, sizeof(int) );
+            w->rc    = xcalloc( BATCH_MAX, sizeof(int) );
+            w->lon   = xcalloc( BATCH_MAX, sizeof(double) );
+            w->lat   = xcalloc( BATCH_MAX, sizeof(double) );
+            w->altit = xcalloc( BATCH_MAX, sizeof(double) );
+            w->rise  = xcalloc( BATCH_MAX, sizeof(double) );
+            w->set   = xcalloc( BATCH_MAX, sizeof(double) );
+            if ( ( w->epfd = epoll_create1( EPOLL_CLOEXEC ) ) < 0
+                 || pthread_create( &w->tid, NULL, worker_main, w ) != 0 )
+            {
+                  perror( "sunriset-daemon" );
+                  return 1;
+            }
+      }
+      fprintf( stderr, "sunriset-daemon: listening on %s, %d threads,"
+                       " %ld cache entries in %d shards\n",
+               path, nworkers, entries, nshards );
+
+      /* Accept the connections, and give them to the workers in turn */
+      pfd.fd = lfd;
+      pfd.events = POLLIN;
+      while ( !stopping )
+      {
+            struct epoll_event ev;
+            struct conn *c;
+
+            if ( poll( &pfd, 1, 200 ) <= 0 )
+                  continue;
+            if ( ( fd = accept4( lfd, NULL, NULL,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC ) ) < 0 )
+                  continue;
+            c = xcalloc( 1, sizeof *c );
+            c->fd = fd;
+            c->events = ev.events = EPOLLIN;
+            ev.data.ptr = c;
+            if ( epoll_ctl( workers[next].epfd, EPOLL_CTL_ADD, fd, &ev ) < 0 )
+            {
+                  close( fd );
+                  free( c );
+            }
+            next = ( next + 1 ) % nworkers;
+      }
+
+      for ( i = 0; i < nworkers; i++ )
+      {
+            pthread_join( workers[i].tid, NULL );
+            requests  += workers[i].requests;
+            batches   += workers[i].batches;
+            computed  += workers[i].computed;
+            positions += workers[i].positions;
+            invalid   += workers[i].invalid;
+      }
+      for ( i = 0; i < nshards; i++ )
+      {
+            hits      += cache.shard[i].hits;
+            misses    += cache.shard[i].misses;
+            evictions += cache.shard[i].evictions;
+      }
+      close( lfd );
+      unlink( path );
+      fprintf( stderr, "sunriset-daemon: %ld requests in %ld batches (%.1f per batch),"
+                       " %ld cache hits, %ld misses, %ld evictions,"
+                       " %ld answers computed with %ld Sun's positions,"
+                       " %ld requests out of range\n",
+               requests, batches, batches ? (double) requests / batches : 0.0,
+               hits, misses, evictions, computed, positions, invalid );
+      return 0;
+}
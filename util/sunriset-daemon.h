@@ -0,0 +1,63 @@
+/*
+
+SUNRISET-DAEMON.H - the protocol of the sunriset-daemon program
+
+Clients connect to a Unix domain stream socket, SUNRISETD_PATH unless
+given otherwise, and write requests, struct sunriset_request, without
+waiting for the responses: the daemon answers each request with one
+struct sunriset_response, in the order of the requests of the
+connection.  Both are in the byte order of the host, which is shared
+by the client and the daemon.
+
+The daemon snaps the latitude, the longitude and the altitude to
+multiples of SUNRISETD_QUANTUM degree (about 11 meters) before
+computing, so that close requests share a cache entry.  The answer is
+that of __sunriset__ for the snapped values, see sunrisetd_snap().
+A request out of range (year not within 1801-2099, month not within
+1-12, day not within 1-31, latitude, longitude or altitude not finite
+or beyond 90, 180 and 90 degrees, pad not zero) is answered with rc
+SUNRISETD_EINVAL, rise and set 0.
+
+*/
+
+#ifndef SUNRISET_DAEMON_H
+#define SUNRISET_DAEMON_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define SUNRISETD_PATH      "/tmp/sunriset-daemon.sock"
+#define SUNRISETD_QUANTUM   1e-4
+#define SUNRISETD_EINVAL    ( -2 )      /* rc of a request out of range */
+
+/* One question: the parameters of __sunriset__ */
+struct sunriset_request
+{
+      uint32_t id;                      /* Echoed in the response */
+      int16_t  year;                    /* 1801-2099 */
+      uint8_t  month, day;
+      uint8_t  upper_limb;
+      uint8_t  pad[7];                  /* Zero */
+      double   lat, lon;                /* Degrees */
+      double   altit;                   /* Degrees, e.g. -35/60 */
+};
+
+/* Its answer: rise and set, hours UT, and the return code of */
+/* __sunriset__, or SUNRISETD_EINVAL                          */
+struct sunriset_response
+{
+      uint32_t id;
+      int32_t  rc;
+      double   rise, set;
+};
+
+_Static_assert( sizeof(struct sunriset_request) == 40, "request size" );
+_Static_assert( sizeof(struct sunriset_response) == 24, "response size" );
+
+/* An angle snapped to the grid of the cache, in units of the quantum */
+static inline int32_t sunrisetd_snap( double deg )
+{
+      return (int32_t) lrint( deg / SUNRISETD_QUANTUM );
+}
+
+#endif  /* SUNRISET_DAEMON_H */
@@ -0,0 +1,273 @@
+/*
+
+SUNRISET-LOAD.C - load generator for sunriset-daemon
+
+Usage: sunriset-load [-s path] [-c nconn] [-n nrequests] [-d depth]
+                     [-k nkeys] [-v]
+
+   -s path       the socket of the daemon, default SUNRISETD_PATH
+   -c nconn      connections, one thread each, default 4
+   -n nrequests  requests per connection, default 200000
+   -d depth      requests in flight per connection, default 64
+   -k nkeys      distinct questions: nkeys/4 sites and dates drawn at
+                 random, each asked for the 4 kinds in a row, as
+                 Astro::Sunrise users do; the hit rate of the cache
+                 goes up as nkeys goes down; default 100000
+   -v            checks every answer against __sunriset__
+
+Each connection writes requests until depth of them wait for their
+answer, then reads the answers which have arrived, and so on.  The
+latency of a request runs from the write which sends it to the read
+which receives its answer.  Prints the throughput and the latency
+percentiles over all the connections.
+
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sunriset.h"
+#include "sunriset-daemon.h"
+
+
+static const char *path = SUNRISETD_PATH;
+static long  nreq = 200000, nkeys = 100000;
+static int   depth = 64, verify = 0;
+
+static const double kind_altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+
+struct client
+{
+      pthread_t tid;
+      unsigned long seed, site;
+      float  *latency;                  /* Microseconds, per request */
+      long   done, wrong;
+      int    failed;
+};
+
+static double now( void )
+{
+      struct timespec ts;
+      clock_gettime( CLOCK_MONOTONIC, &ts );
+      return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static unsigned long mix( unsigned long x )
+{
+      x += 0x9E3779B97F4A7C15UL;
+      x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9UL;
+      x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBUL;
+      return x ^ ( x >> 31 );
+}
+
+/* Question number q: always the same site, date and kind; the 4 kinds */
+/* of a site and date are 4 consecutive numbers                          */
+static void question( unsigned long q, struct sunriset_request *rq )
+{
+      unsigned long h = mix( q / 4 );
+      int kind = (int) ( q % 4 );
+
+      memset( rq, 0, sizeof *rq );
+      rq->year  = 2024;
+      rq->month = 1 + (int) ( ( h >> 8 ) % 12 );
+      rq->day   = 1 + (int) ( ( h >> 16 ) % 28 );
+      rq->lat   = -65.0 + ( ( h >> 24 ) % 1300000 ) * 1e-4;
+      rq->lon   = -180.0 + ( mix( h ) % 3600000 ) * 1e-4;
+      rq->altit = kind_altit[kind];
+      rq->upper_limb = kind == 0;
+}
+
+static int check( const struct sunriset_request *rq,
+                  const struct sunriset_response *res )
+{
+      double rise, set;
+      int    rc;
+
+      rc = __sunriset__( rq->year, rq->month, rq->day,
+                         sunrisetd_snap( rq->lon ) * SUNRISETD_QUANTUM,
+                         sunrisetd_snap( rq->lat ) * SUNRISETD_QUANTUM,
+                         sunrisetd_snap( rq->altit ) * SUNRISETD_QUANTUM,
+                         rq->upper_limb, &rise, &set );
+      return rc == res->rc && rise == res->rise && set == res->set;
+}
+
+static void *client_main( void *arg )
+{
+      struct client *cl = arg;
+      struct sockaddr_un addr;
+      struct sunriset_request  *rq = malloc( depth * sizeof *rq );
+      struct sunriset_response *res = malloc( depth * sizeof *res );
+      double *sent = malloc( depth * sizeof *sent ), t;
+      long   nsent = 0, inflight, k, i;
+      size_t have = 0;
+      int    fd;
+
+      memset( &addr, 0, sizeof addr );
+      addr.sun_family = AF_UNIX;
+      strncpy( addr.sun_path, path, sizeof addr.sun_path - 1 );
+      if ( !rq || !res || !sent
+           || ( fd = socket( AF_UNIX, SOCK_STREAM, 0 ) ) < 0
+           || connect( fd, (struct sockaddr *) &addr, sizeof addr ) < 0 )
+      {
+            perror( path );
+            cl->failed = 1;
+            return NULL;
+      }
+
+      while ( cl->done < nreq )
+      {
+            /* Fill the window: the slot of request i is i % depth */
+            inflight = nsent - cl->done;
+            for ( k = 0; k < depth - inflight && nsent + k < nreq; k++ )
+            {
+                  i = ( nsent + k ) % depth;
+                  if ( ( nsent + k ) % 4 == 0 )
+                  {
+                        cl->seed = cl->seed * 6364136223846793005UL + 1442695040888963407UL;
+                        cl->site = ( cl->seed >> 17 ) % ( ( nkeys + 3 ) / 4 );
+                  }
+                  question( 4 * cl->site + ( nsent + k ) % 4, &rq[i] );
+                  rq[i].id = (uint32_t) ( nsent + k );
+            }
+            if ( k > 0 )
+            {
+                  struct sunriset_request buf[k];
+                  for ( i = 0; i < k; i++ )
+                        buf[i] = rq[( nsent + i ) % depth];
+                  t = now();
+                  if ( write( fd, buf, k * sizeof *buf ) != (ssize_t) ( k * sizeof *buf ) )
+                  {
+                        perror( "sunriset-load: write" );
+                        cl->failed = 1;
+                        break;
+                  }
+                  for ( i = 0; i < k; i++ )
+                        sent[( nsent + i ) % depth] = t;
+                  nsent += k;
+            }
+
+            /* The answers which have arrived, at least one */
+            k = read( fd, (char *) res + have, depth * sizeof *res - have );
+            if ( k < 0 && errno == EINTR )
+                  continue;
+            if ( k <= 0 )
+            {
+                  fprintf( stderr, "sunriset-load: connection closed\n" );
+                  cl->failed = 1;
+                  break;
+            }
+            t = now();
+            have += k;
+            for ( i = 0; i < (long) ( have / sizeof *res ); i++ )
+            {
+                  long slot = cl->done % depth;
+                  if ( res[i].id != (uint32_t) cl->done )
+                  {
+                        fprintf( stderr, "sunriset-load: answer %u out of order\n",
+                                 res[i].id );
+                        cl->failed = 1;
+                        break;
+                  }
+                  cl->latency[cl->done] = (float) ( 1e6 * ( t - sent[slot] ) );
+                  if ( verify && !check( &rq[slot], &res[i] ) )
+                        cl->wrong++;
+                  cl->done++;
+            }
+            if ( cl->failed )
+                  break;
+            memmove( res, (char *) res + i * sizeof *res, have - i * sizeof *res );
+            have -= i * sizeof *res;
+      }
+      close( fd );
+      free( rq ); free( res ); free( sent );
+      return NULL;
+}
+
+static int cmp_float( const void *a, const void *b )
+{
+      float x = *(const float *) a, y = *(const float *) b;
+      return x < y ? -1 : x > y;
+}
+
+int main( int argc, char **argv )
+{
+      struct client *cl;
+      float  *all;
+      long   total = 0, wrong = 0;
+      int    nconn = 4, opt, c, failed = 0;
+      double t0, t1;
+
+      while ( ( opt = getopt( argc, argv, "s:c:n:d:k:v" ) ) != -1 )
+            switch ( opt )
+            {
+            case 's': path = optarg; break;
+            case 'c': nconn = atoi( optarg ); break;
+            case 'n': nreq = atol( optarg ); break;
+            case 'd': depth = atoi( optarg ); break;
+            case 'k': nkeys = atol( optarg ); break;
+            case 'v': verify = 1; break;
+            default:
+                  fprintf( stderr, "Usage: sunriset-load [-s path] [-c nconn]"
+                                   " [-n nrequests] [-d depth] [-k nkeys] [-v]\n" );
+                  return 1;
+            }
+      if ( nconn < 1 || nreq < 1 || depth < 1 || nkeys < 1 )
+      {
+            fprintf( stderr, "sunriset-load: the counts must be positive\n" );
+            return 1;
+      }
+
+      cl = calloc( nconn, sizeof *cl );
+      all = malloc( nconn * nreq * sizeof *all );
+      if ( cl == NULL || all == NULL )
+      {
+            fprintf( stderr, "sunriset-load: out of memory\n" );
+            return 1;
+      }
+      t0 = now();
+      for ( c = 0; c < nconn; c++ )
+      {
+            cl[c].seed = mix( c + 1 );
+            cl[c].latency = all + c * nreq;
+            if ( pthread_create( &cl[c].tid, NULL, client_main, &cl[c] ) != 0 )
+            {
+                  perror( "sunriset-load" );
+                  return 1;
+            }
+      }
+      for ( c = 0; c < nconn; c++ )
+            pthread_join( cl[c].tid, NULL );
+      t1 = now();
+
+      /* Latencies of the completed requests, packed */
+      for ( c = 0; c < nconn; c++ )
+      {
+            memmove( all + total, cl[c].latency, cl[c].done * sizeof *all );
+            total += cl[c].done;
+            wrong += cl[c].wrong;
+            failed |= cl[c].failed;
+      }
+      if ( total == 0 )
+            return 1;
+      qsort( all, total, sizeof *all, cmp_float );
+      printf( "sunriset-load: %d connections, depth %d, %ld distinct questions\n",
+              nconn, depth, nkeys );
+      printf( "  %ld requests in %.3f s: %.0f requests/s\n",
+              total, t1 - t0, total / ( t1 - t0 ) );
+      printf( "  latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+              all[total / 2], all[total * 9 / 10], all[total * 99 / 100],
+              all[total * 999 / 1000], all[total - 1] );
+      if ( verify )
+            printf( "  %ld answers differ from __sunriset__\n", wrong );
+      free( all ); free( cl );
+      return failed || wrong != 0;
+}
@@ -0,0 +1,684 @@
+/*
+
+SUNRISET-MAIN.C - the sunriset program: a small test program of the
+                  functions of SUNRISET.C, and a few batch modes
+
+Usage: sunriset                   interactive
+       sunriset almanac year lat0 lat1 dlat lon0 lon1 dlon [nthreads]
+                                  CSV table of the whole year for
+                                  a grid of sites
+       sunriset stream [-b] [file] non-interactive: reads records
+                                  "lat lon yyyy mm dd", writes
+                                  CSV or binary (-b) results, see
+                                  sunriset_stream()
+       sunriset almanac-file file year0 year1 lat0 lat1 dlat
+                             lon0 lon1 dlon [nthreads]
+                                  builds an almanac file
+       sunriset lookup file lat lon yyyy mm dd
+                                  reads an almanac file
+       sunriset crossings year lat lon rise|set hh:mm tz
+                                  days when sunrise or sunset goes
+                                  past a local clock time, and
+                                  polar nights and days
+       sunriset polar yyyy mm dd [lon]
+                                  latitudes of polar night and day
+       sunriset timeline year lat lon
+                                  periods of midnight sun, polar
+                                  night and continuous twilight
+       sunriset raster file yyyy mm dd [step]
+                                  writes the raster file of the
+                                  sunrise, sunset and day length
+                                  of the whole Earth, step degree
+                                  cells (default 0.1)
+       sunriset diff [file]       reads records "yyyy mm dd lon lat
+                                  altit upper_limb", writes the
+                                  results of each C path and their
+                                  speed, for util/check-diff
+
+Built with -DSUNRISET_STATS (see sunriset.h), the program writes the
+counters of the library as JSON at exit, to the file named by the
+environment variable SUNRISET_STATS, or to stderr if it is "-".
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "sunriset.h"
+
+
+/* Grid size from its bounds and step */
+static int grid_size( double lo, double hi, double step )
+{
+      return (int) floor( ( hi - lo ) / step + 1e-9 ) + 1;
+}
+
+static int almanac_main( int argc, char **argv )
+{
+      int    year, nthreads = 1, ndays, nlat, nlon, i, j, k, day, month;
+      long   nsites, s, idx;
+      double lat0, lat1, dlat, lon0, lon1, dlon;
+      double *lon, *lat, *rise, *set;
+      int    *rc;
+      struct sun_ephem eph;
+      static char obuf[1 << 16];
+
+      if ( argc < 7 )
+      {
+            fprintf( stderr, "Usage: sunriset almanac year lat0 lat1 dlat"
+                             " lon0 lon1 dlon [nthreads]\n" );
+            return 1;
+      }
+      year = atoi( argv[0] );
+      lat0 = atof( argv[1] ); lat1 = atof( argv[2] ); dlat = atof( argv[3] );
+      lon0 = atof( argv[4] ); lon1 = atof( argv[5] ); dlon = atof( argv[6] );
+      if ( argc > 7 )
+            nthreads = atoi( argv[7] );
+      if ( dlat <= 0.0 || dlon <= 0.0 || lat1 < lat0 || lon1 < lon0 )
+      {
+            fprintf( stderr, "sunriset: empty grid\n" );
+            return 1;
+      }
+
+      /* Sites, row by row: one latitude, all the longitudes */
+      nlat   = grid_size( lat0, lat1, dlat );
+      nlon   = grid_size( lon0, lon1, dlon );
+      nsites = (long) nlat * nlon;
+      ndays  = almanac_days( year );
+      lon  = malloc( nsites * sizeof(double) );
+      lat  = malloc( nsites * sizeof(double) );
+      rise = malloc( SUNRISET_KINDS * ndays * nsites * sizeof(double) );
+      set  = malloc( SUNRISET_KINDS * ndays * nsites * sizeof(double) );
+      rc   = malloc( SUNRISET_KINDS * ndays * nsites * sizeof(int) );
+      if ( !lon || !lat || !rise || !set || !rc
+           || sun_ephem_init( &eph, year, year, 1.0 ) != 0 )
+      {
+            fprintf( stderr, "sunriset: out of memory\n" );
+            return 1;
+      }
+      for ( i = 0; i < nlat; i++ )
+            for ( j = 0; j < nlon; j++ )
+            {
+                  lat[(long) i*nlon+j] = lat0 + i * dlat;
+                  lon[(long) i*nlon+j] = lon0 + j * dlon;
+            }
+
+      if ( sunriset_almanac( year, nsites, lon, lat, nthreads, ISA_SCALAR,
+                             &eph, rise, set, rc ) != 0 )
+      {
+            fprintf( stderr, "sunriset: cannot start the threads\n" );
+            return 1;
+      }
+
+      /* The output order depends only on the grid, not on the threads */
+      setvbuf( stdout, obuf, _IOFBF, sizeof obuf );
+      printf( "date,lat,lon,rs,rise,set,civ,civ_start,civ_end,"
+              "naut,naut_start,naut_end,astr,astr_start,astr_end\n" );
+      month = 1;
+      for ( day = 0; day < ndays; day++ )
+      {
+            int dd = days_since_2000_Jan_0(year,1,1) + day;
+            while ( month < 12
+                    && days_since_2000_Jan_0(year,month+1,1) <= dd )
+                  month++;
+            for ( s = 0; s < nsites; s++ )
+            {
+                  printf( "%04d-%02d-%02d,%.4f,%.4f", year, month,
+                          dd - (int) days_since_2000_Jan_0(year,month,1) + 1,
+                          lat[s], lon[s] );
+                  for ( k = 0; k < SUNRISET_KINDS; k++ )
+                  {
+                        idx = ( (long) k * ndays + day ) * nsites + s;
+                        printf( ",%d,%.4f,%.4f", rc[idx], rise[idx], set[idx] );
+                  }
+                  putchar( '\n' );
+            }
+      }
+      fflush( stdout );
+
+      sun_ephem_free( &eph );
+      free( lon ); free( lat ); free( rise ); free( set ); free( rc );
+      return 0;
+}
+
+static int almfile_main( int argc, char **argv )
+{
+      int year0, year1, nthreads = 1;
+      double lat0, lat1, dlat, lon0, lon1, dlon;
+
+      if ( argc < 9 )
+      {
+            fprintf( stderr, "Usage: sunriset almanac-file file year0 year1"
+                             " lat0 lat1 dlat lon0 lon1 dlon [nthreads]\n" );
+            return 1;
+      }
+      year0 = atoi( argv[1] ); year1 = atoi( argv[2] );
+      lat0 = atof( argv[3] ); lat1 = atof( argv[4] ); dlat = atof( argv[5] );
+      lon0 = atof( argv[6] ); lon1 = atof( argv[7] ); dlon = atof( argv[8] );
+      if ( argc > 9 )
+            nthreads = atoi( argv[9] );
+      if ( year0 < 1801 || year1 > 2099 || year1 < year0
+           || dlat <= 0.0 || dlon <= 0.0 || lat1 < lat0 || lon1 < lon0 )
+      {
+            fprintf( stderr, "sunriset: wrong years or grid\n" );
+            return 1;
+      }
+      if ( almanac_write( argv[0], year0, year1,
+                          lat0, dlat, grid_size( lat0, lat1, dlat ),
+                          lon0, dlon, grid_size( lon0, lon1, dlon ),
+                          nthreads ) != 0 )
+      {
+            perror( argv[0] );
+            return 1;
+      }
+      return 0;
+}
+
+static int lookup_main( int argc, char **argv )
+{
+      struct almanac_file af;
+      double rise, set;
+      int    k, rc;
+
+      if ( argc < 6 )
+      {
+            fprintf( stderr, "Usage: sunriset lookup file lat lon yyyy mm dd\n" );
+            return 1;
+      }
+      if ( almanac_open( &af, argv[0] ) != 0 )
+      {
+            fprintf( stderr, "sunriset: %s is not an almanac file\n", argv[0] );
+            return 1;
+      }
+      for ( k = 0; k < SUNRISET_KINDS; k++ )
+      {
+            rc = almanac_lookup( &af, atoi( argv[3] ), atoi( argv[4] ),
+                                 atoi( argv[5] ), atof( argv[2] ),
+                                 atof( argv[1] ), k, &rise, &set );
+            if ( rc == ALMFILE_OUTSIDE )
+            {
+                  fprintf( stderr, "sunriset: not in %s\n", argv[0] );
+                  return 1;
+            }
+            printf( "%d %.4f %.4f\n", rc, rise, set );
+      }
+      almanac_close( &af );
+      return 0;
+}
+
+static const char *cross_state( int state )
+{
+      switch ( state )
+      {
+      case CROSS_NIGHT:  return "night";
+      case CROSS_BEFORE: return "before";
+      case CROSS_AFTER:  return "after";
+      default:           return "day";
+      }
+}
+
+/* Month and day of day k of the year, 0 = January 1st */
+static void year_day( int year, int k, int *month, int *day )
+{
+      long doy0 = days_since_2000_Jan_0( year, 1, 1 );
+
+      for ( *month = 1; *month < 12
+                        && days_since_2000_Jan_0( year, *month + 1, 1 ) - doy0 <= k;
+            ( *month )++ )
+            ;
+      *day = (int) ( k + 1 - ( days_since_2000_Jan_0( year, *month, 1 ) - doy0 ) );
+}
+
+static int crossings_main( int argc, char **argv )
+{
+      struct sunriset_crossing cross[64];
+      int    year, event, state0, n, k, month, day, hh, mm;
+
+      if ( argc < 6 || sscanf( argv[4], "%d:%d", &hh, &mm ) != 2
+           || ( strcmp( argv[3], "rise" ) != 0 && strcmp( argv[3], "set" ) != 0 ) )
+      {
+            fprintf( stderr, "Usage: sunriset crossings year lat lon rise|set"
+                             " hh:mm tz\n" );
+            return 1;
+      }
+      year  = atoi( argv[0] );
+      event = strcmp( argv[3], "rise" ) == 0 ? CROSS_RISE : CROSS_SET;
+      n = sunriset_crossings( year, atof( argv[2] ), atof( argv[1] ),
+                              -35.0/60.0, 1, event, hh + mm / 60.0,
+                              atof( argv[5] ), &state0, cross, 64, NULL );
+      printf( "%04d-01-01 %s\n", year, cross_state( state0 ) );
+      for ( k = 0; k < n && k < 64; k++ )
+      {
+            year_day( year, cross[k].day, &month, &day );
+            printf( "%04d-%02d-%02d %s\n", year, month, day,
+                    cross_state( cross[k].to ) );
+      }
+      return 0;
+}
+
+static int timeline_main( int argc, char **argv )
+{
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const int upper_limb[4] = { 1, 0, 0, 0 };
+      static const char *kind[4] = { "Rise/set", "Civil twilight",
+                                     "Nautical twilight", "Astronomical twilight" };
+      struct timeline_arena a;
+      double lon, lat;
+      long   first[2], i;
+      int    year, m0, d0, m1, d1;
+
+      if ( argc < 3 )
+      {
+            fprintf( stderr, "Usage: sunriset timeline year lat lon\n" );
+            return 1;
+      }
+      year = atoi( argv[0] );
+      lat  = atof( argv[1] );
+      lon  = atof( argv[2] );
+      if ( timeline_arena_init( &a, 16 ) != 0
+           || polar_timeline( &a, year, 1, &lon, &lat, 4, altit, upper_limb,
+                              first ) < 0 )
+      {
+            fprintf( stderr, "sunriset: out of memory\n" );
+            return 1;
+      }
+      for ( i = first[0]; i < first[1]; i++ )
+      {
+            year_day( year, a.iv[i].first, &m0, &d0 );
+            year_day( year, a.iv[i].last, &m1, &d1 );
+            printf( "%-22s %s  %04d-%02d-%02d .. %04d-%02d-%02d\n",
+                    kind[(int) a.iv[i].kind],
+                    a.iv[i].rc > 0 ? "Sun always above" : "Sun always below",
+                    year, m0, d0, year, m1, d1 );
+      }
+      timeline_arena_free( &a );
+      return 0;
+}
+
+static int polar_main( int argc, char **argv )
+{
+      double night[2], day[2];
+
+      if ( argc < 3 )
+      {
+            fprintf( stderr, "Usage: sunriset polar yyyy mm dd [lon]\n" );
+            return 1;
+      }
+      polar_latitudes( atoi( argv[0] ), atoi( argv[1] ), atoi( argv[2] ),
+                       argc > 3 ? atof( argv[3] ) : 0.0, -35.0/60.0, 1,
+                       night, day );
+      if ( night[0] >= -90.0 )
+            printf( "Polar night south of %7.3f\n", night[0] );
+      if ( night[1] <= 90.0 )
+            printf( "Polar night north of %7.3f\n", night[1] );
+      if ( day[0] >= -90.0 )
+            printf( "Polar day   south of %7.3f\n", day[0] );
+      if ( day[1] <= 90.0 )
+            printf( "Polar day   north of %7.3f\n", day[1] );
+      return 0;
+}
+
+static int stream_main( int argc, char **argv )
+{
+      int   format = STREAM_CSV;
+      FILE *in = stdin;
+
+      if ( argc > 0 && strcmp( argv[0], "-b" ) == 0 )
+      {
+            format = STREAM_BINARY;
+            argc--, argv++;
+      }
+      if ( argc > 0 && ( in = fopen( argv[0], "rb" ) ) == NULL )
+      {
+            perror( argv[0] );
+            return 1;
+      }
+      return sunriset_stream( in, stdout, format ) < 0;
+}
+
+static int raster_main( int argc, char **argv )
+{
+      double step;
+      int    year, month, day;
+
+      if ( argc < 4 )
+      {
+            fprintf( stderr, "Usage: sunriset raster file yyyy mm dd [step]\n" );
+            return 1;
+      }
+      year  = atoi( argv[1] );
+      month = atoi( argv[2] );
+      day   = atoi( argv[3] );
+      step  = argc > 4 ? atof( argv[4] ) : 0.1;
+      if ( step <= 0.0 || step > 90.0 )
+      {
+            fprintf( stderr, "sunriset raster: bad step %s\n", argv[4] );
+            return 1;
+      }
+      if ( raster_write( argv[0], year, month, day, -35.0/60.0, 1,
+                         -90.0 + step/2, step,
+                         (int) floor( 180.0/step + 0.5 ),
+                         -180.0 + step/2, step,
+                         (int) floor( 360.0/step + 0.5 ),
+                         RASTER_RISE | RASTER_SET | RASTER_DAYLEN ) != 0 )
+      {
+            perror( argv[0] );
+            return 1;
+      }
+      return 0;
+}
+
+/* The C paths compared with Astro::Sunrise by util/check-diff */
+#define DIFF_NPATH  5
+
+static const char *diff_path[DIFF_NPATH] =
+      { "basic", "daylen", "precise", "float", "batch" };
+
+struct diff_record
+{
+      int    year, month, day, upper_limb;
+      double lon, lat, altit;
+};
+
+/* Runs path p over the n records, results in rise, set, rc */
+static void diff_run( int p, long n, const struct diff_record *r,
+                      int *year, int *month, int *day, double *lon,
+                      double *lat, double *altit, int *upper_limb,
+                      double *rise, double *set, int *rc )
+{
+      long i;
+
+      if ( p == 4 )
+      {
+            sunriset_batch_altit( n, year, month, day, lon, lat, altit,
+                                  upper_limb, rise, set, rc );
+            return;
+      }
+      for ( i = 0; i < n; i++ )
+      {
+            switch ( p )
+            {
+            case 0:
+                  rc[i] = __sunriset__( r[i].year, r[i].month, r[i].day,
+                                        r[i].lon, r[i].lat, r[i].altit,
+                                        r[i].upper_limb, &rise[i], &set[i] );
+                  break;
+            case 1:
+                  rise[i] = __daylen__( r[i].year, r[i].month, r[i].day,
+                                        r[i].lon, r[i].lat, r[i].altit,
+                                        r[i].upper_limb );
+                  set[i] = 0.0;
+                  rc[i] = rise[i] <= 0.0 ? -1 : rise[i] >= 24.0 ? +1 : 0;
+                  break;
+            case 2:
+                  rc[i] = __sunriset_precise__( r[i].year, r[i].month,
+                                                r[i].day, r[i].lon, r[i].lat,
+                                                r[i].altit, r[i].upper_limb,
+                                                PRECISE_TOL_PERL, NULL, NULL,
+                                                &rise[i], &set[i] );
+                  break;
+            case 3:
+                  rc[i] = __sunriset_float__( r[i].year, r[i].month,
+                                              r[i].day, r[i].lon, r[i].lat,
+                                              r[i].altit, r[i].upper_limb,
+                                              &rise[i], &set[i] );
+                  break;
+            }
+      }
+}
+
+static int diff_main( int argc, char **argv )
+{
+      FILE   *in = stdin;
+      struct diff_record *r = NULL;
+      long   n = 0, cap = 0, i, reps, k;
+      int    *year, *month, *day, *upper_limb, *rc, p;
+      double *lon, *lat, *altit, *rise, *set;
+      double ns[DIFF_NPATH];
+      clock_t t0, t1;
+      char   line[256];
+
+      if ( argc > 0 && ( in = fopen( argv[0], "r" ) ) == NULL )
+      {
+            perror( argv[0] );
+            return 1;
+      }
+      while ( fgets( line, sizeof line, in ) )
+      {
+            struct diff_record x;
+            if ( line[0] == '#' )
+                  continue;
+            if ( sscanf( line, "%d %d %d %lf %lf %lf %d", &x.year, &x.month,
+                         &x.day, &x.lon, &x.lat, &x.altit,
+                         &x.upper_limb ) != 7 )
+            {
+                  fprintf( stderr, "sunriset diff: bad record %s", line );
+                  return 1;
+            }
+            if ( n == cap )
+            {
+                  cap = cap ? 2 * cap : 1024;
+                  if ( ( r = realloc( r, cap * sizeof *r ) ) == NULL )
+                        break;
+            }
+            r[n++] = x;
+      }
+
+      /* The arrays of sunriset_batch_altit */
+      year  = malloc( n * sizeof *year );
+      month = malloc( n * sizeof *month );
+      day   = malloc( n * sizeof *day );
+      upper_limb = malloc( n * sizeof *upper_limb );
+      lon   = malloc( n * sizeof *lon );
+      lat   = malloc( n * sizeof *lat );
+      altit = malloc( n * sizeof *altit );
+      rise  = malloc( DIFF_NPATH * n * sizeof *rise );
+      set   = malloc( DIFF_NPATH * n * sizeof *set );
+      rc    = malloc( DIFF_NPATH * n * sizeof *rc );
+      if ( n == 0 || !r || !year || !month || !day || !upper_limb || !lon
+           || !lat || !altit || !rise || !set || !rc )
+      {
+            fprintf( stderr, "sunriset diff: no records, or out of memory\n" );
+            return 1;
+      }
+      for ( i = 0; i < n; i++ )
+      {
+            year[i]  = r[i].year;
+            month[i] = r[i].month;
+            day[i]   = r[i].day;
+            lon[i]   = r[i].lon;
+            lat[i]   = r[i].lat;
+            altit[i] = r[i].altit;
+            upper_limb[i] = r[i].upper_limb;
+      }
+
+      /* The results, then the speed of each path, over at least */
+      /* 0.2 second, without the input and output                */
+      for ( p = 0; p < DIFF_NPATH; p++ )
+      {
+            diff_run( p, n, r, year, month, day, lon, lat, altit,
+                      upper_limb, rise + p * n, set + p * n, rc + p * n );
+            reps = 0;
+            t0 = clock();
+            do
+            {
+                  for ( k = 0; k < 4; k++ )
+                        diff_run( p, n, r, year, month, day, lon, lat, altit,
+                                  upper_limb, rise + p * n, set + p * n,
+                                  rc + p * n );
+                  reps += 4;
+                  t1 = clock();
+            } while ( t1 - t0 < CLOCKS_PER_SEC / 5 );
+            ns[p] = 1e9 * ( t1 - t0 ) / CLOCKS_PER_SEC / ( (double) reps * n );
+      }
+
+      /* One line per record: rc rise set of each path */
+      for ( i = 0; i < n; i++ )
+      {
+            for ( p = 0; p < DIFF_NPATH; p++ )
+                  printf( "%s%d %.17g %.17g", p ? " " : "", rc[p * n + i],
+                          rise[p * n + i], set[p * n + i] );
+            printf( "\n" );
+      }
+      printf( "# ns/call" );
+      for ( p = 0; p < DIFF_NPATH; p++ )
+            printf( " %s %.1f", diff_path[p], ns[p] );
+      printf( "\n" );
+
+      free( r ); free( year ); free( month ); free( day ); free( upper_limb );
+      free( lon ); free( lat ); free( altit ); free( rise ); free( set );
+      free( rc );
+      return 0;
+}
+
+/* The counters of the library, at exit */
+static void stats_dump( void )
+{
+      const char *path = getenv( "SUNRISET_STATS" );
+      FILE *out;
+
+      if ( strcmp( path, "-" ) == 0 )
+            sunriset_stats_json( stderr );
+      else if ( ( out = fopen( path, "w" ) ) != NULL )
+      {
+            sunriset_stats_json( out );
+            fclose( out );
+      }
+      else
+            perror( path );
+}
+
+int main( int argc, char **argv )
+{
+      int year,month,day;
+      double lon, lat;
+      double daylen, civlen, nautlen, astrlen;
+      double rise, set, civ_start, civ_end, naut_start, naut_end,
+             astr_start, astr_end;
+      int    rs, civ, naut, astr;
+      char buf[80];
+      static const double altit[4] = { -35.0/60.0, -6.0, -12.0, -18.0 };
+      static const int upper_limb[4] = { 1, 0, 0, 0 };
+      double rises[4], sets[4], lengths[4];
+      int    rcs[4];
+
+      if ( sunriset_stats_enabled() && getenv( "SUNRISET_STATS" ) )
+            atexit( stats_dump );
+
+      if ( argc > 1 && strcmp( argv[1], "almanac" ) == 0 )
+            return almanac_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "stream" ) == 0 )
+            return stream_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "almanac-file" ) == 0 )
+            return almfile_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "timeline" ) == 0 )
+            return timeline_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "lookup" ) == 0 )
+            return lookup_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "crossings" ) == 0 )
+            return crossings_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "polar" ) == 0 )
+            return polar_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "raster" ) == 0 )
+            return raster_main( argc - 2, argv + 2 );
+      if ( argc > 1 && strcmp( argv[1], "diff" ) == 0 )
+            return diff_main( argc - 2, argv + 2 );
+
+      printf( "Longitude (+ is east) and latitude (+ is north) : " );
+      fgets(buf, 80, stdin);
+      sscanf(buf, "%lf %lf", &lon, &lat );
+
+      for(;;)
+      {
+            printf( "Input date ( yyyy mm dd ) (ctrl-C exits): " );
+            fgets(buf, 80, stdin);
+            sscanf(buf, "%d %d %d", &year, &month, &day );
+
+            /* The eight results of the day_length, *_twilight_length, */
+            /* sun_rise_set and *_twilight macros, in one call          */
+            sunriset_altitudes( year, month, day, lon, lat, 4, altit,
+                                upper_limb, rises, sets, rcs, lengths );
+            daylen  = lengths[0];
+            civlen  = lengths[1];
+            nautlen = lengths[2];
+            astrlen = lengths[3];
+
+            printf( "Day length:                 %5.2f hours\n", daylen );
+            printf( "With civil twilight         %5.2f hours\n", civlen );
+            printf( "With nautical twilight      %5.2f hours\n", nautlen );
+            printf( "With astronomical twilight  %5.2f hours\n", astrlen );
+            printf( "Length of twilight: civil   %5.2f hours\n",
+                  (civlen-daylen)/2.0);
+            printf( "                  nautical  %5.2f hours\n",
+                  (nautlen-daylen)/2.0);
+            printf( "              astronomical  %5.2f hours\n",
+                  (astrlen-daylen)/2.0);
+
+            rs   = rcs[0]; rise       = rises[0]; set      = sets[0];
+            civ  = rcs[1]; civ_start  = rises[1]; civ_end  = sets[1];
+            naut = rcs[2]; naut_start = rises[2]; naut_end = sets[2];
+            astr = rcs[3]; astr_start = rises[3]; astr_end = sets[3];
+
+            printf( "Sun at south %5.2fh UT\n", (rise+set)/2.0 );
+
+            switch( rs )
+            {
+                case 0:
+                    printf( "Sun rises %5.2fh UT, sets %5.2fh UT\n",
+                             rise, set );
+                    break;
+                case +1:
+                    printf( "Sun above horizon\n" );
+                    break;
+                case -1:
+                    printf( "Sun below horizon\n" );
+                    break;
+            }
+
+            switch( civ )
+            {
+                case 0:
+                    printf( "Civil twilight starts %5.2fh, "
+                            "ends %5.2fh UT\n", civ_start, civ_end );
+                    break;
+                case +1:
+                    printf( "Never darker than civil twilight\n" );
+                    break;
+                case -1:
+                    printf( "Never as bright as civil twilight\n" );
+                    break;
+            }
+
+            switch( naut )
+            {
+                case 0:
+                    printf( "Nautical twilight starts %5.2fh, "
+                            "ends %5.2fh UT\n", naut_start, naut_end );
+                    break;
+                case +1:
+                    printf( "Never darker than nautical twilight\n" );
+                    break;
+                case -1:
+                    printf( "Never as bright as nautical twilight\n" );
+                    break;
+            }
+
+            switch( astr )
+            {
+                case 0:
+                    printf( "Astronomical twilight starts %5.2fh, "
+                            "ends %5.2fh UT\n", astr_start, astr_end );
+                    break;
+                case +1:
+                    printf( "Never darker than astronomical twilight\n" );
+                    break;
+                case -1:
+                    printf( "Never as bright as astronomical twilight\n" );
+                    break;
+            }
+      return 0;
+      }
+}
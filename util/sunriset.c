@@ -16,16 +16,22 @@ Released to the public domain by Paul Schlyter, December 1992
 
 */
 
+/* The declarations are in sunriset.h.  The sunriset program is in    */
+/* sunriset-main.c.                                                   */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "sunriset.h"
 
-/* A macro to compute the number of days elapsed since 2000 Jan 0.0 */
-/* (which is equal to 1999 Dec 31, 0h UT)                           */
-
-#define days_since_2000_Jan_0(y,m,d) \
-    (367L*(y)-((7*((y)+(((m)+9)/12)))/4)+((275*(m))/9)+(d)-730530L)
 
 /* Some conversion factors between radians and degrees */
 
@@ -48,191 +54,269 @@ Released to the public domain by Paul Schlyter, December 1992
 #define atan2d(y,x) (RADEG*atan2(y,x))
 
 
-/* Following are some macros around the "workhorse" function __daylen__ */
-/* They mainly fill in the desired values for the reference altitude    */
-/* below the horizon, and also selects whether this altitude should     */
-/* refer to the Sun's center or its upper limb.                         */
-
-
-/* This macro computes the length of the day, from sunrise to sunset. */
-/* Sunrise/set is considered to occur when the Sun's upper limb is    */
-/* 35 arc minutes below the horizon (this accounts for the refraction */
-/* of the Earth's atmosphere).                                        */
-#define day_length(year,month,day,lon,lat)  \
-        __daylen__( year, month, day, lon, lat, -35.0/60.0, 1 )
-
-/* This macro computes the length of the day, including civil twilight. */
-/* Civil twilight starts/ends when the Sun's center is 6 degrees below  */
-/* the horizon.                                                         */
-#define day_civil_twilight_length(year,month,day,lon,lat)  \
-        __daylen__( year, month, day, lon, lat, -6.0, 0 )
+/* Instrumentation, see sunriset_stats_get() */
 
-/* This macro computes the length of the day, incl. nautical twilight.  */
-/* Nautical twilight starts/ends when the Sun's center is 12 degrees    */
-/* below the horizon.                                                   */
-#define day_nautical_twilight_length(year,month,day,lon,lat)  \
-        __daylen__( year, month, day, lon, lat, -12.0, 0 )
-
-/* This macro computes the length of the day, incl. astronomical twilight. */
-/* Astronomical twilight starts/ends when the Sun's center is 18 degrees   */
-/* below the horizon.                                                      */
-#define day_astronomical_twilight_length(year,month,day,lon,lat)  \
-        __daylen__( year, month, day, lon, lat, -18.0, 0 )
+#ifndef SUNRISET_STATS
+ #define SUNRISET_STATS  0
+#endif
 
+#define STATS_NORC  2   /* Entry points without a return code */
 
-/* This macro computes times for sunrise/sunset.                      */
-/* Sunrise/set is considered to occur when the Sun's upper limb is    */
-/* 35 arc minutes below the horizon (this accounts for the refraction */
-/* of the Earth's atmosphere).                                        */
-#define sun_rise_set(year,month,day,lon,lat,rise,set)  \
-        __sunriset__( year, month, day, lon, lat, -35.0/60.0, 1, rise, set )
+#if SUNRISET_STATS
 
-/* This macro computes the start and end times of civil twilight.       */
-/* Civil twilight starts/ends when the Sun's center is 6 degrees below  */
-/* the horizon.                                                         */
-#define civil_twilight(year,month,day,lon,lat,start,end)  \
-        __sunriset__( year, month, day, lon, lat, -6.0, 0, start, end )
+#include <time.h>
 
-/* This macro computes the start and end times of nautical twilight.    */
-/* Nautical twilight starts/ends when the Sun's center is 12 degrees    */
-/* below the horizon.                                                   */
-#define nautical_twilight(year,month,day,lon,lat,start,end)  \
-        __sunriset__( year, month, day, lon, lat, -12.0, 0, start, end )
+/* The counters of one thread.  Only the owner thread writes them, with */
+/* relaxed loads and stores (plain increments, no lock prefix), and the */
+/* readers may see them slightly late, never torn.  A buffer is never   */
+/* freed: when its thread exits, the next new thread takes it over, and */
+/* the counts go on accumulating.                                       */
+struct stats_buf
+{
+      struct stats_buf *next;
+      atomic_int  owned;
+      atomic_long calls[STATS_NFUNC];
+      atomic_long rc[STATS_NFUNC][3];
+      atomic_long ns[STATS_NFUNC];
+      atomic_long latency[STATS_NFUNC][STATS_NBUCKETS];
+      atomic_long iter[PRECISE_MAXITER+2];
+};
+
+static _Atomic(struct stats_buf *) stats_head;
+static _Thread_local struct stats_buf *stats_self;
+static pthread_key_t  stats_key;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+
+static void stats_release( void *arg )
+{
+      atomic_store( &( (struct stats_buf *) arg )->owned, 0 );
+}
 
-/* This macro computes the start and end times of astronomical twilight.   */
-/* Astronomical twilight starts/ends when the Sun's center is 18 degrees   */
-/* below the horizon.                                                      */
-#define astronomical_twilight(year,month,day,lon,lat,start,end)  \
-        __sunriset__( year, month, day, lon, lat, -18.0, 0, start, end )
+static void stats_key_init( void )
+{
+      pthread_key_create( &stats_key, stats_release );
+}
 
+/* The buffer of the calling thread: a released one, else a new one */
+/* pushed on the list.  NULL if out of memory: nothing is counted   */
+static struct stats_buf *stats_buf_get( void )
+{
+      struct stats_buf *b;
+      int free_buf;
 
-/* Function prototypes */
+      if ( stats_self )
+            return stats_self;
+      pthread_once( &stats_once, stats_key_init );
+      for ( b = atomic_load( &stats_head ); b; b = b->next )
+      {
+            free_buf = 0;
+            if ( atomic_compare_exchange_strong( &b->owned, &free_buf, 1 ) )
+                  break;
+      }
+      if ( b == NULL )
+      {
+            if ( ( b = calloc( 1, sizeof *b ) ) == NULL )
+                  return NULL;
+            atomic_init( &b->owned, 1 );
+            b->next = atomic_load( &stats_head );
+            while ( !atomic_compare_exchange_weak( &stats_head, &b->next, b ) )
+                  ;
+      }
+      pthread_setspecific( stats_key, b );
+      return stats_self = b;
+}
 
-double __daylen__( int year, int month, int day, double lon, double lat,
-                   double altit, int upper_limb );
+static inline void stats_inc( atomic_long *c, long v )
+{
+      atomic_store_explicit( c, atomic_load_explicit( c, memory_order_relaxed ) + v,
+                             memory_order_relaxed );
+}
 
-int __sunriset__( int year, int month, int day, double lon, double lat,
-                  double altit, int upper_limb, double *rise, double *set );
+static inline long stats_clock( void )
+{
+#if SUNRISET_STATS >= 2
+      struct timespec ts;
+      clock_gettime( CLOCK_MONOTONIC, &ts );
+      return ts.tv_sec * 1000000000L + ts.tv_nsec;
+#else
+      return 0;
+#endif
+}
 
-void sunpos( double d, double *lon, double *r );
+static void stats_end( int fn, int rc, long t0 )
+{
+      struct stats_buf *b = stats_buf_get();
+      if ( b == NULL )
+            return;
+      stats_inc( &b->calls[fn], 1 );
+      if ( rc >= -1 && rc <= 1 )
+            stats_inc( &b->rc[fn][rc+1], 1 );
+#if SUNRISET_STATS >= 2
+      {
+            long ns = stats_clock() - t0;
+            int  k = 0;
+            while ( k < STATS_NBUCKETS - 1 && ns >> ( k + 1 ) )
+                  k++;
+            stats_inc( &b->ns[fn], ns );
+            stats_inc( &b->latency[fn][k], 1 );
+      }
+#endif
+}
 
-void sun_RA_dec( double d, double *RA, double *dec, double *r );
+/* A rise or set of the precise functions settled after iter iterations, */
+/* iter > PRECISE_MAXITER if it did not                                  */
+static void stats_iter( int iter )
+{
+      struct stats_buf *b = stats_buf_get();
+      if ( b != NULL )
+            stats_inc( &b->iter[iter > PRECISE_MAXITER ? PRECISE_MAXITER+1 : iter], 1 );
+}
 
-double revolution( double x );
+#define STATS_BEGIN         long stats_t0 = stats_clock()
+#define STATS_END(fn,rc)    stats_end( fn, rc, stats_t0 )
+#define STATS_ITER(iter)    stats_iter( iter )
 
-double rev180( double x );
+#else
 
-double GMST0( double d );
+#define STATS_BEGIN         ((void) 0)
+#define STATS_END(fn,rc)    ((void) 0)
+#define STATS_ITER(iter)    ((void) 0)
 
+#endif  /* SUNRISET_STATS */
 
+int sunriset_stats_enabled( void )
+/*****************************************************/
+/* The level SUNRISET_STATS compiled in: 0, 1 or 2   */
+/*****************************************************/
+{
+      return SUNRISET_STATS;
+}  /* sunriset_stats_enabled */
 
-/* A small test program */
+void sunriset_stats_get( struct sunriset_stats *st )
+/**********************************************************************/
+/* Stores in st the sum of the counters of all the threads.  May be   */
+/* called while other threads compute: each counter is exact at some  */
+/* instant of the call, not all of them at the same instant.          */
+/**********************************************************************/
+{
+      memset( st, 0, sizeof *st );
+#if SUNRISET_STATS
+      {
+            struct stats_buf *b;
+            int f, k;
+            for ( b = atomic_load( &stats_head ); b; b = b->next )
+            {
+                  st->threads++;
+                  for ( f = 0; f < STATS_NFUNC; f++ )
+                  {
+                        st->calls[f] += atomic_load_explicit( &b->calls[f], memory_order_relaxed );
+                        st->ns[f]    += atomic_load_explicit( &b->ns[f], memory_order_relaxed );
+                        for ( k = 0; k < 3; k++ )
+                              st->rc[f][k] += atomic_load_explicit( &b->rc[f][k], memory_order_relaxed );
+                        for ( k = 0; k < STATS_NBUCKETS; k++ )
+                              st->latency[f][k] += atomic_load_explicit( &b->latency[f][k], memory_order_relaxed );
+                  }
+                  for ( k = 0; k < PRECISE_MAXITER + 2; k++ )
+                        st->iter[k] += atomic_load_explicit( &b->iter[k], memory_order_relaxed );
+            }
+      }
+#endif
+}  /* sunriset_stats_get */
 
-main()
+void sunriset_stats_reset( void )
+/**********************************************************************/
+/* Clears the counters of all the threads.  Counts made by the other  */
+/* threads during the call may be lost: call it between two batches.  */
+/**********************************************************************/
 {
-      int year,month,day;
-      double lon, lat;
-      double daylen, civlen, nautlen, astrlen;
-      double rise, set, civ_start, civ_end, naut_start, naut_end,
-             astr_start, astr_end;
-      int    rs, civ, naut, astr;
-      char buf[80];
+#if SUNRISET_STATS
+      struct stats_buf *b;
+      atomic_long *c;
+      for ( b = atomic_load( &stats_head ); b; b = b->next )
+            for ( c = &b->calls[0]; c < &b->iter[PRECISE_MAXITER+2]; c++ )
+                  atomic_store_explicit( c, 0, memory_order_relaxed );
+#endif
+}  /* sunriset_stats_reset */
 
-      printf( "Longitude (+ is east) and latitude (+ is north) : " );
-      fgets(buf, 80, stdin);
-      sscanf(buf, "%lf %lf", &lon, &lat );
+static const char *stats_names[STATS_NFUNC] =
+{
+      "__sunriset__", "__daylen__", "__sunriset_precise__",
+      "__sunriset_perl__", "sunriset_altitudes", "sunriset_sweep_next",
+      "sunriset_year", "sunriset_batch", "sunriset_almanac",
+      "sunriset_crossings", "__sunriset_float__", "sunriset_batch_altit",
+      "sunriset_raster_tiles"
+};
+
+int sunriset_stats_json( FILE *out )
+/**********************************************************************/
+/* Writes the counters of sunriset_stats_get() to out, as a JSON      */
+/* object.  Entry points never called are left out, and so are the    */
+/* empty latency buckets, written as [ lowest ns, count ] pairs.       */
+/* Returns 0, or -1 on a write error.                                 */
+/**********************************************************************/
+{
+      struct sunriset_stats st;
+      int f, k, first = 1, firstb;
 
-      for(;;)
+      sunriset_stats_get( &st );
+      fprintf( out, "{\n  \"level\": %d,\n  \"threads\": %d,\n  \"functions\": {",
+               SUNRISET_STATS, st.threads );
+      for ( f = 0; f < STATS_NFUNC; f++ )
       {
-            printf( "Input date ( yyyy mm dd ) (ctrl-C exits): " );
-            fgets(buf, 80, stdin);
-            sscanf(buf, "%d %d %d", &year, &month, &day );
-
-            daylen  = day_length(year,month,day,lon,lat);
-            civlen  = day_civil_twilight_length(year,month,day,lon,lat);
-            nautlen = day_nautical_twilight_length(year,month,day,lon,lat);
-            astrlen = day_astronomical_twilight_length(year,month,day,
-                  lon,lat);
-
-            printf( "Day length:                 %5.2f hours\n", daylen );
-            printf( "With civil twilight         %5.2f hours\n", civlen );
-            printf( "With nautical twilight      %5.2f hours\n", nautlen );
-            printf( "With astronomical twilight  %5.2f hours\n", astrlen );
-            printf( "Length of twilight: civil   %5.2f hours\n",
-                  (civlen-daylen)/2.0);
-            printf( "                  nautical  %5.2f hours\n",
-                  (nautlen-daylen)/2.0);
-            printf( "              astronomical  %5.2f hours\n",
-                  (astrlen-daylen)/2.0);
+            if ( st.calls[f] == 0 )
+                  continue;
+            fprintf( out, "%s\n    \"%s\": {\n      \"calls\": %ld",
+                     first ? "" : ",", stats_names[f], st.calls[f] );
+            first = 0;
+            if ( st.rc[f][0] + st.rc[f][1] + st.rc[f][2] > 0 )
+                  fprintf( out, ",\n      \"rc\": { \"-1\": %ld, \"0\": %ld, \"1\": %ld }",
+                           st.rc[f][0], st.rc[f][1], st.rc[f][2] );
+            if ( SUNRISET_STATS >= 2 )
+            {
+                  fprintf( out, ",\n      \"mean_ns\": %.1f,\n      \"latency_ns\": [",
+                           (double) st.ns[f] / st.calls[f] );
+                  for ( k = 0, firstb = 1; k < STATS_NBUCKETS; k++ )
+                        if ( st.latency[f][k] )
+                        {
+                              fprintf( out, "%s [ %ld, %ld ]", firstb ? "" : ",",
+                                       k ? 1L << k : 0L, st.latency[f][k] );
+                              firstb = 0;
+                        }
+                  fprintf( out, " ]" );
+            }
+            fprintf( out, "\n    }" );
+      }
+      fprintf( out, "%s},\n  \"precise_iterations\": [", first ? "" : "\n  " );
+      for ( k = 1; k <= PRECISE_MAXITER; k++ )
+            fprintf( out, "%s %ld", k > 1 ? "," : "", st.iter[k] );
+      fprintf( out, " ],\n  \"precise_unconverged\": %ld\n}\n",
+               st.iter[PRECISE_MAXITER+1] );
+      return ferror( out ) ? -1 : 0;
+}  /* sunriset_stats_json */
 
-            rs   = sun_rise_set         ( year, month, day, lon, lat,
-                                          &rise, &set );
-            civ  = civil_twilight       ( year, month, day, lon, lat,
-                                          &civ_start, &civ_end );
-            naut = nautical_twilight    ( year, month, day, lon, lat,
-                                          &naut_start, &naut_end );
-            astr = astronomical_twilight( year, month, day, lon, lat,
-                                          &astr_start, &astr_end );
 
-            printf( "Sun at south %5.2fh UT\n", (rise+set)/2.0 );
 
-            switch( rs )
-            {
-                case 0:
-                    printf( "Sun rises %5.2fh UT, sets %5.2fh UT\n",
-                             rise, set );
-                    break;
-                case +1:
-                    printf( "Sun above horizon\n" );
-                    break;
-                case -1:
-                    printf( "Sun below horizon\n" );
-                    break;
-            }
+/* The ephemeris backend of the functions with a reader, see EPHEM_DEFAULT */
 
-            switch( civ )
-            {
-                case 0:
-                    printf( "Civil twilight starts %5.2fh, "
-                            "ends %5.2fh UT\n", civ_start, civ_end );
-                    break;
-                case +1:
-                    printf( "Never darker than civil twilight\n" );
-                    break;
-                case -1:
-                    printf( "Never as bright as civil twilight\n" );
-                    break;
-            }
+#ifndef SUNRISET_EPHEM
+ #define SUNRISET_EPHEM  EPHEM_SCHLYTER
+#endif
 
-            switch( naut )
-            {
-                case 0:
-                    printf( "Nautical twilight starts %5.2fh, "
-                            "ends %5.2fh UT\n", naut_start, naut_end );
-                    break;
-                case +1:
-                    printf( "Never darker than nautical twilight\n" );
-                    break;
-                case -1:
-                    printf( "Never as bright as nautical twilight\n" );
-                    break;
-            }
+static int ephem_backend( const struct ephem_reader *er )
+{
+      if ( er != NULL && er->eph != NULL )
+            return EPHEM_SCHLYTER;
+      if ( er != NULL && er->backend != EPHEM_DEFAULT )
+            return er->backend;
+      return SUNRISET_EPHEM;
+}
 
-            switch( astr )
-            {
-                case 0:
-                    printf( "Astronomical twilight starts %5.2fh, "
-                            "ends %5.2fh UT\n", astr_start, astr_end );
-                    break;
-                case +1:
-                    printf( "Never darker than astronomical twilight\n" );
-                    break;
-                case -1:
-                    printf( "Never as bright as astronomical twilight\n" );
-                    break;
-            }
-      return 0;
-      }
+static long ephem_days( const struct ephem_reader *er,
+                        int year, int month, int day )
+{
+      if ( ephem_backend( er ) == EPHEM_MEEUS )
+            return sunriset_days( year, month, day );
+      return days_since_2000_Jan_0(year,month,day);
 }
 
 
@@ -269,6 +353,18 @@ int __sunriset__( int year, int month, int day, double lon, double lat,
 /*                    both set to the time when the sun is at south.  */
 /*                                                                    */
 /**********************************************************************/
+{
+      return __sunriset_ephem__( NULL, year, month, day, lon, lat,
+                                 altit, upper_limb, trise, tset );
+}  /* __sunriset__ */
+
+int __sunriset_ephem__( struct ephem_reader *er, int year, int month,
+                        int day, double lon, double lat, double altit,
+                        int upper_limb, double *trise, double *tset )
+/**********************************************************/
+/* Same as __sunriset__, reading the Sun's position from  */
+/* the precomputed ephemeris of er, unless er is NULL     */
+/**********************************************************/
 {
       double  d,  /* Days since 2000 Jan 0.0 (negative before) */
       sr,         /* Solar distance, astronomical units */
@@ -281,14 +377,16 @@ int __sunriset__( int year, int month, int day, double lon, double lat,
 
       int rc = 0; /* Return cde from function - usually 0 */
 
+      STATS_BEGIN;
+
       /* Compute d of 12h local mean solar time */
-      d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+      d = ephem_days( er, year, month, day ) + 0.5 - lon/360.0;
 
       /* Compute the local sidereal time of this moment */
       sidtime = revolution( GMST0(d) + 180.0 + lon );
 
       /* Compute Sun's RA, Decl and distance at this moment */
-      sun_RA_dec( d, &sRA, &sdec, &sr );
+      sun_RA_dec_ephem( er, d, &sRA, &sdec, &sr );
 
       /* Compute time when Sun is at south - in hours UT */
       tsouth = 12.0 - rev180(sidtime - sRA)/15.0;
@@ -318,8 +416,333 @@ int __sunriset__( int year, int month, int day, double lon, double lat,
       *trise = tsouth - t;
       *tset  = tsouth + t;
 
+      STATS_END( STATS_SUNRISET, rc );
       return rc;
-}  /* __sunriset__ */
+}  /* __sunriset_ephem__ */
+
+
+
+/* The single precision "workhorse" function */
+
+#define sindf(x)     sinf((x)*(float)DEGRAD)
+#define cosdf(x)     cosf((x)*(float)DEGRAD)
+#define acosdf(x)    ((float)RADEG*acosf(x))
+#define atan2df(y,x) ((float)RADEG*atan2f(y,x))
+
+int __sunriset_float__( int year, int month, int day, double lon,
+                        double lat, double altit, int upper_limb,
+                        double *trise, double *tset )
+/**********************************************************************/
+/* Note: same parameters and return value as __sunriset__.            */
+/*       d, the sidereal time and the mean elements, which grow with  */
+/*       d, are computed in double and reduced to 0..360 degrees; the */
+/*       rest, in float.  Over every day of 1801-2099, the times      */
+/*       differ from those of __sunriset__ by less than 2 seconds     */
+/*       where cost is 1e-2 or more from +-1, and by less than 8      */
+/*       seconds on every whole degree of latitude, where the return  */
+/*       code differs 5 times in 78 million.  Within 1e-3 degree of   */
+/*       latitude of the edge of the polar day or night: up to 1      */
+/*       minute at 1e-4 degree, and closer, the return code itself    */
+/*       often differs (see "sunriset-bench float").                 */
+/**********************************************************************/
+{
+      double  d,  /* Days since 2000 Jan 0.0 (negative before) */
+      sidtime,    /* Local sidereal time */
+      tsouth;     /* Time when Sun is at south */
+      float   M, w, e, E, x, y, r, lon_s, obl_ecl, z, sRA, sdec, a, cost, t;
+      int rc = 0;
+
+      STATS_BEGIN;
+
+      /* Compute d of 12h local mean solar time, and the local sidereal */
+      /* time of this moment, as __sunriset__                           */
+      d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+      sidtime = revolution( GMST0(d) + 180.0 + lon );
+
+      /* Mean elements, as sunpos(), reduced before the conversion */
+      M = (float) revolution( 356.0470 + 0.9856002585 * d );
+      w = (float) revolution( 282.9404 + 4.70935E-5 * d );
+      e = (float) ( 0.016709 - 1.151E-9 * d );
+      obl_ecl = (float) ( 23.4393 - 3.563E-7 * d );
+
+      /* Sun's ecliptic longitude and distance, then RA and Decl, as */
+      /* sunpos() and sun_RA_dec()                                    */
+      E = M + e * (float)RADEG * sindf(M) * ( 1.0f + e * cosdf(M) );
+      x = cosdf(E) - e;
+      y = sqrtf( 1.0f - e*e ) * sindf(E);
+      r = sqrtf( x*x + y*y );
+      lon_s = atan2df( y, x ) + w;
+      x = r * cosdf(lon_s);
+      y = r * sindf(lon_s);
+      z = y * sindf(obl_ecl);
+      y = y * cosdf(obl_ecl);
+      sRA  = atan2df( y, x );
+      sdec = atan2df( z, sqrtf(x*x + y*y) );
+
+      /* Compute time when Sun is at south - in hours UT */
+      tsouth = 12.0 - rev180(sidtime - sRA)/15.0;
+
+      /* Do correction to upper limb, if necessary */
+      a = (float) altit;
+      if ( upper_limb )
+            a -= 0.2666f / r;
+
+      /* Compute the diurnal arc */
+      cost = ( sindf(a) - sindf((float) lat) * sindf(sdec) ) /
+             ( cosdf((float) lat) * cosdf(sdec) );
+      if ( cost >= 1.0f )
+            rc = -1, t = 0.0f;          /* Sun always below altit */
+      else if ( cost <= -1.0f )
+            rc = +1, t = 12.0f;         /* Sun always above altit */
+      else
+            t = acosdf(cost)/15.0f;     /* The diurnal arc, hours */
+
+      /* Store rise and set times - in hours UT */
+      *trise = tsouth - t;
+      *tset  = tsouth + t;
+
+      STATS_END( STATS_FLOAT, rc );
+      return rc;
+}  /* __sunriset_float__ */
+
+
+
+/* The precise "workhorse" function */
+
+/* Equality of two times rounded to 5 significant digits, as the */
+/* equal() function of Astro::Sunrise                            */
+static int equal5( double a, double b )
+{
+      char abuf[32], bbuf[32];
+      snprintf( abuf, sizeof abuf, "%.5g", a );
+      snprintf( bbuf, sizeof bbuf, "%.5g", b );
+      return strcmp( abuf, bbuf ) == 0;
+}
+
+int __sunriset_precise__( int year, int month, int day, double lon,
+                          double lat, double altit, int upper_limb,
+                          double tol, struct ephem_reader *er,
+                          struct precise_stats *stats,
+                          double *trise, double *tset )
+/**********************************************************************/
+/* Note: same parameters and return value as __sunriset__, plus:     */
+/*       tol   = convergence tolerance in hours, e.g. PRECISE_TOL,    */
+/*               or PRECISE_TOL_PERL                                  */
+/*       er    = precomputed ephemeris, or NULL                       */
+/*       stats = where to cumulate the convergence telemetry, or NULL */
+/*       Rise and set are iterated together: the first iteration,     */
+/*       at local noon, computes the Sun's position once for both,    */
+/*       and a position is never computed twice for the same instant. */
+/*       An iteration which finds the Sun always above or below altit */
+/*       stops the iteration for this event and gives the return code */
+/*       (rise first, then set).                                      */
+/**********************************************************************/
+{
+      double  d0,              /* Days since 2000 Jan 0.0, 0h LMT */
+      d,                       /* Instant of the current iteration */
+      cached_d = 0.0,          /* Instant of the last computed position */
+      sr = 0.0,                /* Solar distance, astronomical units */
+      sRA = 0.0,               /* Sun's Right Ascension */
+      sdec = 0.0,              /* Sun's declination */
+      sidtime,                 /* Sidereal time at Greenwich meridian */
+      tsouth,                  /* Time when Sun is at south, hours UT */
+      t,                       /* Diurnal arc */
+      h_lmt[2] = { 12.0, 12.0 },  /* Rise, set times, LMT */
+      h[2],                    /* Rise, set times, UT */
+      h_new;                   /* Rise or set time of this iteration */
+      int     done[2] = { 0, 0 },
+      rc[2] = { 0, 0 },
+      cached = 0,
+      iter, k;
+
+      STATS_BEGIN;
+
+      d0 = ephem_days( er, year, month, day ) - lon/360.0;
+      h[0] = h[1] = 12.0 - lon/15.0;
+
+      for ( iter = 1; iter <= PRECISE_MAXITER; iter++ )
+      {
+            if ( done[0] && done[1] )
+                  break;
+            for ( k = 0; k < 2; k++ )
+            {
+                  if ( done[k] )
+                        continue;
+
+                  /* Sun's position at the last computed time */
+                  d = d0 + h_lmt[k]/24.0;
+                  if ( !cached || d != cached_d )
+                  {
+                        sun_RA_dec_ephem( er, d, &sRA, &sdec, &sr );
+                        cached_d = d;
+                        cached = 1;
+                        if ( stats )
+                              stats->evals++;
+                  }
+
+                  /* Time when Sun is at south, the LMT being reduced */
+                  /* around the local longitude                       */
+                  sidtime = revolution( GMST0(d) + 180.0 );
+                  tsouth  = 12.0 - ( lon + rev180(sidtime - sRA - lon) )/15.0
+                            - lon/15.0;
+
+                  /* Compute the diurnal arc, as in __sunriset__ */
+                  {
+                        double a = altit, cost;
+                        if ( upper_limb )
+                              a -= 0.2666 / sr;
+                        cost = ( sind(a) - sind(lat) * sind(sdec) ) /
+                              ( cosd(lat) * cosd(sdec) );
+                        if ( cost >= 1.0 )
+                              rc[k] = -1, t = 0.0;
+                        else if ( cost <= -1.0 )
+                              rc[k] = +1, t = 12.0;
+                        else
+                              t = acosd(cost)/15.0;
+                  }
+                  h_new = k == 0 ? tsouth - t : tsouth + t;
+
+                  if ( rc[k] != 0 ||
+                       ( tol > 0.0 ? fabs( h_new - h[k] ) < tol
+                                   : equal5( h[k], h_new ) ) )
+                  {
+                        done[k] = 1;
+                        if ( stats )
+                              stats->iter[iter]++;
+                        STATS_ITER( iter );
+                  }
+                  h[k]     = h_new;
+                  h_lmt[k] = h_new + lon/15.0;
+            }
+      }
+
+      if ( stats )
+      {
+            stats->calls++;
+            stats->unconverged += !done[0] + !done[1];
+      }
+      for ( k = 0; k < 2; k++ )
+            if ( !done[k] )
+                  STATS_ITER( PRECISE_MAXITER + 1 );
+      *trise = h[0];
+      *tset  = h[1];
+      STATS_END( STATS_PRECISE, rc[0] ? rc[0] : rc[1] );
+      return rc[0] ? rc[0] : rc[1];
+}  /* __sunriset_precise__ */
+
+
+
+/* The functions of Astro::Sunrise, for its XS backend */
+
+/* sun_rise_set() of Astro::Sunrise: rise and set times, hours UT, of */
+/* the day d (days since 2000 Jan 0.0), the time when the Sun is at   */
+/* south being reduced around 0 (around_lon = 0, basic algorithm) or  */
+/* around the local longitude (precise algorithm).  The order of the  */
+/* operations is the one of the Perl code, for identical results.     */
+static int perl_rise_set( double d, double lon, double lat, double altit,
+                          int upper_limb, int around_lon,
+                          double *trise, double *tset )
+{
+      double  sidtime, sRA, sdec, sr, x, tsouth, cost, t;
+      int     rc = 0;
+
+      sidtime = revolution( GMST0(d) + 180.0 );
+      sun_RA_dec( d, &sRA, &sdec, &sr );
+      x = sidtime - sRA;
+      tsouth = 12.0 - ( around_lon ? lon + rev180( x - lon ) : rev180( x ) )/15
+               - lon/15;
+
+      if ( upper_limb )
+            altit -= 0.2666 / sr;
+      cost = ( sind(altit) - sind(lat) * sind(sdec) ) /
+             ( cosd(lat) * cosd(sdec) );
+      if ( cost >= 1.0 )
+            rc = -1, t = 0.0;       /* Sun always below altit */
+      else if ( cost <= -1.0 )
+            rc = +1, t = 12.0;      /* Sun always above altit */
+      else    /* The diurnal arc, hours, with acos() as in Math::Trig */
+            t = RADEG * atan2( sqrt( 1 - cost*cost ), cost ) / 15.0;
+
+      *trise = tsouth - t;
+      *tset  = tsouth + t;
+      return rc;
+}
+
+/* Appends the warning of rc to res, if any */
+static void perl_warn( struct perl_sunrise *res, int rc )
+{
+      if ( rc != 0 && res->nwarn < PERL_MAXWARN )
+            res->warning[res->nwarn++] = rc;
+}
+
+int __sunriset_perl__( int year, int month, int day, double lon,
+                       double lat, double altit, int upper_limb,
+                       int precise, int retval, struct perl_sunrise *res )
+/**********************************************************************/
+/* Note: same parameters as __sunriset__, plus:                       */
+/*       precise = the precise option of sunrise()                    */
+/*       retval  = 1 for polar => 'retval', 0 for polar => 'warn'     */
+/*       res     = times, return codes and warnings, see sunriset.h   */
+/*       Unlike __sunriset_precise__, rise and set are iterated one   */
+/*       after the other, and with polar => 'warn' a Sun always above */
+/*       or below altit does not stop the iteration, as in the Perl   */
+/*       code.                                                        */
+/*       Return value: res->rc_rise if nonzero, else res->rc_set      */
+/**********************************************************************/
+{
+      double  d, h_lmt, h_utc, h_new, other;
+      int     k, iter, rc;
+
+      STATS_BEGIN;
+
+      memset( res, 0, sizeof *res );
+
+      if ( !precise )
+      {
+            d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+            rc = perl_rise_set( d, lon, lat, altit, upper_limb, 0,
+                                &res->rise, &res->set );
+            if ( retval )
+                  res->rc_rise = res->rc_set = rc;
+            else
+                  perl_warn( res, rc );
+            STATS_END( STATS_PERL, rc );
+            return rc;
+      }
+
+      d = days_since_2000_Jan_0(year,month,day) - lon/360.0;
+      for ( k = 0; k < 2; k++ )
+      {
+            h_lmt = 12.0;
+            h_utc = 0.0;
+            for ( iter = 1; iter <= PRECISE_MAXITER; iter++ )
+            {
+                  rc = k == 0
+                     ? perl_rise_set( d + h_lmt/24, lon, lat, altit,
+                                      upper_limb, 1, &h_new, &other )
+                     : perl_rise_set( d + h_lmt/24, lon, lat, altit,
+                                      upper_limb, 1, &other, &h_new );
+                  if ( rc != 0 && retval )
+                  {
+                        *( k == 0 ? &res->rc_rise : &res->rc_set ) = rc;
+                        break;
+                  }
+                  perl_warn( res, rc );
+                  h_utc = h_lmt - lon/15;
+                  if ( equal5( h_utc, h_new ) )
+                  {
+                        h_utc = h_new;
+                        break;
+                  }
+                  h_utc = h_new;
+                  h_lmt = h_utc + lon/15;
+            }
+            STATS_ITER( iter );
+            *( k == 0 ? &res->rise : &res->set ) = h_utc;
+      }
+      STATS_END( STATS_PERL, res->rc_rise ? res->rc_rise : res->rc_set );
+      return res->rc_rise ? res->rc_rise : res->rc_set;
+}  /* __sunriset_perl__ */
 
 
 
@@ -343,28 +766,54 @@ double __daylen__( int year, int month, int day, double lon, double lat,
 /*               Set to non-zero (e.g. 1) when computing day length   */
 /*               and to zero when computing day+twilight length.      */
 /**********************************************************************/
+{
+      return __daylen_ephem__( NULL, year, month, day, lon, lat,
+                               altit, upper_limb );
+}  /* __daylen__ */
+
+double __daylen_ephem__( struct ephem_reader *er, int year, int month,
+                         int day, double lon, double lat, double altit,
+                         int upper_limb )
+/**********************************************************/
+/* Same as __daylen__, reading the Sun's position from    */
+/* the precomputed ephemeris of er, unless er is NULL     */
+/**********************************************************/
 {
       double  d,  /* Days since 2000 Jan 0.0 (negative before) */
       obl_ecl,    /* Obliquity (inclination) of Earth's axis */
       sr,         /* Solar distance, astronomical units */
       slon,       /* True solar longitude */
+      sRA,        /* Sun's Right Ascension */
+      sdec,       /* Sun's declination */
       sin_sdecl,  /* Sine of Sun's declination */
       cos_sdecl,  /* Cosine of Sun's declination */
       sradius,    /* Sun's apparent radius */
       t;          /* Diurnal arc */
 
+      STATS_BEGIN;
+
       /* Compute d of 12h local mean solar time */
-      d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+      d = ephem_days( er, year, month, day ) + 0.5 - lon/360.0;
 
-      /* Compute obliquity of ecliptic (inclination of Earth's axis) */
-      obl_ecl = 23.4393 - 3.563E-7 * d;
+      if ( er == NULL && SUNRISET_EPHEM == EPHEM_SCHLYTER )
+      {
+            /* Compute obliquity of ecliptic (inclination of Earth's axis) */
+            obl_ecl = 23.4393 - 3.563E-7 * d;
 
-      /* Compute Sun's ecliptic longitude and distance */
-      sunpos( d, &slon, &sr );
+            /* Compute Sun's ecliptic longitude and distance */
+            sunpos( d, &slon, &sr );
 
-      /* Compute sine and cosine of Sun's declination */
-      sin_sdecl = sind(obl_ecl) * sind(slon);
-      cos_sdecl = sqrt( 1.0 - sin_sdecl * sin_sdecl );
+            /* Compute sine and cosine of Sun's declination */
+            sin_sdecl = sind(obl_ecl) * sind(slon);
+            cos_sdecl = sqrt( 1.0 - sin_sdecl * sin_sdecl );
+      }
+      else
+      {
+            /* Same thing, from the precomputed declination */
+            sun_RA_dec_ephem( er, d, &sRA, &sdec, &sr );
+            sin_sdecl = sind(sdec);
+            cos_sdecl = cosd(sdec);
+      }
 
       /* Compute the Sun's apparent radius, degrees */
       sradius = 0.2666 / sr;
@@ -385,102 +834,1886 @@ double __daylen__( int year, int month, int day, double lon, double lat,
                   t = 24.0;                     /* Sun always above altit */
             else  t = (2.0/15.0) * acosd(cost); /* The diurnal arc, hours */
       }
+      STATS_END( STATS_DAYLEN, t == 0.0 ? -1 : t == 24.0 ? +1 : 0 );
       return t;
-}  /* __daylen__ */
-
-
-/* This function computes the Sun's position at any instant */
+}  /* __daylen_ephem__ */
 
-void sunpos( double d, double *lon, double *r )
-/******************************************************/
-/* Computes the Sun's ecliptic longitude and distance */
-/* at an instant given in d, number of days since     */
-/* 2000 Jan 0.0.  The Sun's ecliptic latitude is not  */
-/* computed, since it's always very near 0.           */
-/******************************************************/
-{
-      double M,         /* Mean anomaly of the Sun */
-             w,         /* Mean longitude of perihelion */
-                        /* Note: Sun's mean longitude = M + w */
-             e,         /* Eccentricity of Earth's orbit */
-             E,         /* Eccentric anomaly */
-             x, y,      /* x, y coordinates in orbit */
-             v;         /* True anomaly */
 
-      /* Compute mean elements */
-      M = revolution( 356.0470 + 0.9856002585 * d );
-      w = 282.9404 + 4.70935E-5 * d;
-      e = 0.016709 - 1.151E-9 * d;
 
-      /* Compute true longitude and radius vector */
-      E = M + e * RADEG * sind(M) * ( 1.0 + e * cosd(M) );
-            x = cosd(E) - e;
-      y = sqrt( 1.0 - e*e ) * sind(E);
-      *r = sqrt( x*x + y*y );              /* Solar distance */
-      v = atan2d( y, x );                  /* True anomaly */
-      *lon = v + w;                        /* True solar longitude */
-      if ( *lon >= 360.0 )
-            *lon -= 360.0;                   /* Make it 0..360 degrees */
-}
+/* Several altitudes at once */
 
-void sun_RA_dec( double d, double *RA, double *dec, double *r )
-/******************************************************/
-/* Computes the Sun's equatorial coordinates RA, Decl */
-/* and also its distance, at an instant given in d,   */
-/* the number of days since 2000 Jan 0.0.             */
-/******************************************************/
+void sunriset_altitudes( int year, int month, int day, double lon,
+                         double lat, int n, const double *altit,
+                         const int *upper_limb, double *trise, double *tset,
+                         int *rc, double *daylen )
+/**********************************************************************/
+/* For each of the n altitudes altit[k], with its upper_limb[k],      */
+/* computes what __sunriset__ stores in trise[k] and tset[k] and      */
+/* returns in rc[k], and what __daylen__ returns in daylen[k], with   */
+/* the same results bit for bit.  The Sun's position, the time when   */
+/* the Sun is at south and the terms of the latitude are computed     */
+/* once for all the altitudes.  daylen may be NULL.                   */
+/**********************************************************************/
 {
-      double lon, obl_ecl, x, y, z;
+      double  d, sidtime, slon, sr, obl_ecl, x, y, z, sRA, sdec, tsouth;
+      double  sin_lat, cos_lat, sin_dec, cos_dec, sin_sdecl, cos_sdecl;
+      double  a, sin_alt, cost, t;
+      int     k;
 
-      /* Compute Sun's ecliptical coordinates */
-      sunpos( d, &lon, r );
+      STATS_BEGIN;
 
-      /* Compute ecliptic rectangular coordinates (z=0) */
-      x = *r * cosd(lon);
-      y = *r * sind(lon);
+      /* Compute d of 12h local mean solar time */
+      d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
 
-      /* Compute obliquity of ecliptic (inclination of Earth's axis) */
-      obl_ecl = 23.4393 - 3.563E-7 * d;
+      /* Compute the local sidereal time of this moment */
+      sidtime = revolution( GMST0(d) + 180.0 + lon );
 
-      /* Convert to equatorial rectangular coordinates - x is unchanged */
+      /* Compute Sun's RA, Decl and distance, as sun_RA_dec does */
+      sunpos( d, &slon, &sr );
+      x = sr * cosd(slon);
+      y = sr * sind(slon);
+      obl_ecl = 23.4393 - 3.563E-7 * d;
       z = y * sind(obl_ecl);
       y = y * cosd(obl_ecl);
+      sRA  = atan2d( y, x );
+      sdec = atan2d( z, sqrt(x*x + y*y) );
 
-      /* Convert to spherical coordinates */
-      *RA = atan2d( y, x );
-      *dec = atan2d( z, sqrt(x*x + y*y) );
+      /* Compute time when Sun is at south - in hours UT */
+      tsouth = 12.0 - rev180(sidtime - sRA)/15.0;
 
-}  /* sun_RA_dec */
+      /* The declination terms of __sunriset__, and of __daylen__ */
+      sin_dec   = sind(sdec);
+      cos_dec   = cosd(sdec);
+      sin_sdecl = sind(obl_ecl) * sind(slon);
+      cos_sdecl = sqrt( 1.0 - sin_sdecl * sin_sdecl );
+      sin_lat   = sind(lat);
+      cos_lat   = cosd(lat);
 
+      for ( k = 0; k < n; k++ )
+      {
+            /* Do correction to upper limb, if necessary */
+            a = altit[k];
+            if ( upper_limb[k] )
+                  a -= 0.2666 / sr;
+            sin_alt = sind(a);
 
-/******************************************************************/
-/* This function reduces any angle to within the first revolution */
-/* by subtracting or adding even multiples of 360.0 until the     */
-/* result is >= 0.0 and < 360.0                                   */
-/******************************************************************/
+            cost = ( sin_alt - sin_lat * sin_dec ) / ( cos_lat * cos_dec );
+            if ( cost >= 1.0 )
+                  rc[k] = -1, t = 0.0;          /* Sun always below altit */
+            else if ( cost <= -1.0 )
+                  rc[k] = +1, t = 12.0;         /* Sun always above altit */
+            else
+                  rc[k] = 0, t = acosd(cost)/15.0;
+            trise[k] = tsouth - t;
+            tset[k]  = tsouth + t;
 
-#define INV360    ( 1.0 / 360.0 )
+            if ( daylen == NULL )
+                  continue;
+            cost = ( sin_alt - sin_lat * sin_sdecl ) / ( cos_lat * cos_sdecl );
+            if ( cost >= 1.0 )
+                  daylen[k] = 0.0;
+            else if ( cost <= -1.0 )
+                  daylen[k] = 24.0;
+            else
+                  daylen[k] = (2.0/15.0) * acosd(cost);
+      }
+      STATS_END( STATS_ALTITUDES, STATS_NORC );
+}  /* sunriset_altitudes */
 
-double revolution( double x )
-/*****************************************/
-/* Reduce angle to within 0..360 degrees */
-/*****************************************/
-{
-      return( x - 360.0 * floor( x * INV360 ) );
-}  /* revolution */
 
-double rev180( double x )
-/*********************************************/
-/* Reduce angle to within +180..+180 degrees */
-/*********************************************/
-{
-      return( x - 360.0 * floor( x * INV360 + 0.5 ) );
-}  /* revolution */
 
+/* The day-to-day sweep */
 
-/*******************************************************************/
-/* This function computes GMST0, the Greenwich Mean Sidereal Time  */
-/* at 0h UT (i.e. the sidereal time at the Greenwhich meridian at  */
+/* Daily motions of the angles of sunpos() and sun_RA_dec(), degrees */
+#define SWEEP_DM        0.9856002585
+#define SWEEP_DW        4.70935E-5
+#define SWEEP_DOBL      (-3.563E-7)
+
+/* Rotates the angle of sine s and cosine c by the angle of sine ds */
+/* and cosine dc                                                    */
+#define SWEEP_ROTATE(s,c,ds,dc)  \
+      { double s_ = (s) * (dc) + (c) * (ds); \
+        (c) = (c) * (dc) - (s) * (ds); (s) = s_; }
+
+/* Sine and cosine of a small angle x, radians, |x| < 0.02: Taylor    */
+/* series to x^5 and x^6, errors below 2e-16 and 1e-19                */
+#define SWEEP_SMALL(x,s,c)  \
+      { double x2_ = (x) * (x); \
+        (s) = (x) * ( 1.0 - x2_/6.0 * ( 1.0 - x2_/20.0 ) ); \
+        (c) = 1.0 - x2_/2.0 * ( 1.0 - x2_/12.0 * ( 1.0 - x2_/30.0 ) ); }
+
+/* Computes the angles of the day sw->d from scratch */
+static void sweep_sync( struct sunriset_sweep *sw )
+{
+      double M = revolution( 356.0470 + SWEEP_DM * sw->d ),
+             w = 282.9404 + SWEEP_DW * sw->d,
+             obl_ecl = 23.4393 + SWEEP_DOBL * sw->d;
+
+      sw->sin_M   = sind(M);
+      sw->cos_M   = cosd(M);
+      sw->sin_w   = sind(w);
+      sw->cos_w   = cosd(w);
+      sw->sin_obl = sind(obl_ecl);
+      sw->cos_obl = cosd(obl_ecl);
+      sw->age = 0;
+}
+
+void sunriset_sweep_init( struct sunriset_sweep *sw, int year, int month,
+                          int day, double lon, double lat, double altit,
+                          int upper_limb )
+/**********************************************************************/
+/* Starts a sweep of the site (lon, lat) from the date year-month-day */
+/* on, same parameters as __sunriset__.  Each sunriset_sweep_next()   */
+/* call gives the results of one day, then goes to the next day.      */
+/**********************************************************************/
+{
+      sw->d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+      sw->lon = lon;
+      sw->sin_alt = sind(altit);
+      sw->cos_alt = cosd(altit);
+      sw->upper_limb = upper_limb;
+      sw->sin_lat = sind(lat);
+      sw->cos_lat = cosd(lat);
+      sw->resync = SWEEP_RESYNC;
+      sw->sin_dM   = sind(SWEEP_DM);
+      sw->cos_dM   = cosd(SWEEP_DM);
+      sw->sin_dw   = sind(SWEEP_DW);
+      sw->cos_dw   = cosd(SWEEP_DW);
+      sw->sin_dobl = sind(SWEEP_DOBL);
+      sw->cos_dobl = cosd(SWEEP_DOBL);
+      sweep_sync( sw );
+}  /* sunriset_sweep_init */
+
+int sunriset_sweep_next( struct sunriset_sweep *sw, double *trise,
+                         double *tset )
+/**********************************************************************/
+/* Stores the rise and set times of the current day of the sweep and  */
+/* returns the return code, as __sunriset__, then advances one day    */
+/**********************************************************************/
+{
+      double  e, delta, sin_delta, cos_delta, sin_E, cos_E, x, y, r,
+              ex, ey, z, sRA, sin_dec, cos_dec, sidtime, tsouth,
+              sin_alt, cost, t;
+      int     rc = 0;
+
+      STATS_BEGIN;
+
+      /* The eccentric anomaly E = M + delta, delta below 1 degree */
+      e = 0.016709 - 1.151E-9 * sw->d;
+      delta = e * sw->sin_M * ( 1.0 + e * sw->cos_M );
+      SWEEP_SMALL( delta, sin_delta, cos_delta );
+      sin_E = sw->sin_M * cos_delta + sw->cos_M * sin_delta;
+      cos_E = sw->cos_M * cos_delta - sw->sin_M * sin_delta;
+
+      /* Position in the orbit, then ecliptic rectangular coordinates: */
+      /* the true anomaly v is not needed, as r cos(v) = x and         */
+      /* r sin(v) = y                                                  */
+      x = cos_E - e;
+      y = sqrt( 1.0 - e*e ) * sin_E;
+      r = sqrt( x*x + y*y );
+      ex = x * sw->cos_w - y * sw->sin_w;
+      ey = x * sw->sin_w + y * sw->cos_w;
+
+      /* Equatorial coordinates */
+      z  = ey * sw->sin_obl;
+      ey = ey * sw->cos_obl;
+      sRA = atan2d( ey, ex );
+      sin_dec = z / r;
+      cos_dec = sqrt( ex*ex + ey*ey ) / r;
+
+      /* Time when Sun is at south - in hours UT */
+      sidtime = revolution( GMST0(sw->d) + 180.0 + sw->lon );
+      tsouth = 12.0 - rev180(sidtime - sRA)/15.0;
+
+      /* The diurnal arc, with the upper limb correction as a small angle */
+      if ( sw->upper_limb )
+      {
+            double sr, cr;
+            SWEEP_SMALL( 0.2666 / r * DEGRAD, sr, cr );
+            sin_alt = sw->sin_alt * cr - sw->cos_alt * sr;
+      }
+      else
+            sin_alt = sw->sin_alt;
+      cost = ( sin_alt - sw->sin_lat * sin_dec ) / ( sw->cos_lat * cos_dec );
+      if ( cost >= 1.0 )
+            rc = -1, t = 0.0;       /* Sun always below altit */
+      else if ( cost <= -1.0 )
+            rc = +1, t = 12.0;      /* Sun always above altit */
+      else
+            t = acosd(cost)/15.0;   /* The diurnal arc, hours */
+      *trise = tsouth - t;
+      *tset  = tsouth + t;
+
+      /* Next day */
+      sw->d += 1.0;
+      if ( ++sw->age >= sw->resync )
+            sweep_sync( sw );
+      else
+      {
+            SWEEP_ROTATE( sw->sin_M,   sw->cos_M,   sw->sin_dM,   sw->cos_dM );
+            SWEEP_ROTATE( sw->sin_w,   sw->cos_w,   sw->sin_dw,   sw->cos_dw );
+            SWEEP_ROTATE( sw->sin_obl, sw->cos_obl, sw->sin_dobl, sw->cos_dobl );
+      }
+      STATS_END( STATS_SWEEP, rc );
+      return rc;
+}  /* sunriset_sweep_next */
+
+int sunriset_year( int year, double lon, double lat, double altit,
+                   int upper_limb, double *trise, double *tset, int *rc )
+/**********************************************************************/
+/* Rise and set times and return codes of every day of the year, as   */
+/* __sunriset__, with a sweep: trise, tset and rc hold almanac_days(  */
+/* year) entries.  Return value: the number of days                   */
+/**********************************************************************/
+{
+      struct sunriset_sweep sw;
+      int    n = almanac_days( year ), k;
+
+      STATS_BEGIN;
+
+      sunriset_sweep_init( &sw, year, 1, 1, lon, lat, altit, upper_limb );
+      for ( k = 0; k < n; k++ )
+            rc[k] = sunriset_sweep_next( &sw, &trise[k], &tset[k] );
+      STATS_END( STATS_YEAR, STATS_NORC );
+      return n;
+}  /* sunriset_year */
+
+
+
+/* The batch "workhorse" function */
+
+/* Reference altitudes and limb flags of the SUNRISET_KINDS results, */
+/* same values as in the sun_rise_set ... astronomical_twilight      */
+/* macros.                                                           */
+static const double batch_altit[SUNRISET_KINDS] =
+      { -35.0/60.0, -6.0, -12.0, -18.0 };
+static const int    batch_upper_limb[SUNRISET_KINDS] = { 1, 0, 0, 0 };
+
+/* Number of pairs whose ephemeris is kept at the same time */
+#define BATCH_CHUNK  256
+
+long sunriset_batch( long n, const int *year, const int *month,
+                     const int *day, const double *lon, const double *lat,
+                     double *rise, double *set, int *rc, int isa,
+                     struct ephem_reader *er )
+/**********************************************************************/
+/* Note: the n (site, date) pairs are given as structure-of-arrays:   */
+/*       year[i], month[i], day[i], lon[i], lat[i], with the same     */
+/*       conventions as __sunriset__.  1801-2099 only.                */
+/*       The results are stored as SUNRISET_KINDS consecutive blocks  */
+/*       of n values, one block per kind (KIND_RISE_SET, KIND_CIVIL,  */
+/*       KIND_NAUTICAL, KIND_ASTRONOMICAL):                           */
+/*        rise[k*n+i], set[k*n+i] = rise/start and set/end times, in  */
+/*                hours UT, as stored by __sunriset__                 */
+/*        rc[k*n+i] = return code of __sunriset__: 0, +1 or -1        */
+/*       The day length is set[k*n+i] - rise[k*n+i].                  */
+/*       The Sun's position depends only on the instant d, computed   */
+/*       from the date and the longitude. It is computed once for     */
+/*       consecutive pairs sharing the same instant, so sort the      */
+/*       pairs by date, then by longitude, to get the full benefit.   */
+/*       isa = ISA_SCALAR gives exactly the results of __sunriset__,  */
+/*             other values select the vectorized diurnal arc, see    */
+/*             sunriset_arcs().                                       */
+/*       er  = precomputed ephemeris, or NULL                         */
+/* Return value: the number of times the Sun's position was computed  */
+/**********************************************************************/
+{
+      double  d,               /* Days since 2000 Jan 0.0 */
+      prev_d = 0.0,            /* Instant of the last computed position */
+      sr = 0.0,                /* Solar distance, astronomical units */
+      sRA = 0.0,               /* Sun's Right Ascension */
+      sdec = 0.0,              /* Sun's declination */
+      sidtime,                 /* Local sidereal time */
+      sin_lat[BATCH_CHUNK],    /* sind(lat) */
+      cos_lat[BATCH_CHUNK],    /* cosd(lat) */
+      sin_sdec[BATCH_CHUNK],   /* sind(sdec) */
+      cos_sdec[BATCH_CHUNK],   /* cosd(sdec) */
+      sdecs[BATCH_CHUNK],      /* Sun's declination, per pair */
+      sradius[BATCH_CHUNK],    /* Sun's apparent radius */
+      tsouth[BATCH_CHUNK],     /* Time when Sun is at south */
+      altits[BATCH_CHUNK];     /* altit, corrected for the upper limb */
+      long i0, i, m,
+      nephem = 0;              /* Number of computed positions */
+      int k;
+
+      STATS_BEGIN;
+
+      for ( i0 = 0; i0 < n; i0 += BATCH_CHUNK )
+      {
+            m = n - i0 < BATCH_CHUNK ? n - i0 : BATCH_CHUNK;
+
+            /* First pass: the terms which do not depend on altit */
+            for ( i = 0; i < m; i++ )
+            {
+                  d = ephem_days( er, year[i0+i], month[i0+i], day[i0+i] )
+                      + 0.5 - lon[i0+i]/360.0;
+                  if ( nephem == 0 || d != prev_d )
+                  {
+                        sun_RA_dec_ephem( er, d, &sRA, &sdec, &sr );
+                        prev_d = d;
+                        nephem++;
+                  }
+                  sidtime     = revolution( GMST0(d) + 180.0 + lon[i0+i] );
+                  tsouth[i]   = 12.0 - rev180(sidtime - sRA)/15.0;
+                  sradius[i]  = 0.2666 / sr;
+                  sdecs[i]    = sdec;
+                  if ( isa != ISA_SCALAR )
+                        continue;
+                  sin_lat[i]  = sind(lat[i0+i]);
+                  cos_lat[i]  = cosd(lat[i0+i]);
+                  sin_sdec[i] = sind(sdec);
+                  cos_sdec[i] = cosd(sdec);
+            }
+
+            /* Second pass: the diurnal arc for each altitude */
+            for ( k = 0; k < SUNRISET_KINDS; k++ )
+            {
+                  double *krise = rise + k*n + i0;
+                  double *kset  = set  + k*n + i0;
+                  int    *krc   = rc   + k*n + i0;
+
+                  if ( isa != ISA_SCALAR )
+                  {
+                        for ( i = 0; i < m; i++ )
+                              altits[i] = batch_altit[k] -
+                                    ( batch_upper_limb[k] ? sradius[i] : 0.0 );
+                        sunriset_arcs( isa, m, lat + i0, sdecs, altits, tsouth,
+                                       krise, kset, krc );
+                        continue;
+                  }
+                  for ( i = 0; i < m; i++ )
+                  {
+                        double altit = batch_altit[k], cost, t;
+
+                        if ( batch_upper_limb[k] )
+                              altit -= sradius[i];
+                        cost = ( sind(altit) - sin_lat[i] * sin_sdec[i] ) /
+                              ( cos_lat[i] * cos_sdec[i] );
+                        if ( cost >= 1.0 )
+                              krc[i] = -1, t = 0.0;
+                        else if ( cost <= -1.0 )
+                              krc[i] = +1, t = 12.0;
+                        else
+                              krc[i] = 0, t = acosd(cost)/15.0;
+                        krise[i] = tsouth[i] - t;
+                        kset[i]  = tsouth[i] + t;
+                  }
+            }
+      }
+      STATS_END( STATS_BATCH, STATS_NORC );
+      return nephem;
+}  /* sunriset_batch */
+
+long sunriset_batch_altit( long n, const int *year, const int *month,
+                           const int *day, const double *lon,
+                           const double *lat, const double *altit,
+                           const int *upper_limb, double *rise,
+                           double *set, int *rc )
+/**********************************************************************/
+/* Note: n calls to __sunriset__, with the parameters of call i in    */
+/*       year[i] ... upper_limb[i] and its results in rise[i],        */
+/*       set[i] and rc[i], which are exactly those of __sunriset__.   */
+/*       As in sunriset_batch, the Sun's position is computed once    */
+/*       for consecutive pairs sharing the same instant: sort them by */
+/*       date, then by longitude.                                     */
+/* Return value: the number of times the Sun's position was computed  */
+/**********************************************************************/
+{
+      double  d, prev_d = 0.0, sr = 0.0, sRA = 0.0, sdec = 0.0,
+              sin_sdec = 0.0, cos_sdec = 1.0, sidtime, tsouth, a, cost, t;
+      long    i, nephem = 0;
+
+      STATS_BEGIN;
+
+      for ( i = 0; i < n; i++ )
+      {
+            d = days_since_2000_Jan_0( year[i], month[i], day[i] )
+                + 0.5 - lon[i]/360.0;
+            if ( nephem == 0 || d != prev_d )
+            {
+                  sun_RA_dec( d, &sRA, &sdec, &sr );
+                  sin_sdec = sind(sdec);
+                  cos_sdec = cosd(sdec);
+                  prev_d = d;
+                  nephem++;
+            }
+            sidtime = revolution( GMST0(d) + 180.0 + lon[i] );
+            tsouth  = 12.0 - rev180(sidtime - sRA)/15.0;
+            a = altit[i];
+            if ( upper_limb[i] )
+                  a -= 0.2666 / sr;
+            cost = ( sind(a) - sind(lat[i]) * sin_sdec ) /
+                  ( cosd(lat[i]) * cos_sdec );
+            if ( cost >= 1.0 )
+                  rc[i] = -1, t = 0.0;
+            else if ( cost <= -1.0 )
+                  rc[i] = +1, t = 12.0;
+            else
+                  rc[i] = 0, t = acosd(cost)/15.0;
+            rise[i] = tsouth - t;
+            set[i]  = tsouth + t;
+      }
+      STATS_END( STATS_BATCH_ALTIT, STATS_NORC );
+      return nephem;
+}  /* sunriset_batch_altit */
+
+
+
+/* The vectorized diurnal arc */
+
+static void arcs_scalar( long n, const double *lat, const double *sdec,
+                         const double *altit, const double *tsouth,
+                         double *trise, double *tset, int *rc )
+{
+      long i;
+
+      for ( i = 0; i < n; i++ )
+      {
+            double cost, t;
+
+            cost = ( sind(altit[i]) - sind(lat[i]) * sind(sdec[i]) ) /
+                  ( cosd(lat[i]) * cosd(sdec[i]) );
+            if ( cost >= 1.0 )
+                  rc[i] = -1, t = 0.0;
+            else if ( cost <= -1.0 )
+                  rc[i] = +1, t = 12.0;
+            else
+                  rc[i] = 0, t = acosd(cost)/15.0;
+            trise[i] = tsouth[i] - t;
+            tset[i]  = tsouth[i] + t;
+      }
+}  /* arcs_scalar */
+
+static void arcs_scalar_float( long n, const float *lat, const float *sdec,
+                               const float *altit, const float *tsouth,
+                               float *trise, float *tset, int *rc )
+{
+      const float degrad = (float) DEGRAD;
+      long i;
+
+      for ( i = 0; i < n; i++ )
+      {
+            float cost, t, cos_lat;
+
+            /* cosf of 90 degrees in float is below 0: clamped as the */
+            /* cosine of the vector kernels                           */
+            cos_lat = fmaxf( cosf( lat[i] * degrad ), (float) 6.123233995736766e-17 );
+            cost = ( sinf( altit[i] * degrad ) - sinf( lat[i] * degrad )
+                     * sinf( sdec[i] * degrad ) ) /
+                   ( cos_lat * cosf( sdec[i] * degrad ) );
+            if ( cost >= 1.0f )
+                  rc[i] = -1, t = 0.0f;
+            else if ( cost <= -1.0f )
+                  rc[i] = +1, t = 12.0f;
+            else
+                  rc[i] = 0, t = acosf( cost ) * (float) RADEG / 15.0f;
+            trise[i] = tsouth[i] - t;
+            tset[i]  = tsouth[i] + t;
+      }
+}  /* arcs_scalar_float */
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+
+#include <immintrin.h>
+
+#define ARCS_NAME    arcs_sse2
+#define ARCS_TARGET  "sse2"
+#define ARCS_WIDTH   2
+#define ARCS_SQRT    _mm_sqrt_pd
+#define ARCS_SQRTF   _mm_sqrt_ps
+#include "sunriset-arcs.h"
+
+#define ARCS_NAME    arcs_avx2
+#define ARCS_TARGET  "avx2,fma"
+#define ARCS_WIDTH   4
+#define ARCS_SQRT    _mm256_sqrt_pd
+#define ARCS_SQRTF   _mm256_sqrt_ps
+#include "sunriset-arcs.h"
+
+#define ARCS_NAME    arcs_avx512
+#define ARCS_TARGET  "avx512f"
+#define ARCS_WIDTH   8
+#define ARCS_SQRT    _mm512_sqrt_pd
+#define ARCS_SQRTF   _mm512_sqrt_ps
+#include "sunriset-arcs.h"
+
+int sunriset_isa( void )
+/*************************************************/
+/* The widest instruction set usable on this CPU */
+/*************************************************/
+{
+      __builtin_cpu_init();
+      if ( __builtin_cpu_supports( "avx512f" ) )
+            return ISA_AVX512;
+      if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+            return ISA_AVX2;
+      if ( __builtin_cpu_supports( "sse2" ) )
+            return ISA_SSE2;
+      return ISA_SCALAR;
+}  /* sunriset_isa */
+
+#else
+
+int sunriset_isa( void )
+{
+      return ISA_SCALAR;
+}  /* sunriset_isa */
+
+#endif
+
+void sunriset_arcs( int isa, long n, const double *lat, const double *sdec,
+                    const double *altit, const double *tsouth,
+                    double *trise, double *tset, int *rc )
+/**********************************************************************/
+/* Computes the second half of __sunriset__ for n sites:              */
+/*       lat[i]    = latitude, -90..+90 degrees                       */
+/*       sdec[i]   = Sun's declination, from sun_RA_dec               */
+/*       altit[i]  = altitude to cross, already corrected for the     */
+/*                   upper limb if needed                             */
+/*       tsouth[i] = time when Sun is at south, hours UT              */
+/*       trise[i], tset[i], rc[i] = as in __sunriset__                */
+/* isa = ISA_SCALAR uses the libm functions and gives the results of  */
+/*       __sunriset__ exactly.  ISA_SSE2, ISA_AVX2 and ISA_AVX512     */
+/*       process 2, 4 or 8 sites at a time with polynomial sin, cos   */
+/*       and acos (see sunriset-arcs.h for their error bounds).       */
+/*       Use sunriset_isa() to get the widest one for this CPU.       */
+/**********************************************************************/
+{
+      switch ( isa )
+      {
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+            case ISA_AVX512:
+                  arcs_avx512( n, lat, sdec, altit, tsouth, trise, tset, rc );
+                  return;
+            case ISA_AVX2:
+                  arcs_avx2( n, lat, sdec, altit, tsouth, trise, tset, rc );
+                  return;
+            case ISA_SSE2:
+                  arcs_sse2( n, lat, sdec, altit, tsouth, trise, tset, rc );
+                  return;
+#endif
+            default:
+                  arcs_scalar( n, lat, sdec, altit, tsouth, trise, tset, rc );
+      }
+}  /* sunriset_arcs */
+
+void sunriset_arcs_float( int isa, long n, const float *lat,
+                          const float *sdec, const float *altit,
+                          const float *tsouth, float *trise, float *tset,
+                          int *rc )
+/**********************************************************************/
+/* Same as sunriset_arcs, in single precision: ISA_SCALAR uses the    */
+/* float functions of the libm, ISA_SSE2, ISA_AVX2 and ISA_AVX512     */
+/* process 4, 8 or 16 sites at a time.  Near cost = +-1, the times    */
+/* are as far from those of sunriset_arcs as in __sunriset_float__    */
+/* ("sunriset-bench float").                                          */
+/**********************************************************************/
+{
+      switch ( isa )
+      {
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+            case ISA_AVX512:
+                  arcs_avx512_float( n, lat, sdec, altit, tsouth, trise, tset, rc );
+                  return;
+            case ISA_AVX2:
+                  arcs_avx2_float( n, lat, sdec, altit, tsouth, trise, tset, rc );
+                  return;
+            case ISA_SSE2:
+                  arcs_sse2_float( n, lat, sdec, altit, tsouth, trise, tset, rc );
+                  return;
+#endif
+            default:
+                  arcs_scalar_float( n, lat, sdec, altit, tsouth, trise, tset, rc );
+      }
+}  /* sunriset_arcs_float */
+
+
+
+/* The multi-threaded almanac generator */
+
+/* Number of sites computed together by one worker */
+#define ALMANAC_CHUNK  1024
+
+/* Each worker owns a range of chunks, packed in one atomic word as  */
+/* (first << 32) | end.  The owner takes chunks from the front; an   */
+/* idle worker steals the back half of another worker's range.       */
+struct almanac_range
+{
+      _Atomic unsigned long long lohi;
+      char pad[64 - sizeof(unsigned long long)];    /* One per cache line */
+};
+
+struct almanac_job
+{
+      int    year, ndays, isa, nthreads;
+      int    month[366], day[366];
+      long   nsites, chunks_per_day;
+      const double *lon, *lat;
+      const struct sun_ephem *eph;
+      double *rise, *set;
+      int    *rc;
+      struct almanac_range *range;
+};
+
+struct almanac_worker
+{
+      struct almanac_job *job;
+      struct almanac_pool *pool;
+      int    id;
+};
+
+/* Worker threads kept from one almanac to the next: almanac_write  */
+/* computes one almanac per band of sites.  Worker 0 is the calling */
+/* thread; a run bumps generation, and waits until busy is 0.       */
+struct almanac_pool
+{
+      int    nthreads, started, busy, quit;
+      long   generation;
+      pthread_t *tid;
+      struct almanac_worker *wk;
+      struct almanac_range *range;
+      pthread_mutex_t lock;
+      pthread_cond_t  go, done;
+};
+
+int almanac_days( int year )
+/*********************************************/
+/* Number of days in year (1801-2099 only)   */
+/*********************************************/
+{
+      return days_since_2000_Jan_0(year+1,1,1) - days_since_2000_Jan_0(year,1,1);
+}  /* almanac_days */
+
+#define RANGE_LO(v)     ( (long) ( (v) >> 32 ) )
+#define RANGE_HI(v)     ( (long) ( (v) & 0xFFFFFFFFULL ) )
+#define RANGE(lo,hi)    ( ( (unsigned long long) (lo) << 32 ) | (unsigned long long) (hi) )
+
+/* Takes the next chunk of worker w's own range, or returns -1 */
+static long almanac_take( struct almanac_range *r )
+{
+      unsigned long long v = atomic_load( &r->lohi );
+
+      while ( RANGE_LO(v) < RANGE_HI(v) )
+            if ( atomic_compare_exchange_weak( &r->lohi, &v,
+                                     RANGE( RANGE_LO(v) + 1, RANGE_HI(v) ) ) )
+                  return RANGE_LO(v);
+      return -1;
+}
+
+/* Moves the back half of another worker's range to worker w's range */
+static int almanac_steal( struct almanac_job *job, int w )
+{
+      unsigned long long v;
+      long lo, hi, mid;
+      int  i, victim;
+
+      for ( i = 1; i < job->nthreads; i++ )
+      {
+            victim = ( w + i ) % job->nthreads;
+            v = atomic_load( &job->range[victim].lohi );
+            while ( ( lo = RANGE_LO(v) ) < ( hi = RANGE_HI(v) ) )
+            {
+                  mid = lo + ( hi - lo ) / 2;
+                  if ( atomic_compare_exchange_weak( &job->range[victim].lohi,
+                                                     &v, RANGE( lo, mid ) ) )
+                  {
+                        atomic_store( &job->range[w].lohi, RANGE( mid, hi ) );
+                        return 1;
+                  }
+            }
+      }
+      return 0;
+}
+
+static void *almanac_work( void *arg )
+{
+      struct almanac_worker *wk = arg;
+      struct almanac_job    *job = wk->job;
+      struct ephem_reader   er = { NULL, 0, 0, EPHEM_DEFAULT };
+      int    year[ALMANAC_CHUNK], month[ALMANAC_CHUNK], day[ALMANAC_CHUNK];
+      double rise[SUNRISET_KINDS*ALMANAC_CHUNK], set[SUNRISET_KINDS*ALMANAC_CHUNK];
+      int    rc[SUNRISET_KINDS*ALMANAC_CHUNK];
+      long   c, s0, m, i, k, idx;
+      int    dayno;
+
+      er.eph = job->eph;
+      for ( ;; )
+      {
+            c = almanac_take( &job->range[wk->id] );
+            if ( c < 0 )
+            {
+                  if ( almanac_steal( job, wk->id ) )
+                        continue;
+                  break;
+            }
+
+            /* Chunk c: one day, ALMANAC_CHUNK sites */
+            dayno = c / job->chunks_per_day;
+            s0    = ( c % job->chunks_per_day ) * ALMANAC_CHUNK;
+            m     = job->nsites - s0 < ALMANAC_CHUNK ? job->nsites - s0
+                                                     : ALMANAC_CHUNK;
+            for ( i = 0; i < m; i++ )
+            {
+                  year[i]  = job->year;
+                  month[i] = job->month[dayno];
+                  day[i]   = job->day[dayno];
+            }
+            sunriset_batch( m, year, month, day, job->lon + s0, job->lat + s0,
+                            rise, set, rc, job->isa,
+                            job->eph ? &er : NULL );
+
+            /* Each chunk owns its slots of the output: no lock needed */
+            for ( k = 0; k < SUNRISET_KINDS; k++ )
+            {
+                  idx = ( k * job->ndays + dayno ) * job->nsites + s0;
+                  memcpy( job->rise + idx, rise + k*m, m * sizeof(double) );
+                  memcpy( job->set  + idx, set  + k*m, m * sizeof(double) );
+                  memcpy( job->rc   + idx, rc   + k*m, m * sizeof(int) );
+            }
+      }
+      return NULL;
+}
+
+static void *almanac_pool_main( void *arg )
+{
+      struct almanac_worker *wk = arg;
+      struct almanac_pool   *pool = wk->pool;
+      long   seen = 0;
+
+      for ( ;; )
+      {
+            pthread_mutex_lock( &pool->lock );
+            while ( pool->generation == seen && !pool->quit )
+                  pthread_cond_wait( &pool->go, &pool->lock );
+            if ( pool->quit )
+            {
+                  pthread_mutex_unlock( &pool->lock );
+                  return NULL;
+            }
+            seen = pool->generation;
+            pthread_mutex_unlock( &pool->lock );
+
+            almanac_work( wk );
+
+            pthread_mutex_lock( &pool->lock );
+            if ( --pool->busy == 0 )
+                  pthread_cond_signal( &pool->done );
+            pthread_mutex_unlock( &pool->lock );
+      }
+}
+
+/* Starts nthreads-1 threads; those which cannot start leave their */
+/* work to be stolen.  Return value: 0, or -1 if out of memory      */
+static int almanac_pool_init( struct almanac_pool *pool, int nthreads )
+{
+      int w;
+
+      if ( nthreads < 1 )
+            nthreads = 1;
+      pool->nthreads   = nthreads;
+      pool->started    = 0;
+      pool->busy       = 0;
+      pool->quit       = 0;
+      pool->generation = 0;
+      pool->range = aligned_alloc( 64, nthreads * sizeof *pool->range );
+      pool->wk    = malloc( nthreads * sizeof *pool->wk );
+      pool->tid   = malloc( nthreads * sizeof *pool->tid );
+      if ( pool->range == NULL || pool->wk == NULL || pool->tid == NULL )
+      {
+            free( pool->range ); free( pool->wk ); free( pool->tid );
+            return -1;
+      }
+      pthread_mutex_init( &pool->lock, NULL );
+      pthread_cond_init( &pool->go, NULL );
+      pthread_cond_init( &pool->done, NULL );
+      for ( w = 0; w < nthreads; w++ )
+      {
+            pool->wk[w].job  = NULL;
+            pool->wk[w].pool = pool;
+            pool->wk[w].id   = w;
+      }
+      for ( w = 1; w < nthreads; w++, pool->started++ )
+            if ( pthread_create( &pool->tid[w], NULL, almanac_pool_main,
+                                 &pool->wk[w] ) != 0 )
+                  break;
+      return 0;
+}
+
+static void almanac_pool_free( struct almanac_pool *pool )
+{
+      int w;
+
+      pthread_mutex_lock( &pool->lock );
+      pool->quit = 1;
+      pthread_cond_broadcast( &pool->go );
+      pthread_mutex_unlock( &pool->lock );
+      for ( w = 1; w <= pool->started; w++ )
+            pthread_join( pool->tid[w], NULL );
+      pthread_mutex_destroy( &pool->lock );
+      pthread_cond_destroy( &pool->go );
+      pthread_cond_destroy( &pool->done );
+      free( pool->range ); free( pool->wk ); free( pool->tid );
+}
+
+/* One almanac, see sunriset_almanac, by the threads of pool */
+static void almanac_pool_run( struct almanac_pool *pool, int year,
+                              long nsites, const double *lon,
+                              const double *lat, int isa,
+                              const struct sun_ephem *eph,
+                              double *rise, double *set, int *rc )
+{
+      struct almanac_job job;
+      long   nchunks, i;
+      int    w, m;
+
+      STATS_BEGIN;
+
+      job.year   = year;
+      job.ndays  = almanac_days( year );
+      job.isa    = isa;
+      job.nsites = nsites;
+      job.lon    = lon;
+      job.lat    = lat;
+      job.eph    = eph;
+      job.rise   = rise;
+      job.set    = set;
+      job.rc     = rc;
+      job.range  = pool->range;
+      job.nthreads = pool->nthreads;
+      job.chunks_per_day = ( nsites + ALMANAC_CHUNK - 1 ) / ALMANAC_CHUNK;
+      for ( m = 1, i = 0; i < job.ndays; i++ )
+      {
+            long dd = days_since_2000_Jan_0(year,1,1) + i;
+            while ( m < 12 && days_since_2000_Jan_0(year,m+1,1) <= dd )
+                  m++;
+            job.month[i] = m;
+            job.day[i]   = dd - days_since_2000_Jan_0(year,m,1) + 1;
+      }
+      nchunks = job.ndays * job.chunks_per_day;
+
+      /* Equal initial shares; stealing evens out the rest */
+      for ( w = 0; w < pool->nthreads; w++ )
+      {
+            atomic_init( &job.range[w].lohi,
+                         RANGE( nchunks * w / pool->nthreads,
+                                nchunks * ( w + 1 ) / pool->nthreads ) );
+            pool->wk[w].job = &job;
+      }
+      pthread_mutex_lock( &pool->lock );
+      pool->busy = pool->started;
+      pool->generation++;
+      pthread_cond_broadcast( &pool->go );
+      pthread_mutex_unlock( &pool->lock );
+
+      /* The calling thread is worker 0; it also steals the work of */
+      /* the threads which could not start                          */
+      almanac_work( &pool->wk[0] );
+      pthread_mutex_lock( &pool->lock );
+      while ( pool->busy > 0 )
+            pthread_cond_wait( &pool->done, &pool->lock );
+      pthread_mutex_unlock( &pool->lock );
+      STATS_END( STATS_ALMANAC, STATS_NORC );
+}
+
+int sunriset_almanac( int year, long nsites, const double *lon,
+                      const double *lat, int nthreads, int isa,
+                      const struct sun_ephem *eph,
+                      double *rise, double *set, int *rc )
+/**********************************************************************/
+/* Computes the results of sunriset_batch for every day of the year   */
+/* and every site (lon[i], lat[i]), 0 <= i < nsites, with nthreads    */
+/* threads.  isa and eph (which may be NULL) are passed to            */
+/* sunriset_batch.  The results are stored, for day j (0 = Jan 1st)   */
+/* and kind k (KIND_RISE_SET ... KIND_ASTRONOMICAL), at               */
+/*       rise[(k*ndays+j)*nsites+i], set[...], rc[...]                */
+/* with ndays = almanac_days(year); the caller allocates them.        */
+/* The results do not depend on nthreads.                             */
+/* Return value: 0, or -1 if out of memory                            */
+/**********************************************************************/
+{
+      struct almanac_pool pool;
+
+      if ( almanac_pool_init( &pool, nthreads ) != 0 )
+            return -1;
+      almanac_pool_run( &pool, year, nsites, lon, lat, isa, eph, rise, set, rc );
+      almanac_pool_free( &pool );
+      return 0;
+}  /* sunriset_almanac */
+
+
+
+/* Almanac files, see ALMFILE_HEADER */
+
+/* Number of sites computed together by almanac_write */
+#define ALMFILE_BAND    1024
+
+static void put_le( unsigned char *q, unsigned long long v, int nbytes )
+{
+      int i;
+      for ( i = 0; i < nbytes; i++, v >>= 8 )
+            q[i] = v & 0xFF;
+}
+
+static unsigned long long get_le( const unsigned char *q, int nbytes )
+{
+      unsigned long long v = 0;
+      while ( nbytes-- > 0 )
+            v = ( v << 8 ) | q[nbytes];
+      return v;
+}
+
+static void put_double( unsigned char *q, double x )
+{
+      unsigned long long v;
+      memcpy( &v, &x, 8 );
+      put_le( q, v, 8 );
+}
+
+static double get_double( const unsigned char *q )
+{
+      unsigned long long v = get_le( q, 8 );
+      double x;
+      memcpy( &x, &v, 8 );
+      return x;
+}
+
+/* Offset of the first record of year y, site 0, day 0 */
+static size_t almfile_year_offset( int year0, int y, long ncells )
+{
+      return ALMFILE_HEADER + (size_t) ( days_since_2000_Jan_0(y,1,1)
+                                         - days_since_2000_Jan_0(year0,1,1) )
+                              * ncells * ALMFILE_RECORD;
+}
+
+/* Time t (hours UT) in quanta from the local mean noon, saturated.  */
+/* __sunriset__ keeps the local noon within 0..24h UT, so noon is the  */
+/* local mean noon plus or minus 24 hours near the date line.          */
+static int almfile_quantize( double t, double noon, int quantum )
+{
+      double q = floor( ( t - noon ) * 3600.0 / quantum + 0.5 );
+      return q > 32767.0 ? 32767 : q < -32768.0 ? -32768 : (int) q;
+}
+
+int almanac_write( const char *path, int year0, int year1,
+                   double lat0, double dlat, int nlat,
+                   double lon0, double dlon, int nlon, int nthreads )
+/**********************************************************************/
+/* Builds the almanac file path for the years year0 to year1 and the  */
+/* grid of nlat x nlon sites starting at (lat0, lon0), computed with  */
+/* nthreads threads by sunriset_almanac (without ephemeris table, so  */
+/* the file holds the __sunriset__ results, quantized).               */
+/* Return value: 0, or -1 with errno set                              */
+/**********************************************************************/
+{
+      FILE   *fp;
+      unsigned char hdr[ALMFILE_HEADER], *rec = NULL;
+      double *lon = NULL, *lat = NULL, *rise = NULL, *set = NULL;
+      int    *rc = NULL;
+      long   ncells = (long) nlat * nlon, c0, m, i, j, k, idx;
+      size_t year_base;
+      int    y, ndays, rv = -1, pooled = 0;
+      struct almanac_pool pool;
+
+      if ( ( fp = fopen( path, "wb" ) ) == NULL )
+            return -1;
+      memset( hdr, 0, sizeof hdr );
+      memcpy( hdr, "SUNALM1", 8 );
+      put_le( hdr + 8,  year0, 4 );
+      put_le( hdr + 12, year1, 4 );
+      put_le( hdr + 16, nlat, 4 );
+      put_le( hdr + 20, nlon, 4 );
+      put_le( hdr + 24, SUNRISET_KINDS, 4 );
+      put_le( hdr + 28, ALMFILE_QUANTUM, 4 );
+      put_double( hdr + 32, lat0 );
+      put_double( hdr + 40, dlat );
+      put_double( hdr + 48, lon0 );
+      put_double( hdr + 56, dlon );
+      if ( fwrite( hdr, 1, sizeof hdr, fp ) != sizeof hdr )
+            goto done;
+
+      lon  = malloc( ALMFILE_BAND * sizeof(double) );
+      lat  = malloc( ALMFILE_BAND * sizeof(double) );
+      rise = malloc( SUNRISET_KINDS * 366 * ALMFILE_BAND * sizeof(double) );
+      set  = malloc( SUNRISET_KINDS * 366 * ALMFILE_BAND * sizeof(double) );
+      rc   = malloc( SUNRISET_KINDS * 366 * ALMFILE_BAND * sizeof(int) );
+      rec  = malloc( 366 * ALMFILE_BAND * ALMFILE_RECORD );
+      if ( !lon || !lat || !rise || !set || !rc || !rec )
+            goto done;
+      /* The same threads for all the bands */
+      if ( almanac_pool_init( &pool, nthreads ) != 0 )
+            goto done;
+      pooled = 1;
+
+      /* Year by year, band by band of sites, then one slice of the */
+      /* band per day of the year                                   */
+      for ( y = year0; y <= year1; y++ )
+      {
+            ndays = almanac_days( y );
+            year_base = almfile_year_offset( year0, y, ncells );
+            for ( c0 = 0; c0 < ncells; c0 += ALMFILE_BAND )
+            {
+                  m = ncells - c0 < ALMFILE_BAND ? ncells - c0 : ALMFILE_BAND;
+                  for ( i = 0; i < m; i++ )
+                  {
+                        lat[i] = lat0 + ( ( c0 + i ) / nlon ) * dlat;
+                        lon[i] = lon0 + ( ( c0 + i ) % nlon ) * dlon;
+                  }
+                  almanac_pool_run( &pool, y, m, lon, lat, ISA_SCALAR,
+                                    NULL, rise, set, rc );
+                  for ( i = 0; i < m; i++ )
+                        for ( j = 0; j < ndays; j++ )
+                        {
+                              unsigned char *q = rec + ( j * m + i ) * ALMFILE_RECORD;
+                              double noon = 12.0 - lon[i]/15.0;
+                              q[0] = 0;
+                              /* The noon of this day, from the first kind */
+                              idx  = j * m + i;
+                              noon += 24.0 * floor( ( ( rise[idx] + set[idx] ) / 2.0
+                                                      - noon ) / 24.0 + 0.5 );
+                              for ( k = 0; k < SUNRISET_KINDS; k++ )
+                              {
+                                    idx = ( k * ndays + j ) * m + i;
+                                    q[0] |= ( rc[idx] > 0 ? 1 : rc[idx] < 0 ? 2 : 0 ) << 2*k;
+                                    put_le( q + 1 + 4*k, (unsigned short)
+                                            almfile_quantize( rise[idx], noon,
+                                                              ALMFILE_QUANTUM ), 2 );
+                                    put_le( q + 3 + 4*k, (unsigned short)
+                                            almfile_quantize( set[idx], noon,
+                                                              ALMFILE_QUANTUM ), 2 );
+                              }
+                        }
+                  for ( j = 0; j < ndays; j++ )
+                        if ( fseeko( fp, year_base + ( j * ncells + c0 ) * ALMFILE_RECORD,
+                                     SEEK_SET ) != 0
+                             || fwrite( rec + j * m * ALMFILE_RECORD, ALMFILE_RECORD,
+                                        m, fp ) != (size_t) m )
+                              goto done;
+            }
+      }
+      rv = 0;
+
+done:
+      if ( pooled )
+            almanac_pool_free( &pool );
+      free( lon ); free( lat ); free( rise ); free( set ); free( rc ); free( rec );
+      if ( fclose( fp ) != 0 )
+            rv = -1;
+      return rv;
+}  /* almanac_write */
+
+int almanac_open( struct almanac_file *af, const char *path )
+/**********************************************************************/
+/* Maps the almanac file path in memory                               */
+/* Return value: 0, or -1 if it cannot be read or is not an almanac   */
+/*               file for this build (SUNRISET_KINDS)                 */
+/**********************************************************************/
+{
+      struct stat sb;
+      void  *base;
+      int    fd;
+      long   ncells;
+
+      if ( ( fd = open( path, O_RDONLY ) ) < 0 )
+            return -1;
+      if ( fstat( fd, &sb ) != 0 || sb.st_size < ALMFILE_HEADER )
+      {
+            close( fd );
+            return -1;
+      }
+      base = mmap( NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+      close( fd );
+      if ( base == MAP_FAILED )
+            return -1;
+
+      af->base    = base;
+      af->size    = sb.st_size;
+      af->year0   = (int) get_le( af->base + 8, 4 );
+      af->year1   = (int) get_le( af->base + 12, 4 );
+      af->nlat    = (int) get_le( af->base + 16, 4 );
+      af->nlon    = (int) get_le( af->base + 20, 4 );
+      af->quantum = (int) get_le( af->base + 28, 4 );
+      af->lat0    = get_double( af->base + 32 );
+      af->dlat    = get_double( af->base + 40 );
+      af->lon0    = get_double( af->base + 48 );
+      af->dlon    = get_double( af->base + 56 );
+      af->wrap    = af->nlon * af->dlon >= 360.0 - 1e-9;
+      ncells      = (long) af->nlat * af->nlon;
+      if ( memcmp( af->base, "SUNALM1", 8 ) != 0
+           || get_le( af->base + 24, 4 ) != SUNRISET_KINDS
+           || af->year0 < 1801 || af->year1 > 2099 || af->year1 < af->year0
+           || af->nlat < 1 || af->nlon < 1 || af->quantum <= 0
+           || !isfinite( af->lat0 ) || !isfinite( af->lon0 )
+           || !( isfinite( af->dlat ) && af->dlat > 0.0 )
+           || !( isfinite( af->dlon ) && af->dlon > 0.0 )
+           /* The size of the records, divided rather than multiplied, */
+           /* so that a forged grid cannot wrap it around               */
+           || (size_t) af->nlat > ( af->size - ALMFILE_HEADER ) / ALMFILE_RECORD
+                                  / (size_t) ( days_since_2000_Jan_0(af->year1+1,1,1)
+                                               - days_since_2000_Jan_0(af->year0,1,1) )
+                                  / (size_t) af->nlon
+           || af->size != almfile_year_offset( af->year0, af->year1 + 1, ncells ) )
+      {
+            munmap( base, sb.st_size );
+            return -1;
+      }
+      return 0;
+}  /* almanac_open */
+
+void almanac_close( struct almanac_file *af )
+{
+      munmap( (void *) af->base, af->size );
+      af->base = NULL;
+}  /* almanac_close */
+
+int almanac_lookup( const struct almanac_file *af, int year, int month,
+                    int day, double lon, double lat, int kind,
+                    double *trise, double *tset )
+/**********************************************************************/
+/* Reads the rise and set times of the given kind (KIND_RISE_SET ...  */
+/* KIND_ASTRONOMICAL) in the almanac file, interpolated between the   */
+/* grid cells around (lon, lat).  Same conventions as __sunriset__.   */
+/* Return value: as __sunriset__, or ALMFILE_OUTSIDE if the date or   */
+/*               the site is not covered by the file, or kind is not  */
+/*               one of the kinds of the file                         */
+/**********************************************************************/
+{
+      const unsigned char *q[4], *day_records;
+      double fi, fj, u, v, w[4], noon, r = 0.0, s = 0.0;
+      long   i, j, i1, j1, doy, ncells;
+      int    c, nearest = 0, rc[4], same = 1;
+
+      if ( year < af->year0 || year > af->year1
+           || kind < 0 || kind >= SUNRISET_KINDS )
+            return ALMFILE_OUTSIDE;
+      doy = days_since_2000_Jan_0(year,month,day) - days_since_2000_Jan_0(year,1,1);
+      if ( doy < 0 || doy >= almanac_days( year ) )
+            return ALMFILE_OUTSIDE;
+
+      /* Grid cells around the site, and their weights */
+      /* The negated tests also reject NaN */
+      fi = ( lat - af->lat0 ) / af->dlat;
+      if ( !( fi >= -1e-9 && fi <= af->nlat - 1 + 1e-9 ) )
+            return ALMFILE_OUTSIDE;
+      if ( af->wrap )
+            fj = ( lon - af->lon0 - 360.0 * floor( ( lon - af->lon0 ) / 360.0 ) )
+                 / af->dlon;
+      else
+            fj = ( lon - af->lon0 ) / af->dlon;
+      if ( !( fj >= -1e-9 && ( af->wrap || fj <= af->nlon - 1 + 1e-9 ) ) )
+            return ALMFILE_OUTSIDE;
+      i  = fi <= 0.0 ? 0 : (long) fi >= af->nlat - 1 ? af->nlat - 1 : (long) fi;
+      j  = fj <= 0.0 ? 0 : (long) fj >= af->nlon - 1 && !af->wrap ? af->nlon - 1
+                         : (long) fj >= af->nlon ? af->nlon - 1 : (long) fj;
+      u  = fi - i;
+      v  = fj - j;
+      i1 = i + 1 < af->nlat ? i + 1 : i;
+      j1 = j + 1 < af->nlon ? j + 1 : af->wrap ? 0 : j;
+      w[0] = ( 1 - u ) * ( 1 - v );
+      w[1] = ( 1 - u ) * v;
+      w[2] = u * ( 1 - v );
+      w[3] = u * v;
+
+      ncells = (long) af->nlat * af->nlon;
+      day_records = af->base + almfile_year_offset( af->year0, year, ncells )
+                                  + doy * ncells * ALMFILE_RECORD;
+      q[0] = day_records + ( i  * af->nlon + j  ) * ALMFILE_RECORD;
+      q[1] = day_records + ( i  * af->nlon + j1 ) * ALMFILE_RECORD;
+      q[2] = day_records + ( i1 * af->nlon + j  ) * ALMFILE_RECORD;
+      q[3] = day_records + ( i1 * af->nlon + j1 ) * ALMFILE_RECORD;
+
+      for ( c = 0; c < 4; c++ )
+      {
+            int f = ( q[c][0] >> 2*kind ) & 3;
+            rc[c] = f == 1 ? +1 : f == 2 ? -1 : 0;
+            if ( w[c] > w[nearest] )
+                  nearest = c;
+      }
+      for ( c = 0; c < 4; c++ )
+            if ( w[c] > 0.0 && rc[c] != rc[nearest] )
+                  same = 0;
+
+      /* Times are stored relative to the local mean noon of each */
+      /* cell, so they can be interpolated across the date line   */
+      noon = 12.0 - lon/15.0;
+      noon -= 24.0 * floor( noon / 24.0 );
+      for ( c = 0; c < 4; c++ )
+      {
+            if ( !same && c != nearest )
+                  continue;
+            r += ( same ? w[c] : 1.0 ) *
+                 (short) get_le( q[c] + 1 + 4*kind, 2 ) * af->quantum / 3600.0;
+            s += ( same ? w[c] : 1.0 ) *
+                 (short) get_le( q[c] + 3 + 4*kind, 2 ) * af->quantum / 3600.0;
+      }
+      *trise = noon + r;
+      *tset  = noon + s;
+      return rc[nearest];
+}  /* almanac_lookup */
+
+
+
+/* Rasters */
+
+/* Diurnal arcs of one row of cells, with the libm or a vectorized */
+/* kernel of sunriset-arcs.h                                       */
+static void raster_row( int isa, long n, double sin_lat, double cos_lat,
+                        const double *sin_alt, const double *sin_dec,
+                        const double *cos_dec, double *t )
+{
+      long j;
+
+      switch ( isa )
+      {
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+            case ISA_AVX512:
+                  arcs_avx512_row( n, sin_lat, cos_lat, sin_alt, sin_dec,
+                                   cos_dec, t );
+                  return;
+            case ISA_AVX2:
+                  arcs_avx2_row( n, sin_lat, cos_lat, sin_alt, sin_dec,
+                                 cos_dec, t );
+                  return;
+            case ISA_SSE2:
+                  arcs_sse2_row( n, sin_lat, cos_lat, sin_alt, sin_dec,
+                                 cos_dec, t );
+                  return;
+#endif
+      }
+      for ( j = 0; j < n; j++ )
+      {
+            /* The operations of __sunriset__, in the same order */
+            double cost = ( sin_alt[j] - sin_lat * sin_dec[j] ) /
+                          ( cos_lat * cos_dec[j] );
+            if ( cost >= 1.0 )
+                  t[j] = 0.0;
+            else if ( cost <= -1.0 )
+                  t[j] = 12.0;
+            else
+                  t[j] = acosd(cost)/15.0;
+      }
+}
+
+int sunriset_raster_init( struct sunriset_raster *r, int year, int month,
+                          int day, double altit, int upper_limb,
+                          double lat0, double dlat, int nlat,
+                          double lon0, double dlon, int nlon,
+                          int layers, int isa )
+/**********************************************************************/
+/* Prepares the raster r of the given date, altitude and grid:        */
+/*       layers = RASTER_RISE, RASTER_SET and/or RASTER_DAYLEN        */
+/*       isa    = ISA_SCALAR, or sunriset_isa() for the vectorized    */
+/*                kernel                                              */
+/* Return value: 0, or -1 if out of memory                            */
+/**********************************************************************/
+{
+      long   i, j;
+      double d, lon, sidtime, sRA, sdec, sr, a;
+
+      memset( r, 0, sizeof *r );
+      r->nlat   = nlat;
+      r->nlon   = nlon;
+      r->ntlat  = ( nlat + RASTER_TILE - 1 ) / RASTER_TILE;
+      r->ntlon  = ( nlon + RASTER_TILE - 1 ) / RASTER_TILE;
+      r->layers = layers & ( RASTER_RISE | RASTER_SET | RASTER_DAYLEN );
+      r->isa    = isa;
+      r->sin_alt = malloc( nlon * sizeof(double) );
+      r->sin_dec = malloc( nlon * sizeof(double) );
+      r->cos_dec = malloc( nlon * sizeof(double) );
+      r->tsouth  = malloc( nlon * sizeof(double) );
+      r->sin_lat = malloc( nlat * sizeof(double) );
+      r->cos_lat = malloc( nlat * sizeof(double) );
+      if ( !r->sin_alt || !r->sin_dec || !r->cos_dec || !r->tsouth
+           || !r->sin_lat || !r->cos_lat )
+      {
+            sunriset_raster_free( r );
+            return -1;
+      }
+
+      /* Per column, the first half of __sunriset__ */
+      for ( j = 0; j < nlon; j++ )
+      {
+            lon = lon0 + j * dlon;
+            d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+            sidtime = revolution( GMST0(d) + 180.0 + lon );
+            sun_RA_dec( d, &sRA, &sdec, &sr );
+            a = upper_limb ? altit - 0.2666 / sr : altit;
+            r->tsouth[j]  = 12.0 - rev180(sidtime - sRA)/15.0;
+            r->sin_alt[j] = sind(a);
+            r->sin_dec[j] = sind(sdec);
+            r->cos_dec[j] = cosd(sdec);
+      }
+
+      /* Per row */
+      for ( i = 0; i < nlat; i++ )
+      {
+            r->sin_lat[i] = sind(lat0 + i * dlat);
+            r->cos_lat[i] = cosd(lat0 + i * dlat);
+      }
+      return 0;
+}  /* sunriset_raster_init */
+
+void sunriset_raster_free( struct sunriset_raster *r )
+{
+      free( r->sin_alt ); free( r->sin_dec ); free( r->cos_dec );
+      free( r->tsouth ); free( r->sin_lat ); free( r->cos_lat );
+      r->sin_alt = r->sin_dec = r->cos_dec = r->tsouth = NULL;
+      r->sin_lat = r->cos_lat = NULL;
+}  /* sunriset_raster_free */
+
+long sunriset_raster_index( const struct sunriset_raster *r, long i,
+                            long j )
+/**********************************************************************/
+/* Index of the cell of row i (latitude lat0 + i*dlat) and column j   */
+/* (longitude lon0 + j*dlon) in each layer of the result of           */
+/* sunriset_raster_tiles() for the whole grid                         */
+/**********************************************************************/
+{
+      return ( ( i / RASTER_TILE ) * r->ntlon + j / RASTER_TILE )
+                   * RASTER_TILE * RASTER_TILE
+             + ( i % RASTER_TILE ) * RASTER_TILE + j % RASTER_TILE;
+}  /* sunriset_raster_index */
+
+void sunriset_raster_tiles( const struct sunriset_raster *r, int ti0,
+                            int ti1, float *out )
+/**********************************************************************/
+/* Computes the rows of tiles ti0 to ti1 - 1 of the raster r:         */
+/*       out = room for ( ti1 - ti0 ) * r->ntlon * RASTER_TILE^2      */
+/*             floats per selected layer, the layers one after the    */
+/*             other; ti0 = 0, ti1 = r->ntlat for the whole grid      */
+/* Tile by tile, so that the factors of the columns of a tile stay in */
+/* the L1 cache while its rows are computed.                          */
+/**********************************************************************/
+{
+      const long tsize = RASTER_TILE * RASTER_TILE;
+      long   ntiles = (long) ( ti1 - ti0 ) * r->ntlon, base, i, j0, c;
+      float  *lay[RASTER_NLAYERS];
+      double t[RASTER_TILE];
+      int    ti, tj, row, w, k, nl = 0;
+
+      STATS_BEGIN;
+
+      for ( k = 0; k < RASTER_NLAYERS; k++ )
+            lay[k] = r->layers & ( 1 << k ) ? out + nl++ * ntiles * tsize : NULL;
+
+      for ( ti = ti0; ti < ti1; ti++ )
+            for ( tj = 0; tj < r->ntlon; tj++ )
+            {
+                  j0 = (long) tj * RASTER_TILE;
+                  w  = r->nlon - j0 < RASTER_TILE ? (int) ( r->nlon - j0 )
+                                                  : RASTER_TILE;
+                  for ( row = 0; row < RASTER_TILE; row++ )
+                  {
+                        i    = (long) ti * RASTER_TILE + row;
+                        base = ( (long) ( ti - ti0 ) * r->ntlon + tj ) * tsize
+                               + row * RASTER_TILE;
+                        if ( i < r->nlat )
+                              raster_row( r->isa, w, r->sin_lat[i],
+                                          r->cos_lat[i], r->sin_alt + j0,
+                                          r->sin_dec + j0, r->cos_dec + j0, t );
+                        else
+                              w = 0;
+                        if ( lay[0] )
+                              for ( c = 0; c < w; c++ )
+                                    lay[0][base + c] = (float) ( r->tsouth[j0 + c] - t[c] );
+                        if ( lay[1] )
+                              for ( c = 0; c < w; c++ )
+                                    lay[1][base + c] = (float) ( r->tsouth[j0 + c] + t[c] );
+                        if ( lay[2] )
+                              for ( c = 0; c < w; c++ )
+                                    lay[2][base + c] = (float) ( ( r->tsouth[j0 + c] + t[c] )
+                                                               - ( r->tsouth[j0 + c] - t[c] ) );
+                        for ( k = 0; k < RASTER_NLAYERS; k++ )
+                              if ( lay[k] && w < RASTER_TILE )
+                                    memset( lay[k] + base + w, 0,
+                                            ( RASTER_TILE - w ) * sizeof(float) );
+                  }
+            }
+      STATS_END( STATS_RASTER, STATS_NORC );
+}  /* sunriset_raster_tiles */
+
+/* Float x as 4 little-endian bytes, and back */
+static void put_float( unsigned char *q, float x )
+{
+      unsigned int v;
+      memcpy( &v, &x, 4 );
+      put_le( q, v, 4 );
+}
+
+static float get_float( const unsigned char *q )
+{
+      unsigned int v = (unsigned int) get_le( q, 4 );
+      float x;
+      memcpy( &x, &v, 4 );
+      return x;
+}
+
+int raster_write( const char *path, int year, int month, int day,
+                  double altit, int upper_limb, double lat0, double dlat,
+                  int nlat, double lon0, double dlon, int nlon, int layers )
+/**********************************************************************/
+/* Builds the raster file path, see RASTER_HEADER, one row of tiles   */
+/* at a time, with the vectorized kernel from AVX2 up: with SSE2, the */
+/* polynomial arc cosine is slower than the one of the libm           */
+/* Return value: 0, or -1 with errno set                              */
+/**********************************************************************/
+{
+      struct sunriset_raster r;
+      FILE   *fp;
+      unsigned char hdr[RASTER_HEADER], *buf = NULL;
+      float  *out = NULL;
+      long   per_row, per_layer, n, m;
+      int    ti, k, nl, rv = -1, isa = sunriset_isa();
+
+      if ( sunriset_raster_init( &r, year, month, day, altit, upper_limb,
+                                 lat0, dlat, nlat, lon0, dlon, nlon, layers,
+                                 isa >= ISA_AVX2 ? isa : ISA_SCALAR ) != 0 )
+            return -1;
+      if ( ( fp = fopen( path, "wb" ) ) == NULL )
+      {
+            sunriset_raster_free( &r );
+            return -1;
+      }
+      memset( hdr, 0, sizeof hdr );
+      memcpy( hdr, "SUNRAS1", 8 );
+      put_le( hdr + 8,  year, 4 );
+      put_le( hdr + 12, month, 4 );
+      put_le( hdr + 16, day, 4 );
+      put_le( hdr + 20, upper_limb ? 1 : 0, 4 );
+      put_le( hdr + 24, nlat, 4 );
+      put_le( hdr + 28, nlon, 4 );
+      put_le( hdr + 32, RASTER_TILE, 4 );
+      put_le( hdr + 36, r.layers, 4 );
+      put_double( hdr + 40, altit );
+      put_double( hdr + 48, lat0 );
+      put_double( hdr + 56, dlat );
+      put_double( hdr + 64, lon0 );
+      put_double( hdr + 72, dlon );
+      if ( fwrite( hdr, 1, sizeof hdr, fp ) != sizeof hdr )
+            goto done;
+
+      for ( k = nl = 0; k < RASTER_NLAYERS; k++ )
+            nl += ( r.layers >> k ) & 1;
+      per_row   = (long) r.ntlon * RASTER_TILE * RASTER_TILE;
+      per_layer = r.ntlat * per_row;
+      out = malloc( nl * per_row * sizeof(float) );
+      buf = malloc( per_row * 4 );
+      if ( !out || !buf )
+            goto done;
+      for ( ti = 0; ti < r.ntlat; ti++ )
+      {
+            sunriset_raster_tiles( &r, ti, ti + 1, out );
+            for ( k = 0; k < nl; k++ )
+            {
+                  for ( n = 0, m = k * per_row; n < per_row; n++, m++ )
+                        put_float( buf + 4 * n, out[m] );
+                  if ( fseeko( fp, RASTER_HEADER
+                                   + ( k * per_layer + ti * per_row ) * 4,
+                               SEEK_SET ) != 0
+                       || fwrite( buf, 4, per_row, fp ) != (size_t) per_row )
+                        goto done;
+            }
+      }
+      rv = 0;
+
+done:
+      free( out ); free( buf );
+      sunriset_raster_free( &r );
+      if ( fclose( fp ) != 0 )
+            rv = -1;
+      return rv;
+}  /* raster_write */
+
+int raster_open( struct raster_file *rf, const char *path )
+/**********************************************************************/
+/* Maps the raster file path in memory                                */
+/* Return value: 0, or -1 if it cannot be read or is not a raster     */
+/*               file                                                 */
+/**********************************************************************/
+{
+      struct stat sb;
+      void  *base;
+      int    fd, k, nl = 0;
+
+      if ( ( fd = open( path, O_RDONLY ) ) < 0 )
+            return -1;
+      if ( fstat( fd, &sb ) != 0 || sb.st_size < RASTER_HEADER )
+      {
+            close( fd );
+            return -1;
+      }
+      base = mmap( NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+      close( fd );
+      if ( base == MAP_FAILED )
+            return -1;
+
+      rf->base   = base;
+      rf->size   = sb.st_size;
+      rf->year   = (int) get_le( rf->base + 8, 4 );
+      rf->month  = (int) get_le( rf->base + 12, 4 );
+      rf->day    = (int) get_le( rf->base + 16, 4 );
+      rf->upper_limb = (int) get_le( rf->base + 20, 4 );
+      rf->nlat   = (int) get_le( rf->base + 24, 4 );
+      rf->nlon   = (int) get_le( rf->base + 28, 4 );
+      rf->layers = (int) get_le( rf->base + 36, 4 );
+      rf->altit  = get_double( rf->base + 40 );
+      rf->lat0   = get_double( rf->base + 48 );
+      rf->dlat   = get_double( rf->base + 56 );
+      rf->lon0   = get_double( rf->base + 64 );
+      rf->dlon   = get_double( rf->base + 72 );
+      rf->ntlat  = ( rf->nlat + RASTER_TILE - 1 ) / RASTER_TILE;
+      rf->ntlon  = ( rf->nlon + RASTER_TILE - 1 ) / RASTER_TILE;
+      for ( k = 0; k < RASTER_NLAYERS; k++ )
+            nl += ( rf->layers >> k ) & 1;
+      if ( memcmp( rf->base, "SUNRAS1", 8 ) != 0
+           || get_le( rf->base + 32, 4 ) != RASTER_TILE
+           || rf->nlat < 1 || rf->nlon < 1
+           || rf->size != RASTER_HEADER + (size_t) nl * rf->ntlat * rf->ntlon
+                                          * RASTER_TILE * RASTER_TILE * 4 )
+      {
+            munmap( base, sb.st_size );
+            return -1;
+      }
+      return 0;
+}  /* raster_open */
+
+void raster_close( struct raster_file *rf )
+{
+      munmap( (void *) rf->base, rf->size );
+      rf->base = NULL;
+}  /* raster_close */
+
+int raster_cell( const struct raster_file *rf, int layer, long i, long j,
+                 double *value )
+/**********************************************************************/
+/* Reads the cell of row i and column j of the layer (RASTER_RISE,    */
+/* RASTER_SET or RASTER_DAYLEN) of the mapped raster file             */
+/* Return value: 0, or -1 if the file has no such layer or cell       */
+/**********************************************************************/
+{
+      long   idx;
+      int    k, nl = 0;
+
+      if ( !( rf->layers & layer ) || i < 0 || i >= rf->nlat
+           || j < 0 || j >= rf->nlon )
+            return -1;
+      for ( k = 0; ( 1 << k ) < layer; k++ )
+            nl += ( rf->layers >> k ) & 1;
+      idx = ( ( i / RASTER_TILE ) * rf->ntlon + j / RASTER_TILE )
+                * RASTER_TILE * RASTER_TILE
+            + ( i % RASTER_TILE ) * RASTER_TILE + j % RASTER_TILE;
+      *value = get_float( rf->base + RASTER_HEADER
+                          + ( (size_t) nl * rf->ntlat * rf->ntlon
+                              * RASTER_TILE * RASTER_TILE + idx ) * 4 );
+      return 0;
+}  /* raster_cell */
+
+
+/* This function computes the Sun's position at any instant */
+
+void sunpos( double d, double *lon, double *r )
+/******************************************************/
+/* Computes the Sun's ecliptic longitude and distance */
+/* at an instant given in d, number of days since     */
+/* 2000 Jan 0.0.  The Sun's ecliptic latitude is not  */
+/* computed, since it's always very near 0.           */
+/******************************************************/
+{
+      double M,         /* Mean anomaly of the Sun */
+             w,         /* Mean longitude of perihelion */
+                        /* Note: Sun's mean longitude = M + w */
+             e,         /* Eccentricity of Earth's orbit */
+             E,         /* Eccentric anomaly */
+             x, y,      /* x, y coordinates in orbit */
+             v;         /* True anomaly */
+
+      /* Compute mean elements */
+      M = revolution( 356.0470 + 0.9856002585 * d );
+      w = 282.9404 + 4.70935E-5 * d;
+      e = 0.016709 - 1.151E-9 * d;
+
+      /* Compute true longitude and radius vector */
+      E = M + e * RADEG * sind(M) * ( 1.0 + e * cosd(M) );
+            x = cosd(E) - e;
+      y = sqrt( 1.0 - e*e ) * sind(E);
+      *r = sqrt( x*x + y*y );              /* Solar distance */
+      v = atan2d( y, x );                  /* True anomaly */
+      *lon = v + w;                        /* True solar longitude */
+      if ( *lon >= 360.0 )
+            *lon -= 360.0;                   /* Make it 0..360 degrees */
+}
+
+void sun_RA_dec( double d, double *RA, double *dec, double *r )
+/******************************************************/
+/* Computes the Sun's equatorial coordinates RA, Decl */
+/* and also its distance, at an instant given in d,   */
+/* the number of days since 2000 Jan 0.0.             */
+/******************************************************/
+{
+      double lon, obl_ecl, x, y, z;
+
+      /* Compute Sun's ecliptical coordinates */
+      sunpos( d, &lon, r );
+
+      /* Compute ecliptic rectangular coordinates (z=0) */
+      x = *r * cosd(lon);
+      y = *r * sind(lon);
+
+      /* Compute obliquity of ecliptic (inclination of Earth's axis) */
+      obl_ecl = 23.4393 - 3.563E-7 * d;
+
+      /* Convert to equatorial rectangular coordinates - x is unchanged */
+      z = y * sind(obl_ecl);
+      y = y * cosd(obl_ecl);
+
+      /* Convert to spherical coordinates */
+      *RA = atan2d( y, x );
+      *dec = atan2d( z, sqrt(x*x + y*y) );
+
+}  /* sun_RA_dec */
+
+
+/* The Sun's position, extended range: see EPHEM_MEEUS */
+
+void sun_RA_dec_meeus( double d, double *RA, double *dec, double *r,
+                       double *lmean )
+/**********************************************************************/
+/* Computes the Sun's apparent RA, Decl and distance, and its mean    */
+/* longitude as in the equation of time, at an instant given in d,    */
+/* the number of days since 2000 Jan 0.0 UT, as sun_RA_dec does but   */
+/* from Meeus, "Astronomical Algorithms", chapters 22, 25 and 28:     */
+/* the mean longitude to the 5th power of time, the mean anomaly and  */
+/* the eccentricity to the 2nd power, Kepler's equation solved by     */
+/* Newton's method instead of the equation of center, the main terms  */
+/* of the nutation, the aberration, and the obliquity of Laskar,      */
+/* valid for 10000 years on either side of 2000.  The instant is      */
+/* converted to dynamical time with the parabola of Morrison and      */
+/* Stephenson for Delta T, which is only an estimate far from the     */
+/* present: in -2000, its uncertainty is about an hour, or about 10   */
+/* seconds on the times of rise and set.                              */
+/**********************************************************************/
+{
+      double y, u, dt,  /* Year, and Delta T in seconds */
+             T, tau,    /* Julian centuries and millennia since J2000.0 TD */
+             U,         /* Units of 10000 years since J2000.0 TD */
+             L0,        /* Sun's mean longitude */
+             M,         /* Sun's mean anomaly */
+             e,         /* Eccentricity of Earth's orbit */
+             E, dE,     /* Eccentric anomaly, and its Newton correction */
+             v,         /* True anomaly */
+             lon,       /* Sun's true, then apparent longitude */
+             omega,     /* Longitude of the Moon's ascending node */
+             Lm,        /* Moon's mean longitude */
+             dpsi,      /* Nutation in longitude, degrees */
+             deps,      /* Nutation in obliquity, degrees */
+             eps;       /* True obliquity of ecliptic */
+      int    k;
+
+      /* Dynamical time */
+      y  = 2000.0 + ( d - 1.5 ) / 365.25;
+      u  = ( y - 1820.0 ) / 100.0;
+      dt = -20.0 + 32.0 * u * u;
+      T   = ( d - 1.5 + dt / 86400.0 ) / 36525.0;
+      tau = T / 10.0;
+      U   = T / 100.0;
+
+      /* Mean elements */
+      L0 = 280.4664567 + tau * ( 360007.6982779 + tau * ( 0.03032028
+           + tau * ( 1.0/49931.0 + tau * ( -1.0/15300.0
+           + tau * ( -1.0/2000000.0 ) ) ) ) );
+      L0 = revolution( L0 );
+      M  = revolution( 357.52911 + T * ( 35999.05029 - 0.0001537 * T ) );
+      e  = 0.016708634 - T * ( 0.000042037 + 0.0000001267 * T );
+
+      /* Kepler's equation, E - e sin E = M, in radians */
+      E = M * DEGRAD + e * sin( M * DEGRAD );
+      for ( k = 0; k < KEPLER_MAXITER; k++ )
+      {
+            dE = ( E - e * sin(E) - M * DEGRAD ) / ( 1.0 - e * cos(E) );
+            E -= dE;
+            if ( fabs(dE) < KEPLER_TOL )
+                  break;
+      }
+
+      /* True anomaly, distance and true longitude */
+      v   = atan2d( sqrt( 1.0 - e*e ) * sin(E), cos(E) - e );
+      *r  = 1.000001018 * ( 1.0 - e * cos(E) );
+      lon = L0 + v - M;
+
+      /* Nutation, main terms, and aberration */
+      omega = 125.04452 - 1934.136261 * T;
+      Lm    = 218.3165 + 481267.8813 * T;
+      dpsi  = ( -17.20 * sind(omega) - 1.32 * sind(2.0*L0)
+                - 0.23 * sind(2.0*Lm) + 0.21 * sind(2.0*omega) ) / 3600.0;
+      deps  = (   9.20 * cosd(omega) + 0.57 * cosd(2.0*L0)
+                + 0.10 * cosd(2.0*Lm) - 0.09 * cosd(2.0*omega) ) / 3600.0;
+      lon  += dpsi - 20.4898 / 3600.0 / *r;
+
+      /* Obliquity of Laskar, arc seconds, plus the nutation */
+      eps = 84381.448 + U * ( -4680.93 + U * ( -1.55 + U * ( 1999.25
+            + U * ( -51.38 + U * ( -249.67 + U * ( -39.05 + U * ( 7.12
+            + U * ( 27.87 + U * ( 5.79 + U * 2.45 ) ) ) ) ) ) ) ) );
+      eps = eps / 3600.0 + deps;
+
+      /* Convert to equatorial coordinates */
+      *RA    = revolution( atan2d( cosd(eps) * sind(lon), cosd(lon) ) );
+      *dec   = asind( sind(eps) * sind(lon) );
+      *lmean = L0 - 0.0057183 + dpsi * cosd(eps);
+}  /* sun_RA_dec_meeus */
+
+
+/* Calendar of the extended range */
+
+long sunriset_days( int year, int month, int day )
+/**********************************************************************/
+/* Same as days_since_2000_Jan_0, for any date: Gregorian from 1582   */
+/* October 15, Julian before, the year before 1 being 0 and the one   */
+/* before that -1 (Meeus, chapter 7).  days_since_2000_Jan_0 is right */
+/* only from 1900 March 1st to 2100 February 28th.                    */
+/**********************************************************************/
+{
+      double jd;
+      int    a, b = 0;
+
+      if ( month <= 2 )
+      {
+            year  -= 1;
+            month += 12;
+      }
+      if ( year > 1582 || ( year == 1582 && ( month > 10
+                            || ( month == 10 && day >= 15 ) ) ) )
+      {
+            a = year / 100;
+            b = 2 - a + a / 4;
+      }
+      jd = floor( 365.25 * ( year + 4716 ) ) + floor( 30.6001 * ( month + 1 ) )
+           + day + b - 1524.5;
+      return (long) ( jd - 2451543.5 );
+}  /* sunriset_days */
+
+
+/* Precomputed ephemeris: table of sun_RA_dec results, see struct sun_ephem */
+
+int sun_ephem_init( struct sun_ephem *eph, int year0, int year1, double step )
+/**********************************************************************/
+/* Tabulates the Sun's position every step days, for the dates of    */
+/* the years year0 to year1 at any longitude (1801-2099 only).        */
+/* Return value: 0, or -1 if the table cannot be allocated            */
+/**********************************************************************/
+{
+      double d, RA, dec, r;
+      long   i;
+
+      /* d = day + 0.5 - lon/360 ranges over day .. day+1, plus the */
+      /* neighbours needed by the interpolation                     */
+      eph->step = step;
+      eph->d0   = days_since_2000_Jan_0(year0,1,1) - 2.0*step;
+      eph->n    = (long) ceil( ( days_since_2000_Jan_0(year1,12,31) + 1.0
+                                 - eph->d0 ) / step ) + 3;
+      eph->tab  = malloc( 3 * eph->n * sizeof(float) );
+      if ( eph->tab == NULL )
+            return -1;
+
+      for ( i = 0; i < eph->n; i++ )
+      {
+            d = eph->d0 + i * step;
+            sun_RA_dec( d, &RA, &dec, &r );
+            /* GMST0 - 180 is the Sun's mean longitude */
+            eph->tab[3*i]   = rev180( RA - GMST0(d) + 180.0 );
+            eph->tab[3*i+1] = dec;
+            eph->tab[3*i+2] = r;
+      }
+      return 0;
+}  /* sun_ephem_init */
+
+void sun_ephem_free( struct sun_ephem *eph )
+{
+      free( eph->tab );
+      eph->tab = NULL;
+      eph->n   = 0;
+}  /* sun_ephem_free */
+
+void sun_RA_dec_ephem( struct ephem_reader *er, double d,
+                       double *RA, double *dec, double *r )
+/**********************************************************************/
+/* Same as sun_RA_dec, interpolated in the table of er->eph.  Falls   */
+/* back to sun_RA_dec if d is outside of the table.  If er is NULL or */
+/* has no table, computes the position with the backend of er (see    */
+/* EPHEM_DEFAULT).  The RA of EPHEM_MEEUS is shifted by the mean      */
+/* longitude of sunpos() minus that of Meeus, so that the hour angle  */
+/* which the callers compute with GMST0() is the equation of time of  */
+/* Meeus.                                                             */
+/**********************************************************************/
+{
+      const struct sun_ephem *eph;
+      const float *p;
+      double x, u, w0, w1, w2, w3, lmean;
+      long   i;
+
+      if ( er == NULL || er->eph == NULL )
+      {
+            if ( ephem_backend( er ) == EPHEM_MEEUS )
+            {
+                  sun_RA_dec_meeus( d, RA, dec, r, &lmean );
+                  *RA = revolution( *RA + GMST0(d) - 180.0 - lmean );
+            }
+            else
+                  sun_RA_dec( d, RA, dec, r );
+            return;
+      }
+      eph = er->eph;
+      x = ( d - eph->d0 ) / eph->step;
+      i = (long) floor( x );
+      if ( i < 1 || i + 2 >= eph->n )
+      {
+            er->misses++;
+            sun_RA_dec( d, RA, dec, r );
+            return;
+      }
+      er->hits++;
+
+      /* Cubic Lagrange weights for entries i-1, i, i+1, i+2 */
+      u  = x - i;
+      w0 = -u * ( u - 1.0 ) * ( u - 2.0 ) / 6.0;
+      w1 = ( u + 1.0 ) * ( u - 1.0 ) * ( u - 2.0 ) / 2.0;
+      w2 = -( u + 1.0 ) * u * ( u - 2.0 ) / 2.0;
+      w3 = ( u + 1.0 ) * u * ( u - 1.0 ) / 6.0;
+
+      p    = eph->tab + 3 * ( i - 1 );
+      *RA  = revolution( w0 * p[0] + w1 * p[3] + w2 * p[6] + w3 * p[9]
+                         + GMST0(d) - 180.0 );
+      *dec = w0 * p[1] + w1 * p[4] + w2 * p[7] + w3 * p[10];
+      *r   = w0 * p[2] + w1 * p[5] + w2 * p[8] + w3 * p[11];
+}  /* sun_RA_dec_ephem */
+
+
+/******************************************************************/
+/* This function reduces any angle to within the first revolution */
+/* by subtracting or adding even multiples of 360.0 until the     */
+/* result is >= 0.0 and < 360.0                                   */
+/******************************************************************/
+
+#define INV360    ( 1.0 / 360.0 )
+
+double revolution( double x )
+/*****************************************/
+/* Reduce angle to within 0..360 degrees */
+/*****************************************/
+{
+      return( x - 360.0 * floor( x * INV360 ) );
+}  /* revolution */
+
+double rev180( double x )
+/*********************************************/
+/* Reduce angle to within +180..+180 degrees */
+/*********************************************/
+{
+      return( x - 360.0 * floor( x * INV360 + 0.5 ) );
+}  /* revolution */
+
+
+/*******************************************************************/
+/* This function computes GMST0, the Greenwich Mean Sidereal Time  */
+/* at 0h UT (i.e. the sidereal time at the Greenwhich meridian at  */
 /* 0h UT).  GMST is then the sidereal time at Greenwich at any     */
 /* time of the day.  I've generalized GMST0 as well, and define it */
 /* as:  GMST0 = GMST - UT  --  this allows GMST0 to be computed at */
@@ -516,3 +2749,805 @@ double GMST0( double d )
                           ( 0.9856002585 + 4.70935E-5 ) * d );
       return sidtim0;
 }  /* GMST0 */
+
+
+
+/* The streaming pipeline */
+
+#define STREAM_INBUF    ( 1 << 20 )     /* Bytes read at a time */
+#define STREAM_OUTBUF   ( 1 << 20 )     /* Bytes written at a time */
+#define STREAM_BATCH    4096            /* Records computed together */
+#define STREAM_FIELD    32              /* Longest CSV field, bytes */
+
+/* Longest CSV record: 5 + 3*SUNRISET_KINDS fields, their separators */
+/* and the newline; stream_emit keeps that much room in obuf          */
+#define STREAM_CSV_MAX  ( ( 5 + 3*SUNRISET_KINDS ) * ( STREAM_FIELD + 1 ) + 1 )
+
+struct stream_state
+{
+      FILE   *out;
+      int    format;
+      long   n;                         /* Records in the batch */
+      size_t olen;                      /* Bytes in obuf */
+      int    year[STREAM_BATCH], month[STREAM_BATCH], day[STREAM_BATCH];
+      double lon[STREAM_BATCH], lat[STREAM_BATCH];
+      double rise[SUNRISET_KINDS*STREAM_BATCH], set[SUNRISET_KINDS*STREAM_BATCH];
+      int    rc[SUNRISET_KINDS*STREAM_BATCH];
+      char   obuf[STREAM_OUTBUF];
+      char   ibuf[STREAM_INBUF];
+};
+
+static const double pow10tab[] =
+{
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Parses a decimal number from p, stops at end.  Exact (as strtod) */
+/* for up to 15 significant digits.  Returns the first character    */
+/* after the number, or NULL if there is no number at p.            */
+static const char *stream_number( const char *p, const char *end, double *x )
+{
+      unsigned long long m = 0;
+      int    neg = 0, nd = 0, scale = 0, digits = 0, e = 0, eneg = 0;
+      double v;
+
+      if ( p < end && ( *p == '-' || *p == '+' ) )
+            neg = *p++ == '-';
+      for ( ; p < end && *p >= '0' && *p <= '9'; p++, digits++ )
+            if ( nd < 19 )
+                  m = 10 * m + ( *p - '0' ), nd += m != 0;
+            else
+                  scale++;
+      if ( p < end && *p == '.' )
+            for ( p++; p < end && *p >= '0' && *p <= '9'; p++, digits++ )
+                  if ( nd < 19 )
+                        m = 10 * m + ( *p - '0' ), nd += m != 0, scale--;
+      if ( digits == 0 )
+            return NULL;
+      if ( p < end && ( *p == 'e' || *p == 'E' ) )
+      {
+            p++;
+            if ( p < end && ( *p == '-' || *p == '+' ) )
+                  eneg = *p++ == '-';
+            if ( p == end || *p < '0' || *p > '9' )
+                  return NULL;
+            for ( ; p < end && *p >= '0' && *p <= '9'; p++ )
+                  if ( e < 1000 )
+                        e = 10 * e + ( *p - '0' );
+            scale += eneg ? -e : e;
+      }
+      v = (double) m;
+      if ( scale < 0 )
+            v = scale >= -22 ? v / pow10tab[-scale] : v / pow( 10.0, -scale );
+      else if ( scale > 0 )
+            v = scale <= 22 ? v * pow10tab[scale] : v * pow( 10.0, scale );
+      *x = neg ? -v : v;
+      return p;
+}
+
+/* Writes x with dec decimals at q, like printf "%.*f", returns the end; */
+/* at most STREAM_FIELD bytes: longer numbers (|x| >= 1e15, which the     */
+/* range checks of sunriset_stream exclude) are truncated                 */
+static char *stream_fixed( char *q, double x, int dec )
+{
+      char   tmp[STREAM_FIELD + 1];
+      long long v;
+      int    n = 0;
+
+      if ( !( fabs( x ) < 1e15 ) )
+      {
+            n = snprintf( tmp, sizeof tmp, "%.*f", dec, x );
+            n = n < 0 ? 0 : n > STREAM_FIELD ? STREAM_FIELD : n;
+            memcpy( q, tmp, n );
+            return q + n;
+      }
+      if ( signbit( x ) )
+            *q++ = '-';
+      v = llround( fabs( x ) * pow10tab[dec] );
+      do
+      {
+            tmp[n++] = '0' + v % 10;
+            v /= 10;
+            if ( n == dec )
+                  tmp[n++] = '.';
+      } while ( v > 0 || n <= dec + 1 );
+      while ( n > 0 )
+            *q++ = tmp[--n];
+      return q;
+}
+
+/* Writes v at q, returns the end: at most 20 bytes */
+static char *stream_int( char *q, long v )
+{
+      char tmp[24];
+      int  n = 0;
+
+      if ( v < 0 )
+            *q++ = '-', v = -v;
+      do
+            tmp[n++] = '0' + v % 10;
+      while ( ( v /= 10 ) > 0 );
+      while ( n > 0 )
+            *q++ = tmp[--n];
+      return q;
+}
+
+static int stream_flush( struct stream_state *st )
+{
+      if ( st->olen > 0 && fwrite( st->obuf, 1, st->olen, st->out ) != st->olen )
+            return -1;
+      st->olen = 0;
+      return 0;
+}
+
+static void stream_put_float( unsigned char *q, float f )
+{
+      unsigned long u;
+      unsigned int  b;
+
+      memcpy( &b, &f, 4 );
+      u = b;
+      q[0] = u & 0xFF;
+      q[1] = ( u >> 8 ) & 0xFF;
+      q[2] = ( u >> 16 ) & 0xFF;
+      q[3] = ( u >> 24 ) & 0xFF;
+}
+
+/* Computes the records of the batch and formats them */
+static int stream_emit( struct stream_state *st )
+{
+      long i, k, n = st->n;
+
+      sunriset_batch( n, st->year, st->month, st->day, st->lon, st->lat,
+                      st->rise, st->set, st->rc, ISA_SCALAR, NULL );
+      for ( i = 0; i < n; i++ )
+      {
+            if ( STREAM_OUTBUF - st->olen < STREAM_CSV_MAX
+                 && stream_flush( st ) != 0 )
+                  return -1;
+            if ( st->format == STREAM_BINARY )
+            {
+                  unsigned char *q = (unsigned char *) st->obuf + st->olen;
+                  for ( k = 0; k < SUNRISET_KINDS; k++ )
+                  {
+                        q[k] = (unsigned char) (signed char) st->rc[k*n+i];
+                        stream_put_float( q + SUNRISET_KINDS + 8*k,
+                                          st->rise[k*n+i] );
+                        stream_put_float( q + SUNRISET_KINDS + 8*k + 4,
+                                          st->set[k*n+i] );
+                  }
+                  st->olen += STREAM_RECORD;
+            }
+            else
+            {
+                  char *q = st->obuf + st->olen;
+                  q = stream_fixed( q, st->lat[i], 6 );
+                  *q++ = ',';
+                  q = stream_fixed( q, st->lon[i], 6 );
+                  *q++ = ',';
+                  q = stream_int( q, st->year[i] );
+                  *q++ = ',';
+                  q = stream_int( q, st->month[i] );
+                  *q++ = ',';
+                  q = stream_int( q, st->day[i] );
+                  for ( k = 0; k < SUNRISET_KINDS; k++ )
+                  {
+                        *q++ = ',';
+                        q = stream_int( q, st->rc[k*n+i] );
+                        *q++ = ',';
+                        q = stream_fixed( q, st->rise[k*n+i], 4 );
+                        *q++ = ',';
+                        q = stream_fixed( q, st->set[k*n+i], 4 );
+                  }
+                  *q++ = '\n';
+                  st->olen = q - st->obuf;
+            }
+      }
+      st->n = 0;
+      return 0;
+}
+
+long sunriset_stream( FILE *in, FILE *out, int format )
+/**********************************************************************/
+/* Reads records "lat lon yyyy mm dd" from in, one per line, fields   */
+/* separated by blanks or commas; empty lines and lines starting with */
+/* '#' are ignored.  lat must be within -90 .. 90, lon within         */
+/* -180 .. 180 and the date within 1801-2099, month 1-12, day 1-31.   */
+/* Writes the results of sunriset_batch for each record to out, in    */
+/* the same order, in the given format, STREAM_CSV or STREAM_BINARY.  */
+/* The input and output go through fixed-size buffers, so the memory  */
+/* used does not depend on the input size.                            */
+/* Return value: the number of records, or -1 after an error, which   */
+/*               is reported on stderr.                               */
+/**********************************************************************/
+{
+      struct stream_state *st = malloc( sizeof *st );
+      size_t have = 0, got;
+      long   lineno = 0, nrec = 0;
+      int    eof = 0;
+
+      if ( st == NULL )
+      {
+            fprintf( stderr, "sunriset: out of memory\n" );
+            return -1;
+      }
+      st->out    = out;
+      st->format = format;
+      st->n      = 0;
+      st->olen   = 0;
+
+      while ( !eof )
+      {
+            const char *p, *end, *nl;
+
+            got  = fread( st->ibuf + have, 1, STREAM_INBUF - have, in );
+            have += got;
+            if ( got == 0 )
+            {
+                  if ( ferror( in ) )
+                  {
+                        perror( "sunriset: read" );
+                        goto fail;
+                  }
+                  eof = 1;
+            }
+            p   = st->ibuf;
+            end = st->ibuf + have;
+            for ( ;; )
+            {
+                  double f[5];
+                  const char *q;
+                  int    i;
+
+                  nl = memchr( p, '\n', end - p );
+                  if ( nl == NULL )
+                  {
+                        if ( !eof || p == end )
+                              break;
+                        nl = end;             /* Last line, no newline */
+                  }
+                  lineno++;
+                  q = p;
+                  p = nl < end ? nl + 1 : end;
+
+                  while ( q < nl && ( *q == ' ' || *q == '\t' || *q == '\r' ) )
+                        q++;
+                  if ( q == nl || *q == '#' )
+                        continue;
+                  for ( i = 0; i < 5 && q != NULL; i++ )
+                  {
+                        while ( q < nl && ( *q == ' ' || *q == '\t' || *q == ',' ) )
+                              q++;
+                        q = stream_number( q, nl, &f[i] );
+                  }
+                  while ( q != NULL && q < nl
+                          && ( *q == ' ' || *q == '\t' || *q == '\r' ) )
+                        q++;
+                  if ( q != nl || f[2] != floor( f[2] ) || f[3] != floor( f[3] )
+                       || f[4] != floor( f[4] ) )
+                  {
+                        fprintf( stderr, "sunriset: line %ld: expected "
+                                         "\"lat lon yyyy mm dd\"\n", lineno );
+                        goto fail;
+                  }
+                  /* Ranges checked before the conversions to int; the */
+                  /* negated tests also reject NaN                     */
+                  if ( !( f[0] >= -90.0 && f[0] <= 90.0 )
+                       || !( f[1] >= -180.0 && f[1] <= 180.0 )
+                       || !( f[2] >= 1801.0 && f[2] <= 2099.0 )
+                       || !( f[3] >= 1.0 && f[3] <= 12.0 )
+                       || !( f[4] >= 1.0 && f[4] <= 31.0 ) )
+                  {
+                        fprintf( stderr, "sunriset: line %ld: lat, lon or date"
+                                         " out of range\n", lineno );
+                        goto fail;
+                  }
+                  st->lat[st->n]   = f[0];
+                  st->lon[st->n]   = f[1];
+                  st->year[st->n]  = (int) f[2];
+                  st->month[st->n] = (int) f[3];
+                  st->day[st->n]   = (int) f[4];
+                  nrec++;
+                  if ( ++st->n == STREAM_BATCH && stream_emit( st ) != 0 )
+                        goto write_error;
+            }
+
+            /* Keep the incomplete last line for the next read */
+            have = end - p;
+            if ( have == STREAM_INBUF )
+            {
+                  fprintf( stderr, "sunriset: line %ld too long\n", lineno + 1 );
+                  goto fail;
+            }
+            memmove( st->ibuf, p, have );
+      }
+      if ( stream_emit( st ) != 0 || stream_flush( st ) != 0 || fflush( out ) != 0 )
+            goto write_error;
+      free( st );
+      return nrec;
+
+write_error:
+      perror( "sunriset: write" );
+fail:
+      free( st );
+      return -1;
+}  /* sunriset_stream */
+
+
+
+/* Inverse queries */
+
+/* One sunriset_crossings() query, and its count of evaluations */
+struct cross_query
+{
+      int    year, upper_limb, event;
+      double lon, lat, altit, clock, tz;
+      long   evals;
+};
+
+/* A day of the query: its state, the distance g of the event to the */
+/* clock time (hours), and cost, see __sunriset__                    */
+struct cross_day
+{
+      int    day, state;
+      double g, cost;
+};
+
+/* Evaluates day k of the year (0 = January 1st, may be outside of the */
+/* year), with the arithmetic of __sunriset__                          */
+static void cross_eval( struct cross_query *q, int k, struct cross_day *s )
+{
+      double d, sidtime, sRA, sdec, sr, tsouth, altit, cost, t, h;
+
+      d = days_since_2000_Jan_0(q->year,1,1+k) + 0.5 - q->lon/360.0;
+      sidtime = revolution( GMST0(d) + 180.0 + q->lon );
+      sun_RA_dec( d, &sRA, &sdec, &sr );
+      tsouth = 12.0 - rev180(sidtime - sRA)/15.0;
+      altit = q->altit;
+      if ( q->upper_limb )
+            altit -= 0.2666 / sr;
+      cost = ( sind(altit) - sind(q->lat) * sind(sdec) ) /
+             ( cosd(q->lat) * cosd(sdec) );
+
+      s->day  = k;
+      s->cost = cost;
+      s->g    = 0.0;
+      if ( cost >= 1.0 )
+            s->state = CROSS_NIGHT;
+      else if ( cost <= -1.0 )
+            s->state = CROSS_DAY;
+      else if ( q->event == CROSS_NONE )
+            s->state = CROSS_RISES;
+      else
+      {
+            t = acosd(cost)/15.0;
+            h = ( q->event == CROSS_RISE ? tsouth - t : tsouth + t ) + q->tz;
+            h -= 24.0 * floor( h / 24.0 );
+            s->g = h - q->clock;
+            s->state = s->g < 0.0 ? CROSS_BEFORE : CROSS_AFTER;
+      }
+      q->evals++;
+}
+
+/* The quantity of s which may reach a limit without a state change */
+/* visible at the samples: which = 0 for g (limit 0), 1 for cost     */
+/* (limit +1 or -1, whichever is nearer)                             */
+static double cross_margin( const struct cross_day *s, int which )
+{
+      if ( which == 0 )
+            return s->g;
+      return s->cost >= 0.0 ? s->cost - 1.0 : s->cost + 1.0;
+}
+
+/* Polar night or day, and the days with a rise and a set near them */
+static int cross_polar( const struct cross_day *s )
+{
+      return s->state == CROSS_NIGHT || s->state == CROSS_DAY;
+}
+
+static int cross_near_polar( const struct cross_day *s )
+{
+      return !cross_polar( s ) && fabs( s->cost ) > CROSS_POLAR;
+}
+
+/* Looks for a hidden pair of state changes around sample b, between */
+/* samples a and c of the same state: where the parabola through the */
+/* margins of a, b and c has its vertex near or beyond the limit, the */
+/* days around the vertex are evaluated, walking towards the limit.   */
+/* Return value: 1 with the day of another state in *e, else 0        */
+static int cross_hidden( struct cross_query *q, const struct cross_day *a,
+                         const struct cross_day *b, const struct cross_day *c,
+                         int which, struct cross_day *e )
+{
+      double ma = cross_margin( a, which ), mb = cross_margin( b, which ),
+             mc = cross_margin( c, which ), slope, curv, xv, mv, slack;
+      struct cross_day n;
+      int    k, dir;
+
+      if ( which == 0 && b->state != CROSS_BEFORE && b->state != CROSS_AFTER )
+            return 0;
+      /* b must be nearer the limit than a and c */
+      if ( fabs( mb ) >= fabs( ma ) || fabs( mb ) >= fabs( mc ) )
+            return 0;
+
+      /* Vertex (xv, mv) of the parabola ma + slope (x - a) + curv (x - a)(x - b). */
+      /* Near its extremum, the diurnal arc is not a parabola: the slack grows */
+      /* with the depth of the extremum.                                        */
+      slope = ( mb - ma ) / ( b->day - a->day );
+      curv  = ( ( mc - mb ) / ( c->day - b->day ) - slope ) / ( c->day - a->day );
+      if ( curv == 0.0 )
+            return 0;
+      xv = 0.5 * ( a->day + b->day ) - slope / ( 2.0 * curv );
+      mv = ma + slope * ( xv - a->day ) + curv * ( xv - a->day ) * ( xv - b->day );
+      slack = ( which == 0 ? 0.05 : 0.01 ) + 0.5 * fabs( mb - mv );
+      if ( ( mv < 0.0 ) == ( mb < 0.0 ) && fabs( mv ) > slack )
+            return 0;
+      k = (int) floor( xv + 0.5 );
+      if ( k <= a->day || k >= c->day )
+            k = b->day;
+
+      /* Walk from the vertex towards the limit */
+      cross_eval( q, k, e );
+      if ( e->state != b->state )
+            return 1;
+      for ( dir = -1; dir <= 1; dir += 2 )
+      {
+            for ( ;; )
+            {
+                  if ( e->day + dir <= a->day || e->day + dir >= c->day )
+                        break;
+                  cross_eval( q, e->day + dir, &n );
+                  if ( n.state != b->state )
+                  {
+                        *e = n;
+                        return 1;
+                  }
+                  if ( fabs( cross_margin( &n, which ) )
+                       >= fabs( cross_margin( e, which ) ) )
+                        break;
+                  *e = n;
+            }
+      }
+      return 0;
+}
+
+int sunriset_crossings( int year, double lon, double lat, double altit,
+                        int upper_limb, int event, double clock, double tz,
+                        int *state0, struct sunriset_crossing *cross,
+                        int maxcross, long *evals )
+/**********************************************************************/
+/* Note: year  = 1801-2099 only                                       */
+/*       lon, lat, altit, upper_limb = as in __sunriset__             */
+/*       event = CROSS_RISE or CROSS_SET                              */
+/*       clock = local time, hours, 0..24                             */
+/*       tz    = time zone, hours east of UT: the local time of an    */
+/*               event at t hours UT is t + tz, modulo 24             */
+/*      *state0 = state of January 1st                                */
+/*       cross = the state changes, in order, at most maxcross        */
+/*      *evals = where to add the number of positions of the Sun      */
+/*               computed, or NULL                                    */
+/* Return value: the number of state changes in the year, which may   */
+/*               be more than maxcross                                */
+/**********************************************************************/
+{
+      struct cross_query q;
+      struct cross_day   s[4 * ( 366 / CROSS_STEP + 3 )], e, lo, hi, mid;
+      int    n, ns, i, j, which, ncross = 0;
+
+      STATS_BEGIN;
+
+      q.year = year, q.upper_limb = upper_limb, q.event = event;
+      q.lon = lon, q.lat = lat, q.altit = altit, q.clock = clock, q.tz = tz;
+      q.evals = 0;
+      n = almanac_days( year );
+
+      /* The samples, with one more on each side of the year so that */
+      /* an extremum near January 1st or December 31st is seen        */
+      ns = 0;
+      for ( i = -CROSS_STEP; i < n - 1; i += CROSS_STEP )
+            cross_eval( &q, i, &s[ns++] );
+      cross_eval( &q, n - 1, &s[ns++] );
+      cross_eval( &q, n - 1 + CROSS_STEP, &s[ns++] );
+
+      /* Inserts the day of another state found near each extremum */
+      for ( i = 1; i < ns - 1; i++ )
+      {
+            if ( s[i-1].state != s[i].state || s[i].state != s[i+1].state )
+                  continue;
+            for ( which = 0; which < 2; which++ )
+                  if ( cross_hidden( &q, &s[i-1], &s[i], &s[i+1], which, &e ) )
+                  {
+                        j = e.day < s[i].day ? i : i + 1;
+                        memmove( &s[j+1], &s[j], ( ns - j ) * sizeof *s );
+                        s[j] = e;
+                        ns++;
+                        i++;
+                        break;
+                  }
+      }
+
+      /* Bisects each interval of the year where the state changes.     */
+      /* Near a polar night or day, the event time moves fast and may go */
+      /* past the clock time several times in a few days: these         */
+      /* intervals are scanned day by day.                               */
+      for ( i = 0; i < ns - 1; i++ )
+      {
+            if ( s[i].day < 0 || s[i+1].day > n - 1 )
+            {
+                  if ( s[i+1].day == 0 )
+                        *state0 = s[i+1].state;
+                  continue;
+            }
+            if ( cross_near_polar( &s[i] ) || cross_near_polar( &s[i+1] )
+                 || ( s[i].state != s[i+1].state
+                      && ( cross_polar( &s[i] ) || cross_polar( &s[i+1] ) ) ) )
+            {
+                  lo = s[i];
+                  for ( j = s[i].day + 1; j <= s[i+1].day; j++ )
+                  {
+                        if ( j < s[i+1].day )
+                              cross_eval( &q, j, &hi );
+                        else
+                              hi = s[i+1];
+                        if ( hi.state != lo.state )
+                        {
+                              if ( ncross < maxcross )
+                              {
+                                    cross[ncross].day  = hi.day;
+                                    cross[ncross].from = lo.state;
+                                    cross[ncross].to   = hi.state;
+                              }
+                              ncross++;
+                        }
+                        lo = hi;
+                  }
+                  continue;
+            }
+            lo = s[i];
+            while ( lo.state != s[i+1].state )
+            {
+                  /* First day after lo in another state than lo */
+                  hi = s[i+1];
+                  while ( hi.day - lo.day > 1 )
+                  {
+                        cross_eval( &q, lo.day + ( hi.day - lo.day ) / 2, &mid );
+                        if ( mid.state == lo.state )
+                              lo = mid;
+                        else
+                              hi = mid;
+                  }
+                  if ( ncross < maxcross )
+                  {
+                        cross[ncross].day  = hi.day;
+                        cross[ncross].from = lo.state;
+                        cross[ncross].to   = hi.state;
+                  }
+                  ncross++;
+                  lo = hi;
+            }
+      }
+      if ( evals )
+            *evals += q.evals;
+      STATS_END( STATS_CROSSINGS, STATS_NORC );
+      return ncross;
+}  /* sunriset_crossings */
+
+/* The polar timelines */
+
+int timeline_arena_init( struct timeline_arena *a, long cap )
+/**********************************************************************/
+/* Prepares an empty arena, with room for cap intervals to begin with */
+/* Return value: 0, or -1 if it cannot be allocated                   */
+/**********************************************************************/
+{
+      a->n = a->evals = 0;
+      a->cap = cap > 0 ? cap : 1;
+      a->iv = malloc( a->cap * sizeof *a->iv );
+      return a->iv ? 0 : -1;
+}  /* timeline_arena_init */
+
+void timeline_arena_free( struct timeline_arena *a )
+{
+      free( a->iv );
+      a->iv = NULL;
+      a->n = a->cap = 0;
+}  /* timeline_arena_free */
+
+static int timeline_push( struct timeline_arena *a, int first, int last,
+                          int kind, int state )
+{
+      struct timeline_interval *iv;
+
+      if ( a->n == a->cap )
+      {
+            if ( ( iv = realloc( a->iv, 2 * a->cap * sizeof *iv ) ) == NULL )
+                  return -1;
+            a->iv = iv;
+            a->cap *= 2;
+      }
+      iv = &a->iv[a->n++];
+      iv->first = (short) first;
+      iv->last  = (short) last;
+      iv->kind  = (signed char) kind;
+      iv->rc    = state == CROSS_DAY ? +1 : -1;
+      return 0;
+}
+
+/* The intervals of one site and one altitude, q->event = CROSS_NONE */
+static int timeline_one( struct timeline_arena *a, struct cross_query *q,
+                         int n, int kind )
+{
+      struct cross_day s[4 * ( 366 / CROSS_STEP + 3 )], e, lo, hi, mid;
+      int    ns = 0, i, j, state = CROSS_RISES, start = 0;
+
+      /* Samples, and hidden episodes, as in sunriset_crossings */
+      for ( i = -CROSS_STEP; i < n - 1; i += CROSS_STEP )
+            cross_eval( q, i, &s[ns++] );
+      cross_eval( q, n - 1, &s[ns++] );
+      cross_eval( q, n - 1 + CROSS_STEP, &s[ns++] );
+      for ( i = 1; i < ns - 1; i++ )
+      {
+            if ( s[i-1].state != s[i].state || s[i].state != s[i+1].state
+                 || !cross_hidden( q, &s[i-1], &s[i], &s[i+1], 1, &e ) )
+                  continue;
+            j = e.day < s[i].day ? i : i + 1;
+            memmove( &s[j+1], &s[j], ( ns - j ) * sizeof *s );
+            s[j] = e;
+            ns++;
+            i++;
+      }
+
+      /* Bisection of each change of state within the year */
+      for ( i = 0; i < ns - 1; i++ )
+      {
+            if ( s[i].day == 0 )
+                  state = s[i].state;
+            if ( s[i].day < 0 || s[i+1].day > n - 1 )
+                  continue;
+            lo = s[i];
+            while ( lo.state != s[i+1].state )
+            {
+                  hi = s[i+1];
+                  while ( hi.day - lo.day > 1 )
+                  {
+                        cross_eval( q, lo.day + ( hi.day - lo.day ) / 2, &mid );
+                        if ( mid.state == lo.state )
+                              lo = mid;
+                        else
+                              hi = mid;
+                  }
+                  if ( state != CROSS_RISES
+                       && timeline_push( a, start, hi.day - 1, kind, state ) != 0 )
+                        return -1;
+                  state = hi.state;
+                  start = hi.day;
+                  lo = hi;
+            }
+      }
+      if ( state != CROSS_RISES && timeline_push( a, start, n - 1, kind, state ) != 0 )
+            return -1;
+      return 0;
+}
+
+long polar_timeline( struct timeline_arena *a, int year, long nsites,
+                     const double *lon, const double *lat, int nkinds,
+                     const double *altit, const int *upper_limb,
+                     long *first )
+/**********************************************************************/
+/* Note: year  = 1801-2099 only                                       */
+/*       lon[i], lat[i] = the sites, as in __sunriset__               */
+/*       altit[k], upper_limb[k] = the nkinds altitudes, at most 127, */
+/*               as in __sunriset__, e.g. -35/60 and 1, -6 and 0      */
+/*       The intervals of site i are a->iv[first[i]] to               */
+/*       a->iv[first[i+1]-1], which holds nsites+1 entries; by kind,  */
+/*       then by day.  Within a kind, the days between two intervals  */
+/*       have a rise and a set.  An interval which begins on day 0 or */
+/*       ends on the last day may go on in the previous or the next   */
+/*       year.  They are appended to those already in the arena.     */
+/*       The days are those of __sunriset__ for every day, with the   */
+/*       limits written for sunriset_crossings().                     */
+/* Return value: the number of intervals in the arena, or -1 if it    */
+/*               cannot grow                                          */
+/**********************************************************************/
+{
+      struct cross_query q;
+      long   i;
+      int    k, n = almanac_days( year );
+
+      q.year = year, q.event = CROSS_NONE, q.clock = q.tz = 0.0;
+      q.evals = 0;
+      for ( i = 0; i < nsites; i++ )
+      {
+            first[i] = a->n;
+            q.lon = lon[i], q.lat = lat[i];
+            for ( k = 0; k < nkinds; k++ )
+            {
+                  q.altit = altit[k], q.upper_limb = upper_limb[k];
+                  if ( timeline_one( a, &q, n, k ) != 0 )
+                  {
+                        a->evals += q.evals;
+                        return -1;
+                  }
+            }
+      }
+      first[nsites] = a->n;
+      a->evals += q.evals;
+      return a->n;
+}  /* polar_timeline */
+
+void polar_latitudes( int year, int month, int day, double lon,
+                      double altit, int upper_limb,
+                      double polar_night[2], double polar_day[2] )
+/**********************************************************************/
+/* Latitudes of the polar night and day of the date, for the altitude */
+/* altit, with the Sun's position of __sunriset__ at longitude lon.   */
+/* With cost as in __sunriset__, cos(lat - sdec) <= sin(altit) is     */
+/* cost >= 1 and cos(lat + sdec) <= -sin(altit) is cost <= -1, so:    */
+/*       polar night for lat <= polar_night[0], lat >= polar_night[1] */
+/*       polar day   for lat <= polar_day[0],   lat >= polar_day[1]   */
+/* A limit beyond -90 or +90 means none in that hemisphere.  Within   */
+/* 1e-9 degrees of a limit, __sunriset__ may give either return code. */
+/**********************************************************************/
+{
+      double d, sRA, sdec, sr;
+
+      d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+      sun_RA_dec( d, &sRA, &sdec, &sr );
+      if ( upper_limb )
+            altit -= 0.2666 / sr;
+      polar_night[0] = sdec - 90.0 + altit;
+      polar_night[1] = sdec + 90.0 - altit;
+      polar_day[0]   = -90.0 - altit - sdec;
+      polar_day[1]   = 90.0 + altit - sdec;
+}  /* polar_latitudes */
+
+int clock_latitudes( int year, int month, int day, double lon,
+                     double altit, int upper_limb, int event,
+                     double clock, double tz, double lat[2] )
+/**********************************************************************/
+/* Latitudes where the rise (event = CROSS_RISE) or set (CROSS_SET)   */
+/* happens at the local clock time, hours, on the date, at longitude  */
+/* lon.  The time when the Sun is at south and the declination do    */
+/* not depend on the latitude, so the diurnal arc t is known, and     */
+/*       sin(altit) = sin(lat) sin(sdec) + cos(lat) cos(sdec) cos(15t)*/
+/*                  = R cos(lat - phi)                                */
+/* gives lat = phi +- acos(sin(altit)/R).                             */
+/* Return value: the number of latitudes stored in lat[], 0 to 2,     */
+/*               south first                                          */
+/**********************************************************************/
+{
+      double d, sidtime, sRA, sdec, sr, tsouth, t, a, b, r, phi, w, l;
+      int    k, n = 0;
+
+      d = days_since_2000_Jan_0(year,month,day) + 0.5 - lon/360.0;
+      sidtime = revolution( GMST0(d) + 180.0 + lon );
+      sun_RA_dec( d, &sRA, &sdec, &sr );
+      tsouth = 12.0 - rev180(sidtime - sRA)/15.0;
+      if ( upper_limb )
+            altit -= 0.2666 / sr;
+
+      /* The diurnal arc, hours, from the event time nearest noon */
+      t = event == CROSS_RISE ? tsouth - ( clock - tz )
+                              : ( clock - tz ) - tsouth;
+      t -= 24.0 * floor( ( t + 12.0 ) / 24.0 );
+      if ( t <= 0.0 || t >= 12.0 )
+            return 0;
+
+      a = sind(sdec);
+      b = cosd(sdec) * cosd(15.0 * t);
+      r = sqrt( a*a + b*b );
+      if ( fabs( sind(altit) ) > r )
+            return 0;
+      phi = atan2d( a, b );
+      w = acosd( sind(altit) / r );
+      for ( k = -1; k <= 1; k += 2 )
+      {
+            l = rev180( phi + k * w );
+            if ( l >= -90.0 && l <= 90.0 && ( n == 0 || l != lat[0] ) )
+                  lat[n++] = l;
+      }
+      if ( n == 2 && lat[0] > lat[1] )
+            l = lat[0], lat[0] = lat[1], lat[1] = l;
+      return n;
+}  /* clock_latitudes */
@@ -0,0 +1,745 @@
+/*
+
+SUNRISET.H - declarations of SUNRISET.C, the Sun rise/set library
+
+Link with sunriset.o (or libsunriset.a) and -lm -pthread.  The
+functions have no global state: all of them may be called from
+several threads at once, with the exceptions written in their own
+comments (a struct ephem_reader or a struct precise_stats belongs to
+one thread).  Built with -DSUNRISET_STATS, the library also keeps
+per-thread counters, see sunriset_stats_get().
+
+In C++ (C++14 or later), this header also declares, in namespace
+sunriset, constexpr versions of days_since_2000_Jan_0, revolution,
+rev180 and GMST0, and templates rise_set<Kind> and daylen<Kind> with
+the altitude and upper limb of each kind known at compile time.
+
+*/
+
+#ifndef SUNRISET_H
+#define SUNRISET_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+
+/* A macro to compute the number of days elapsed since 2000 Jan 0.0 */
+/* (which is equal to 1999 Dec 31, 0h UT)                           */
+
+#ifndef __cplusplus
+#define days_since_2000_Jan_0(y,m,d) \
+    (367L*(y)-((7*((y)+(((m)+9)/12)))/4)+((275*(m))/9)+(d)-730530L)
+#endif
+
+/* Following are some macros around the "workhorse" function __daylen__ */
+/* They mainly fill in the desired values for the reference altitude    */
+/* below the horizon, and also selects whether this altitude should     */
+/* refer to the Sun's center or its upper limb.                         */
+
+
+/* This macro computes the length of the day, from sunrise to sunset. */
+/* Sunrise/set is considered to occur when the Sun's upper limb is    */
+/* 35 arc minutes below the horizon (this accounts for the refraction */
+/* of the Earth's atmosphere).                                        */
+#define day_length(year,month,day,lon,lat)  \
+        __daylen__( year, month, day, lon, lat, -35.0/60.0, 1 )
+
+/* This macro computes the length of the day, including civil twilight. */
+/* Civil twilight starts/ends when the Sun's center is 6 degrees below  */
+/* the horizon.                                                         */
+#define day_civil_twilight_length(year,month,day,lon,lat)  \
+        __daylen__( year, month, day, lon, lat, -6.0, 0 )
+
+/* This macro computes the length of the day, incl. nautical twilight.  */
+/* Nautical twilight starts/ends when the Sun's center is 12 degrees    */
+/* below the horizon.                                                   */
+#define day_nautical_twilight_length(year,month,day,lon,lat)  \
+        __daylen__( year, month, day, lon, lat, -12.0, 0 )
+
+/* This macro computes the length of the day, incl. astronomical twilight. */
+/* Astronomical twilight starts/ends when the Sun's center is 18 degrees   */
+/* below the horizon.                                                      */
+#define day_astronomical_twilight_length(year,month,day,lon,lat)  \
+        __daylen__( year, month, day, lon, lat, -18.0, 0 )
+
+
+/* This macro computes times for sunrise/sunset.                      */
+/* Sunrise/set is considered to occur when the Sun's upper limb is    */
+/* 35 arc minutes below the horizon (this accounts for the refraction */
+/* of the Earth's atmosphere).                                        */
+#define sun_rise_set(year,month,day,lon,lat,rise,set)  \
+        __sunriset__( year, month, day, lon, lat, -35.0/60.0, 1, rise, set )
+
+/* This macro computes the start and end times of civil twilight.       */
+/* Civil twilight starts/ends when the Sun's center is 6 degrees below  */
+/* the horizon.                                                         */
+#define civil_twilight(year,month,day,lon,lat,start,end)  \
+        __sunriset__( year, month, day, lon, lat, -6.0, 0, start, end )
+
+/* This macro computes the start and end times of nautical twilight.    */
+/* Nautical twilight starts/ends when the Sun's center is 12 degrees    */
+/* below the horizon.                                                   */
+#define nautical_twilight(year,month,day,lon,lat,start,end)  \
+        __sunriset__( year, month, day, lon, lat, -12.0, 0, start, end )
+
+/* This macro computes the start and end times of astronomical twilight.   */
+/* Astronomical twilight starts/ends when the Sun's center is 18 degrees   */
+/* below the horizon.                                                      */
+#define astronomical_twilight(year,month,day,lon,lat,start,end)  \
+        __sunriset__( year, month, day, lon, lat, -18.0, 0, start, end )
+
+
+/* The batch function sunriset_batch() computes, for many (site, date)  */
+/* pairs in one call, the four results of the macros above: rise/set,   */
+/* civil, nautical and astronomical twilight, in this order.            */
+#define SUNRISET_KINDS      4
+
+#define KIND_RISE_SET       0
+#define KIND_CIVIL          1
+#define KIND_NAUTICAL       2
+#define KIND_ASTRONOMICAL   3
+
+/* The altitudes of the constants of Astro::Sunrise, in degrees, for */
+/* sunriset_altitudes().  They are for the Sun's center: upper_limb 0 */
+#define ALTIT_DEFAULT       (-0.833)
+#define ALTIT_CIVIL         (-6.0)
+#define ALTIT_NAUTICAL      (-12.0)
+#define ALTIT_AMATEUR       (-15.0)
+#define ALTIT_ASTRONOMICAL  (-18.0)
+
+/* Instruction sets for the vectorized diurnal arc, see sunriset_arcs() */
+#define ISA_SCALAR          0
+#define ISA_SSE2            1
+#define ISA_AVX2            2
+#define ISA_AVX512          3
+
+
+/* The precise function __sunriset_precise__() iterates __sunriset__   */
+/* like the precise algorithm of Astro::Sunrise: the Sun's position is */
+/* recomputed at the last computed rise (or set) time, until two       */
+/* consecutive times agree within the tolerance tol, in hours.         */
+/* tol = PRECISE_TOL_PERL applies the test of Astro::Sunrise, equality */
+/* of the times rounded to 5 significant digits.                       */
+#define PRECISE_MAXITER     9
+#define PRECISE_TOL         1e-5
+#define PRECISE_TOL_PERL    0.0
+
+/* Convergence telemetry of __sunriset_precise__, cumulated over the  */
+/* calls which pass the same struct.  Clear it with memset before use */
+struct precise_stats
+{
+      long calls;                       /* Calls */
+      long evals;                       /* Sun's positions computed */
+      long iter[PRECISE_MAXITER+1];     /* iter[k] = rises or sets     */
+                                        /* settled after k iterations */
+      long unconverged;                 /* Rises or sets still moving */
+                                        /* after PRECISE_MAXITER      */
+};
+
+/* The result of sunrise() of Astro::Sunrise, computed by            */
+/* __sunriset_perl__() for the XS backend of the module.  With polar  */
+/* => 'retval', a Sun always below or above the altitude gives        */
+/* rc_rise or rc_set = -1 ('night') or +1 ('day').  With polar =>     */
+/* 'warn', the times are computed anyway and warning[] lists the     */
+/* warnings to carp, in order: -1 "Sun never rises!!", +1 "Sun never  */
+/* sets!!".  The precise algorithm may warn once per iteration.       */
+#define PERL_MAXWARN        ( 2 * PRECISE_MAXITER )
+
+struct perl_sunrise
+{
+      double rise, set;                 /* Hours UT */
+      int    rc_rise, rc_set;           /* 0, or 'night' -1, 'day' +1 */
+      int    nwarn;                     /* Entries of warning[] */
+      signed char warning[PERL_MAXWARN];
+};
+
+/* Instrumentation of the entry points, compiled in with              */
+/* -DSUNRISET_STATS=1 (call counters, return codes, iterations of the */
+/* precise algorithms) or -DSUNRISET_STATS=2 (the same, and latency   */
+/* histograms, at the cost of two clock readings per call); without  */
+/* it, the hot paths are not touched at all and                       */
+/* sunriset_stats_get() gives zeros.  Each thread counts into its own */
+/* buffer, without locks nor atomic read-modify-write;                */
+/* sunriset_stats_get() sums the buffers of all the threads, past and */
+/* present.  Calls made by another entry point count for both.        */
+#define STATS_SUNRISET      0   /* __sunriset__, __sunriset_ephem__ */
+#define STATS_DAYLEN        1   /* __daylen__, __daylen_ephem__ */
+#define STATS_PRECISE       2   /* __sunriset_precise__ */
+#define STATS_PERL          3   /* __sunriset_perl__ */
+#define STATS_ALTITUDES     4   /* sunriset_altitudes */
+#define STATS_SWEEP         5   /* sunriset_sweep_next */
+#define STATS_YEAR          6   /* sunriset_year */
+#define STATS_BATCH         7   /* sunriset_batch */
+#define STATS_ALMANAC       8   /* sunriset_almanac */
+#define STATS_CROSSINGS     9   /* sunriset_crossings */
+#define STATS_FLOAT         10  /* __sunriset_float__ */
+#define STATS_BATCH_ALTIT   11  /* sunriset_batch_altit */
+#define STATS_RASTER        12  /* sunriset_raster_tiles */
+#define STATS_NFUNC         13
+
+#define STATS_NBUCKETS      40  /* Latency bucket k: 2^k <= ns < 2^(k+1) */
+
+struct sunriset_stats
+{
+      long calls[STATS_NFUNC];
+      long rc[STATS_NFUNC][3];          /* rc[f][r+1]: return code r */
+      long ns[STATS_NFUNC];             /* Total time, nanoseconds */
+      long latency[STATS_NFUNC][STATS_NBUCKETS];
+      long iter[PRECISE_MAXITER+2];     /* Rises or sets settled after */
+                                        /* k iterations, in the precise */
+                                        /* functions; the last one for  */
+                                        /* the unconverged ones         */
+      int  threads;                     /* Buffers summed */
+};
+
+/* Day-to-day sweep of one site, see sunriset_sweep_init().  Between  */
+/* two resynchronizations, every resync days (SWEEP_RESYNC unless     */
+/* changed after sunriset_sweep_init), the sines and cosines of the   */
+/* mean anomaly, of the longitude of perihelion and of the obliquity  */
+/* are advanced by one day with the angle addition formulas, and the  */
+/* eccentric anomaly is added to the mean anomaly as a small angle.   */
+/* One atan2 and one acos per day remain, instead of 17 trigonometric */
+/* functions in __sunriset__.  Over 1801-2099, the times differ from  */
+/* those of __sunriset__ by less than 1e-9 hours, 4 microseconds,    */
+/* and show no drift between resynchronizations (see "sunriset-bench  */
+/* sweep"); the return code may differ where cost is within rounding  */
+/* errors of +-1.                                                     */
+#define SWEEP_RESYNC        32
+
+struct sunriset_sweep
+{
+      double d;                         /* Instant of the next day */
+      double lon, sin_lat, cos_lat, sin_alt, cos_alt;
+      int    upper_limb;
+      int    resync, age;               /* Days between and since the */
+                                        /* resynchronizations         */
+      double sin_M, cos_M, sin_w, cos_w, sin_obl, cos_obl;
+      double sin_dM, cos_dM, sin_dw, cos_dw, sin_dobl, cos_dobl;
+};
+
+/* A precomputed table of the Sun's position, see sun_ephem_init().    */
+/* RA, declination and distance are interpolated with cubic Lagrange   */
+/* polynomials over 4 tabulated instants.  RA is stored as its         */
+/* difference with the Sun's mean longitude, which stays within a few  */
+/* degrees, so single precision is enough.  GMST0 is linear in d and   */
+/* is not tabulated.  Maximum errors against sun_RA_dec, 1801-2099,   */
+/* with a step of 1 day: RA 4e-7, dec 1.3e-6 degrees, r 7e-8 AU, that  */
+/* is at most 3 ms on the rise and set times, for 12 bytes per day.    */
+/* These errors come from the single precision: smaller steps do not  */
+/* reduce them.                                                        */
+struct sun_ephem
+{
+      double d0;        /* Instant of the first entry, days since 2000 Jan 0.0 */
+      double step;      /* Days between entries */
+      long   n;         /* Number of entries */
+      float  *tab;      /* RA - mean longitude, dec, r: 3 floats per entry */
+};
+
+/* Ephemeris backends: where the functions which take a struct        */
+/* ephem_reader, and by default __sunriset__, __daylen__ and          */
+/* __sunriset_precise__, get the Sun's position and the day number.   */
+/* EPHEM_SCHLYTER is sun_RA_dec(): one step of Kepler's equation,     */
+/* elements linear in time, and the calendar of days_since_2000_Jan_0 */
+/* (right from 1900 March 1st to 2100 February 28th, one day early    */
+/* before).  EPHEM_MEEUS is sun_RA_dec_meeus(), see below, with the   */
+/* calendar of sunriset_days(): any date from -4000 to +8000.  A      */
+/* reader without table (eph NULL) uses its backend, EPHEM_DEFAULT    */
+/* being the one compiled in: EPHEM_SCHLYTER, unless the library is   */
+/* built with -DSUNRISET_EPHEM=EPHEM_MEEUS.  A reader with a table is */
+/* EPHEM_SCHLYTER.  The other functions (sunriset_altitudes, the      */
+/* sweep, the rasters, the float and Perl functions...) always use    */
+/* EPHEM_SCHLYTER.                                                    */
+#define EPHEM_DEFAULT       0
+#define EPHEM_SCHLYTER      1
+#define EPHEM_MEEUS         2
+
+/* sun_RA_dec_meeus() solves Kepler's equation by Newton's method,    */
+/* until the correction is below KEPLER_TOL radian                    */
+#define KEPLER_MAXITER      8
+#define KEPLER_TOL          1e-12
+
+/* Per-thread access to a shared sun_ephem, with its counters */
+struct ephem_reader
+{
+      const struct sun_ephem *eph;
+      long hits;        /* Positions interpolated from the table */
+      long misses;      /* Positions computed by sun_RA_dec (outside the table) */
+      int  backend;     /* Without table: EPHEM_DEFAULT, EPHEM_SCHLYTER */
+                        /* or EPHEM_MEEUS                               */
+};
+
+/* This macro computes precise times for sunrise/sunset, see the */
+/* sun_rise_set macro                                            */
+#define sun_rise_set_precise(year,month,day,lon,lat,rise,set)  \
+        __sunriset_precise__( year, month, day, lon, lat, -35.0/60.0, 1, \
+                              PRECISE_TOL, NULL, NULL, rise, set )
+
+
+/* Output formats of sunriset_stream()                                */
+/* STREAM_CSV: one line per record, the input fields then rc, rise    */
+/* and set for each of the SUNRISET_KINDS kinds, times in hours UT.   */
+/* STREAM_BINARY: STREAM_RECORD bytes per record, SUNRISET_KINDS      */
+/* signed bytes for rc, then rise and set of each kind as IEEE 754    */
+/* single precision floats, little-endian.                            */
+#define STREAM_CSV          0
+#define STREAM_BINARY       1
+#define STREAM_RECORD       ( SUNRISET_KINDS * ( 1 + 2*4 ) )
+
+
+/* Almanac files: the results of sunriset_almanac for a grid of sites  */
+/* and a range of years, precomputed and read with mmap.               */
+/* Layout, all numbers little-endian:                                  */
+/*   header, ALMFILE_HEADER bytes:                                     */
+/*       0  "SUNALM1" and a null byte                                  */
+/*       8  int32 year0, year1      first and last year (1801-2099)    */
+/*      16  int32 nlat, nlon        grid size                          */
+/*      24  int32 kinds             SUNRISET_KINDS                     */
+/*      28  int32 quantum           seconds per unit of the times      */
+/*      32  double lat0, dlat, lon0, dlon                              */
+/*   then, for each year, for each day of the year, for each site (row */
+/*   by row: latitude lat0 + i*dlat, longitude lon0 + j*dlon), a       */
+/*   record of ALMFILE_RECORD bytes:                                   */
+/*       0  flags: 2 bits per kind, kind k at bits 2k and 2k+1:        */
+/*          0 = rc 0, 1 = rc +1, 2 = rc -1                             */
+/*       1  for each kind, int16 rise and int16 set, in quanta from    */
+/*          the local mean noon, 12h - lon/15 UT                       */
+/* The default quantum of 2 seconds covers -18..+18 hours from noon,   */
+/* with a rounding error of at most 1 second.                          */
+/* almanac_lookup() interpolates bilinearly between the 4 grid cells   */
+/* around the site.  Errors against __sunriset__ on a 1 degree grid,   */
+/* all kinds, where both have rc 0 (see "sunriset-bench almfile"):     */
+/*       |lat| < 45:        median 0.6 s, 99% 2.3 s,  max 14 s         */
+/*       45 <= |lat| < 60:  median 1.0 s, 99% 68 s,   max 38 min       */
+/*       60 <= |lat| < 80:  median 3.0 s, 99% 11 min, max 56 min       */
+/* The large errors are near the latitudes where the Sun stops rising  */
+/* or setting (for twilights too), where the times change fastest.     */
+/* rc is the same as __sunriset__ for 99.8% of the lookups: where the  */
+/* 4 cells do not have the same rc, the result is the one of the       */
+/* nearest cell.  Within a few minutes of time of the date line, the  */
+/* times can be 24 hours off those of __sunriset__: same instants, on  */
+/* the other side of the line.                                         */
+#define ALMFILE_HEADER      64
+#define ALMFILE_RECORD      ( 1 + SUNRISET_KINDS * 4 )
+#define ALMFILE_QUANTUM     2
+#define ALMFILE_OUTSIDE     (-2)     /* almanac_lookup: not in the file */
+
+struct almanac_file
+{
+      const unsigned char *base;        /* The mapped file */
+      size_t size;
+      int    year0, year1, nlat, nlon, quantum;
+      double lat0, dlat, lon0, dlon;
+      int    wrap;                      /* The grid goes round the Earth */
+};
+
+
+/* Inverse queries: sunriset_crossings() finds the days of a year when */
+/* the rise (or set) time goes past a local clock time, or when polar  */
+/* night or day begins or ends, from a sample every CROSS_STEP days,   */
+/* refined by bisection.  The state of a day is one of CROSS_NIGHT,    */
+/* CROSS_BEFORE, CROSS_AFTER and CROSS_DAY: the event happens before   */
+/* or after the clock time (local time, 0..24h), or the Sun is always  */
+/* below (rc -1) or above (rc +1) the altitude.  The results are the   */
+/* ones of __sunriset__ for every day of the year, unless two changes  */
+/* happen within a few days of each other near the extremum of a       */
+/* curve which only grazes the clock time or a polar limit.  About 35  */
+/* positions of the Sun per (site, year) instead of 365.               */
+#define CROSS_RISE          0
+#define CROSS_SET           1
+#define CROSS_NONE          2   /* No clock time: only the return code */
+
+#define CROSS_NIGHT         (-2)
+#define CROSS_BEFORE        (-1)
+#define CROSS_RISES         0   /* Rise and set, with event CROSS_NONE */
+#define CROSS_AFTER         1
+#define CROSS_DAY           2
+
+#define CROSS_STEP          16
+#define CROSS_POLAR         0.95
+
+struct sunriset_crossing
+{
+      int day;          /* First day in the new state, 0 = January 1st */
+      int from, to;     /* States before and from that day */
+};
+
+/* Polar timelines: polar_timeline() finds, for many sites and several */
+/* altitudes, the periods of the year when __sunriset__ returns +1 (the */
+/* Sun always above the altitude: midnight sun for rise/set, continuous */
+/* civil twilight or day for -6 degrees) or -1 (polar night), with the  */
+/* sampling and bisection of sunriset_crossings().  The intervals are   */
+/* stored in an arena, which grows by doubling: no allocation per       */
+/* interval, and one arena per batch of sites, or per thread.           */
+struct timeline_interval
+{
+      short first, last;                /* Days of the year, 0 = January 1st */
+      signed char kind;                 /* Index in the altitudes */
+      signed char rc;                   /* +1 or -1 */
+};
+
+struct timeline_arena
+{
+      struct timeline_interval *iv;
+      long   n, cap;                    /* Intervals stored, room */
+      long   evals;                     /* Positions of the Sun computed */
+};
+
+
+/* Rasters: the rise and set times and the day length of one date and */
+/* one altitude over a grid of nlat x nlon sites (latitude lat0 +     */
+/* i*dlat, longitude lon0 + j*dlon), for maps.  The Sun's position    */
+/* depends only on the column (the instant of the local noon), the    */
+/* sine and cosine of the latitude only on the row:                   */
+/* sunriset_raster_init() computes them once, nlon + nlat times, and  */
+/* each cell costs one arc cosine, by tiles of RASTER_TILE x          */
+/* RASTER_TILE cells.  With ISA_SCALAR the times are those of         */
+/* __sunriset__, rounded to float, and the day length is tset - trise */
+/* (24 hours for rc +1, 0 for -1).  The vectorized instruction sets   */
+/* use the arc cosine of sunriset_arcs(), see sunriset-arcs.h: with   */
+/* AVX-512, 0.06 s instead of 0.11 s for the day length of a 3600 x   */
+/* 1800 grid, while ISA_SSE2 is slower than ISA_SCALAR                */
+/* ("sunriset-bench raster").  The result of sunriset_raster_tiles()  */
+/* holds each selected layer, in the order below; a layer is made of  */
+/* tiles, row of tiles after row of tiles, and a tile of cells, row   */
+/* after row, see sunriset_raster_index().  The cells of the last     */
+/* tiles which are beyond the grid are 0.                             */
+#define RASTER_RISE         1
+#define RASTER_SET          2
+#define RASTER_DAYLEN       4
+#define RASTER_NLAYERS      3
+#define RASTER_TILE         64
+
+struct sunriset_raster
+{
+      int    nlat, nlon;
+      int    ntlat, ntlon;              /* Tiles per column, per row */
+      int    layers, isa;
+      double *sin_alt;                  /* Per column: sine of the altitude */
+                                        /* (corrected for the upper limb), */
+      double *sin_dec, *cos_dec;        /* of the Sun's declination,        */
+      double *tsouth;                   /* time when the Sun is at south    */
+      double *sin_lat, *cos_lat;        /* Per row */
+};
+
+/* Raster files: a RASTER_HEADER bytes header, then the tiles of       */
+/* sunriset_raster_tiles() for the whole grid, as little-endian IEEE   */
+/* floats.  The header size is a multiple of the page size and a tile  */
+/* is 16 KiB, so that each tile of a mapped file takes whole pages.    */
+/*       0  char[8] "SUNRAS1"                                          */
+/*       8  int32 year, month, day, upper_limb                         */
+/*      24  int32 nlat, nlon, tile (RASTER_TILE), layers               */
+/*      40  double altit, lat0, dlat, lon0, dlon                       */
+/* raster_cell() reads one cell of a mapped file.                      */
+#define RASTER_HEADER       4096
+
+struct raster_file
+{
+      const unsigned char *base;        /* The mapped file */
+      size_t size;
+      int    year, month, day, upper_limb;
+      int    nlat, nlon, ntlat, ntlon, layers;
+      double altit, lat0, dlat, lon0, dlon;
+};
+
+
+/* Function prototypes */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+double __daylen__( int year, int month, int day, double lon, double lat,
+                   double altit, int upper_limb );
+
+int __sunriset__( int year, int month, int day, double lon, double lat,
+                  double altit, int upper_limb, double *rise, double *set );
+
+int __sunriset_ephem__( struct ephem_reader *er, int year, int month,
+                        int day, double lon, double lat, double altit,
+                        int upper_limb, double *rise, double *set );
+
+double __daylen_ephem__( struct ephem_reader *er, int year, int month,
+                         int day, double lon, double lat, double altit,
+                         int upper_limb );
+
+int __sunriset_precise__( int year, int month, int day, double lon,
+                          double lat, double altit, int upper_limb,
+                          double tol, struct ephem_reader *er,
+                          struct precise_stats *stats,
+                          double *rise, double *set );
+
+int __sunriset_float__( int year, int month, int day, double lon,
+                        double lat, double altit, int upper_limb,
+                        double *rise, double *set );
+
+int __sunriset_perl__( int year, int month, int day, double lon,
+                       double lat, double altit, int upper_limb,
+                       int precise, int retval, struct perl_sunrise *res );
+
+int sunriset_stats_enabled( void );
+
+void sunriset_stats_get( struct sunriset_stats *st );
+
+void sunriset_stats_reset( void );
+
+int sunriset_stats_json( FILE *out );
+
+void sunpos( double d, double *lon, double *r );
+
+void sun_RA_dec( double d, double *RA, double *dec, double *r );
+
+void sun_RA_dec_meeus( double d, double *RA, double *dec, double *r,
+                       double *lmean );
+
+long sunriset_days( int year, int month, int day );
+
+int sun_ephem_init( struct sun_ephem *eph, int year0, int year1, double step );
+
+void sun_ephem_free( struct sun_ephem *eph );
+
+void sun_RA_dec_ephem( struct ephem_reader *er, double d,
+                       double *RA, double *dec, double *r );
+
+double revolution( double x );
+
+double rev180( double x );
+
+double GMST0( double d );
+
+long sunriset_batch( long n, const int *year, const int *month,
+                     const int *day, const double *lon, const double *lat,
+                     double *rise, double *set, int *rc, int isa,
+                     struct ephem_reader *er );
+
+long sunriset_batch_altit( long n, const int *year, const int *month,
+                           const int *day, const double *lon,
+                           const double *lat, const double *altit,
+                           const int *upper_limb, double *rise,
+                           double *set, int *rc );
+
+int sunriset_isa( void );
+
+void sunriset_arcs( int isa, long n, const double *lat, const double *sdec,
+                    const double *altit, const double *tsouth,
+                    double *rise, double *set, int *rc );
+
+void sunriset_arcs_float( int isa, long n, const float *lat,
+                          const float *sdec, const float *altit,
+                          const float *tsouth, float *rise, float *set,
+                          int *rc );
+
+int almanac_days( int year );
+
+long sunriset_stream( FILE *in, FILE *out, int format );
+
+int almanac_write( const char *path, int year0, int year1,
+                   double lat0, double dlat, int nlat,
+                   double lon0, double dlon, int nlon, int nthreads );
+
+int almanac_open( struct almanac_file *af, const char *path );
+
+void almanac_close( struct almanac_file *af );
+
+int almanac_lookup( const struct almanac_file *af, int year, int month,
+                    int day, double lon, double lat, int kind,
+                    double *rise, double *set );
+
+void sunriset_altitudes( int year, int month, int day, double lon,
+                         double lat, int n, const double *altit,
+                         const int *upper_limb, double *rise, double *set,
+                         int *rc, double *daylen );
+
+void sunriset_sweep_init( struct sunriset_sweep *sw, int year, int month,
+                          int day, double lon, double lat, double altit,
+                          int upper_limb );
+
+int sunriset_sweep_next( struct sunriset_sweep *sw, double *rise,
+                         double *set );
+
+int sunriset_year( int year, double lon, double lat, double altit,
+                   int upper_limb, double *rise, double *set, int *rc );
+
+int sunriset_crossings( int year, double lon, double lat, double altit,
+                        int upper_limb, int event, double clock, double tz,
+                        int *state0, struct sunriset_crossing *cross,
+                        int maxcross, long *evals );
+
+void polar_latitudes( int year, int month, int day, double lon,
+                      double altit, int upper_limb,
+                      double polar_night[2], double polar_day[2] );
+
+int clock_latitudes( int year, int month, int day, double lon,
+                     double altit, int upper_limb, int event,
+                     double clock, double tz, double lat[2] );
+
+int timeline_arena_init( struct timeline_arena *a, long cap );
+
+void timeline_arena_free( struct timeline_arena *a );
+
+long polar_timeline( struct timeline_arena *a, int year, long nsites,
+                     const double *lon, const double *lat, int nkinds,
+                     const double *altit, const int *upper_limb,
+                     long *first );
+
+int sunriset_raster_init( struct sunriset_raster *r, int year, int month,
+                          int day, double altit, int upper_limb,
+                          double lat0, double dlat, int nlat,
+                          double lon0, double dlon, int nlon,
+                          int layers, int isa );
+
+void sunriset_raster_free( struct sunriset_raster *r );
+
+long sunriset_raster_index( const struct sunriset_raster *r, long i,
+                            long j );
+
+void sunriset_raster_tiles( const struct sunriset_raster *r, int ti0,
+                            int ti1, float *out );
+
+int raster_write( const char *path, int year, int month, int day,
+                  double altit, int upper_limb, double lat0, double dlat,
+                  int nlat, double lon0, double dlon, int nlon, int layers );
+
+int raster_open( struct raster_file *rf, const char *path );
+
+void raster_close( struct raster_file *rf );
+
+int raster_cell( const struct raster_file *rf, int layer, long i, long j,
+                 double *value );
+
+int sunriset_almanac( int year, long nsites, const double *lon,
+                      const double *lat, int nthreads, int isa,
+                      const struct sun_ephem *eph,
+                      double *rise, double *set, int *rc );
+
+#ifdef __cplusplus
+}  /* extern "C" */
+
+#include <math.h>
+
+namespace sunriset
+{
+
+/* The date and angle functions of SUNRISET.C, for constant arguments */
+/* evaluated at compile time.  They give the same results as the C    */
+/* functions.                                                         */
+
+constexpr long days_since_2000_Jan_0( int y, int m, int d )
+{
+      return 367L*y - ( ( 7*( y + ( ( m + 9 )/12 ) ) )/4 )
+             + ( ( 275*m )/9 ) + d - 730530L;
+}
+
+/* floor(), which is not constexpr before C++23 */
+constexpr double floor_cx( double x )
+{
+      return (double) (long long) x > x ? (double) (long long) x - 1.0
+                                        : (double) (long long) x;
+}
+
+constexpr double revolution( double x )
+{
+      return x - 360.0 * floor_cx( x * ( 1.0 / 360.0 ) );
+}
+
+constexpr double rev180( double x )
+{
+      return x - 360.0 * floor_cx( x * ( 1.0 / 360.0 ) + 0.5 );
+}
+
+constexpr double GMST0( double d )
+{
+      return revolution( ( 180.0 + 356.0470 + 282.9404 ) +
+                         ( 0.9856002585 + 4.70935E-5 ) * d );
+}
+
+/* Altitude and upper limb of each kind, as in the macros above */
+template <int Kind> struct kind;
+
+template <> struct kind<KIND_RISE_SET>
+{
+      static constexpr double altit = -35.0/60.0;
+      static constexpr bool   upper_limb = true;
+};
+
+template <> struct kind<KIND_CIVIL>
+{
+      static constexpr double altit = -6.0;
+      static constexpr bool   upper_limb = false;
+};
+
+template <> struct kind<KIND_NAUTICAL>
+{
+      static constexpr double altit = -12.0;
+      static constexpr bool   upper_limb = false;
+};
+
+template <> struct kind<KIND_ASTRONOMICAL>
+{
+      static constexpr double altit = -18.0;
+      static constexpr bool   upper_limb = false;
+};
+
+constexpr double degrad = 3.1415926535897932384 / 180.0;
+constexpr double radeg  = 180.0 / 3.1415926535897932384;
+
+/* __sunriset__ for one kind: rise_set<KIND_CIVIL>(...) is       */
+/* civil_twilight(...).  Same results, bit for bit; sin(altit) is */
+/* folded at compile time for the twilights.                      */
+template <int Kind>
+inline int rise_set( int year, int month, int day, double lon, double lat,
+                     double *trise, double *tset )
+{
+      double d = days_since_2000_Jan_0( year, month, day ) + 0.5 - lon/360.0;
+      double sidtime = revolution( GMST0( d ) + 180.0 + lon );
+      double sRA, sdec, sr, tsouth, cost, t;
+      double altit = kind<Kind>::altit;
+      int    rc = 0;
+
+      ::sun_RA_dec( d, &sRA, &sdec, &sr );
+      tsouth = 12.0 - rev180( sidtime - sRA )/15.0;
+      if ( kind<Kind>::upper_limb )
+            altit -= 0.2666 / sr;
+      cost = ( sin( altit*degrad ) - sin( lat*degrad ) * sin( sdec*degrad ) ) /
+             ( cos( lat*degrad ) * cos( sdec*degrad ) );
+      if ( cost >= 1.0 )
+            rc = -1, t = 0.0;
+      else if ( cost <= -1.0 )
+            rc = +1, t = 12.0;
+      else
+            t = radeg*acos( cost )/15.0;
+      *trise = tsouth - t;
+      *tset  = tsouth + t;
+      return rc;
+}
+
+/* __daylen__ for one kind: daylen<KIND_RISE_SET>(...) is day_length(...) */
+template <int Kind>
+inline double daylen( int year, int month, int day, double lon, double lat )
+{
+      double d = days_since_2000_Jan_0( year, month, day ) + 0.5 - lon/360.0;
+      double obl_ecl = 23.4393 - 3.563E-7 * d;
+      double slon, sr, sin_sdecl, cos_sdecl, cost;
+      double altit = kind<Kind>::altit;
+
+      ::sunpos( d, &slon, &sr );
+      sin_sdecl = sin( obl_ecl*degrad ) * sin( slon*degrad );
+      cos_sdecl = sqrt( 1.0 - sin_sdecl * sin_sdecl );
+      if ( kind<Kind>::upper_limb )
+            altit -= 0.2666 / sr;
+      cost = ( sin( altit*degrad ) - sin( lat*degrad ) * sin_sdecl ) /
+             ( cos( lat*degrad ) * cos_sdecl );
+      if ( cost >= 1.0 )
+            return 0.0;
+      if ( cost <= -1.0 )
+            return 24.0;
+      return (2.0/15.0) * ( radeg*acos( cost ) );
+}
+
+}  /* namespace sunriset */
+
+/* So that C code using the macro compiles as C++ */
+using sunriset::days_since_2000_Jan_0;
+
+#endif  /* __cplusplus */
+
+#endif  /* SUNRISET_H */